@@ -143,6 +143,16 @@
 #define mLEDInterval_c                  100
 #endif
 
+/*
+* Name: gLEDFlashSlack_c
+* Description: Allowed lateness (milliseconds) of the LED flashing timer, so
+*              its expirations can be processed together with other timers
+*/
+
+#ifndef gLEDFlashSlack_c
+#define gLEDFlashSlack_c                10
+#endif
+
 /*
 * LEDs mapping
 */
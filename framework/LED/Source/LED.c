@@ -678,7 +678,7 @@ void LED_StartFlashWithPeriod
     /* start the timer */
     if(!TMR_IsTimerActive(mLEDTimerID))
     {
-        TMR_StartIntervalTimer(mLEDTimerID, periodMs, (pfTmrCallBack_t)LED_FlashTimeout, (void*)((uint32_t)mLEDTimerID));
+        TMR_StartTimerWithSlack(mLEDTimerID, gTmrIntervalTimer_c, periodMs, gLEDFlashSlack_c, (pfTmrCallBack_t)LED_FlashTimeout, (void*)((uint32_t)mLEDTimerID));
     }
 #else
     #warning "The TIMER component is not enabled and therefore the LED flashing function is disabled"
@@ -49,7 +49,10 @@
 * Public macros
 *************************************************************************************
 ********************************************************************************** */
-/*Defines pools by block size and number of blocks. Must be alligned to 4 bytes.*/     
+/*Defines pools by block size and number of blocks. Must be alligned to 4 bytes.
+  Pools declared with _compact_block_size_(h) instead of _block_size_ are compact pools.
+  The optional _reserved_blocks_(n) marker keeps the last n free blocks of a pool
+  for critical allocations.*/     
 #ifndef PoolsDetails_c
 #define PoolsDetails_c \
          _block_size_  64  _number_of_blocks_    8 _pool_id_(0) _eol_  \
@@ -72,11 +75,58 @@
 #define MEM_CheckMemBufferInterval_c      15000 /* ms */
 #endif
 
+/* Maximum number of blocks checked by each MEM_CheckIfMemBuffersAreFreed() call */
+#ifndef MEM_CheckMemBufferBlocksPerCall_c
+#define MEM_CheckMemBufferBlocksPerCall_c 4
+#endif
+
+/* If MEM_POOL_SPLITTING is defined, a free block of a bigger pool is split into blocks
+   of a smaller pool when the smaller pool is exhausted, instead of being used for a
+   single allocation. The blocks are coalesced back when all of them are freed. */
+
+/* Blocks of the pools declared with _block_size_ have a 16 byte list header. Pools declared
+   with _compact_block_size_(h) keep their free blocks in a bitmap, and their blocks have
+   a header of h bytes, which must be 0 or 4. The parent pool of a compact block is found
+   from its address. The 4 byte header holds the block index, so that the block is freed
+   without a division, and a check value that detects overflows of the previous block.
+   Compact blocks cannot be enqueued by the Messaging module and are never split, so
+   compact pools must have their own pool Id; MEM_Init() fails for a compact pool
+   with pool Id 0. Example:
+   _compact_block_size_(0) 64 _number_of_blocks_ 16 _pool_id_(1) _eol_ */
+
+/* If MEM_TRACE is defined, allocations, frees and retains are recorded in a ring of
+   MEM_TraceRingSize_c memTraceRecord_t records, which can be dumped with MEM_TraceDump().
+   Unlike MEM_TRACKING, the cost does not depend on the number of blocks. */
+#ifndef MEM_TraceRingSize_c
+#define MEM_TraceRingSize_c               64 /* records, must be a power of 2 */
+#endif
+
+/* Headroom added by MEM_PoolsReport() to the peak usage of each pool, when recommending
+   the number of blocks. Doubled for pools that were exhausted. */
+#ifndef MEM_PoolsReportHeadroom_c
+#define MEM_PoolsReportHeadroom_c         25 /* percent */
+#endif
+
+/* Pool Id flag for critical allocations. Only critical allocations may use the blocks
+   reserved with _reserved_blocks_(n), so that the RX path keeps working when the pools
+   are drained by other allocations. */
+#define MEM_CriticalAllocFlag_c           0x80
+
 /* Default memory allocator */
 #ifndef MEM_BufferAlloc
 #define MEM_BufferAlloc(numBytes)   MEM_BufferAllocWithId(numBytes, 0, (void*)__get_LR())
 #endif
 
+/* Allocate multiple blocks from the default memory pools, all or none */
+#ifndef MEM_BufferAllocBatch
+#define MEM_BufferAllocBatch(ppBuffers, pNumBytes, count)   MEM_BufferAllocBatchWithId(ppBuffers, pNumBytes, count, 0, (void*)__get_LR())
+#endif
+
+/* Critical memory allocator, which may use the reserved blocks */
+#ifndef MEM_BufferAllocCritical
+#define MEM_BufferAllocCritical(numBytes)   MEM_BufferAllocWithId(numBytes, MEM_CriticalAllocFlag_c, (void*)__get_LR())
+#endif
+
 /* Allocate a block from the memory pools forever.*/
 #define MEM_BufferAllocForever(numBytes,poolId)   MEM_BufferAllocWithId(numBytes, poolId, (void*)((uint32_t)__get_LR() | 0x80000000 ))
 
@@ -108,12 +158,35 @@ memStatus_t MEM_Init(void);
 uint32_t MEM_GetAvailableBlocks(uint32_t size);
 /*Frees the givem buffer.*/
 memStatus_t MEM_BufferFree(void* buffer);
+/*Adds a reference to the given buffer. Each reference is dropped by MEM_BufferFree.
+  Blocks split from a bigger pool (MEM_POOL_SPLITTING) cannot be referenced.*/
+memStatus_t MEM_BufferRetain(void* buffer);
 /*Returns the allocated buffer of the given size.*/
 void* MEM_BufferAllocWithId(uint32_t numBytes , uint8_t  poolId, void *pCaller);
+/*Allocates count buffers of the given sizes, using a single critical section.*/
+memStatus_t MEM_BufferAllocBatchWithId(void **ppBuffers, const uint32_t *pNumBytes, uint32_t count, uint8_t poolId, void *pCaller);
+/*Frees count buffers, using a single critical section.*/
+memStatus_t MEM_BufferFreeBatch(void **ppBuffers, uint32_t count);
 /*Returns the size of a given buffer*/
 uint16_t MEM_BufferGetSize(void* buffer);
 /*Performs a write-read-verify test accross all pools*/
 uint32_t MEM_WriteReadTest(void);
+#ifdef MEM_STATISTICS
+/*Writes the pool statistics and a recommended PoolsDetails_c to the given serial interface.
+  The report is text, with lines ending in \r\n:
+    Size Blocks Used Peak Fail Rec
+    <block size> <blocks> <in use> <peak> <allocation failures> <recommended blocks>[*]
+    ...                         one line per pool, in PoolsDetails_c order. '*' marks
+                                the pools that had allocation failures.
+    Min free <blocks>           lowest number of free blocks since MEM_Init()
+    #define PoolsDetails_c ...  the recommended layout on a single line, which can be
+                                pasted into app_preinclude.h*/
+void MEM_PoolsReport(uint8_t interfaceId);
+#endif
+#ifdef MEM_TRACE
+/*Writes the trace ring to the given serial interface*/
+memStatus_t MEM_TraceDump(uint8_t interfaceId);
+#endif
 
 
 /*! *********************************************************************************
@@ -143,6 +216,12 @@ typedef struct poolStat_tag
   uint16_t allocatedBlocksPeak;
   uint16_t allocationFailures;
   uint16_t freeFailures;
+  uint16_t reserveHits;     /* Number of critical allocations served from the reserved blocks */
+  uint16_t reserveMisses;   /* Number of critical allocations that found no free block */
+#ifdef MEM_POOL_SPLITTING
+  uint16_t splitCount;      /* Number of free blocks of this pool split into smaller blocks */
+  uint16_t coalesceCount;   /* Number of split blocks of this pool coalesced back */
+#endif /*MEM_POOL_SPLITTING*/
 #ifdef MEM_TRACKING
   uint16_t poolFragmentWaste;
   uint16_t poolFragmentWastePeak;
@@ -177,6 +256,41 @@ typedef PACKED_STRUCT BlockTracking_tag
 }blockTracking_t;
 #endif /*MEM_TRACKING*/
 
+#ifdef MEM_TRACE
+/*Operations recorded in the trace ring.*/
+typedef enum
+{
+  MEM_TRACE_ALLOC_c = 0,            /* Buffer allocated, block is NULL if the allocation failed */
+  MEM_TRACE_FREE_c,                 /* Buffer freed, or one of its references dropped */
+  MEM_TRACE_RETAIN_c,               /* Reference added to the buffer */
+  MEM_TRACE_FREE_ERROR_c            /* Invalid buffer, or buffer already freed */
+}memTraceOp_t;
+
+/*Trace record. All fields are little endian.*/
+typedef PACKED_STRUCT memTraceRecord_tag
+{
+  uint32_t timeStamp;               /* MEM_GetTimeStamp() */
+  uint32_t block;                   /* Address of the buffer */
+  uint32_t caller;                  /* Return address of the caller. Bit 31 is set for
+                                       MEM_BufferAllocForever() */
+  uint16_t size;                    /* Requested size for allocations, else 0 */
+  uint8_t  op;                      /* memTraceOp_t */
+  uint8_t  freeBlocks;              /* Free blocks after the operation, saturated to 255 */
+}memTraceRecord_t;
+
+/*Header written by MEM_TraceDump(), followed by the records from the oldest to the newest.*/
+typedef PACKED_STRUCT memTraceHeader_tag
+{
+  uint32_t magic;                   /* mMemTraceMagic_c */
+  uint32_t sequence;                /* Number of records written since MEM_Init() */
+  uint32_t heapStart;               /* Address of the memory heap, to map buffers to pools */
+  uint16_t recordSize;              /* sizeof(memTraceRecord_t) */
+  uint16_t recordCount;             /* Number of records following the header */
+}memTraceHeader_t;
+
+#define mMemTraceMagic_c                  0x544D454D /* "MEMT" */
+#endif /*MEM_TRACE*/
+
 /*Header description for buffers.*/
 typedef struct listHeader_tag
 {
@@ -184,10 +298,20 @@ typedef struct listHeader_tag
   struct pools_tag *pParentPool;
 }listHeader_t;
 
+/*Header description for buffers of compact pools declared with a 4 byte header.*/
+typedef struct compactHeader_tag
+{
+  uint16_t blockIndex; /* Heap order index of the block */
+  uint16_t check;      /* Complement of blockIndex */
+}compactHeader_t;
+
 /*Buffer pools. Used by most functions*/
 typedef struct pools_tag
 {
   list_t anchor; /* MUST be first element in pools_t struct */
+  uint8_t *pHeapStart; /* Address of the first block header of the pool */
+  uint8_t *pHeapEnd;   /* Address following the last block of the pool */
+  uint16_t firstBlockIndex; /* Heap order index of the first block of the pool */
   uint16_t nextBlockSize;
   uint16_t blockSize;
   uint16_t  poolId;
@@ -196,15 +320,20 @@ typedef struct pools_tag
 #endif /*MEM_STATISTICS*/
   uint8_t numBlocks;
   uint8_t allocatedBlocks;
+  uint8_t headerSize; /* Size of the block header, sizeof(listHeader_t) for list pools */
+  bool_t  compact;    /* TRUE if the free blocks are kept in a bitmap */
+  uint8_t reservedBlocks; /* Free blocks kept for critical allocations */
 }pools_t;
 
 /*Buffer pool description. Used by MM_Init() for creating the buffer pools. */
 typedef struct poolInfo_tag
 {
+  uint8_t  headerSize;
+  bool_t   compact;
   uint16_t blockSize;
   uint16_t poolSize;
   uint16_t poolId;
-  uint8_t  padding[2];
+  uint16_t reservedBlocks;
 }poolInfo_t;
 
 /*! *********************************************************************************
@@ -217,7 +346,9 @@ typedef struct poolInfo_tag
 uint8_t MEM_Track(listHeader_t *block, memTrackingStatus_t alloc, uint32_t address, uint16_t requestedSize, void *pCaller);
 uint8_t MEM_BufferCheck(uint8_t *p, uint32_t size);
 void MEM_CheckIfMemBuffersAreFreed(void);
+#endif /*MEM_TRACKING*/
 
+#if defined(MEM_TRACKING) || defined(MEM_TRACE)
 /* The timestamp function used by MEM Manager for debug purpose.
    The timestamp must be in milliseconds! */
 #if defined(__IAR_SYSTEMS_ICC__)
@@ -225,7 +356,16 @@ extern __weak uint32_t MEM_GetTimeStamp(void);
 #elif defined(__GNUC__)
 extern __attribute__((weak)) uint32_t MEM_GetTimeStamp(void);
 #endif
+#endif /*MEM_TRACKING || MEM_TRACE*/
 
-#endif /*MEM_TRACKING*/
+#if defined(MEM_TRACKING) && defined(MEM_STATISTICS)
+/* The timestamp function used to measure MEM_CheckIfMemBuffersAreFreed().
+   The timestamp must be in microseconds! The default uses TMR_GetTimestamp(). */
+#if defined(__IAR_SYSTEMS_ICC__)
+extern __weak uint32_t MEM_GetTimeStampUs(void);
+#elif defined(__GNUC__)
+extern __attribute__((weak)) uint32_t MEM_GetTimeStampUs(void);
+#endif
+#endif /*MEM_TRACKING && MEM_STATISTICS*/
 
 #endif /* _MEM_MANAGER_H_ */ 
@@ -43,6 +43,12 @@
 #include "Panic.h"
 #include "MemManager.h"
 #include "FunctionLib.h"
+#if defined(MEM_STATISTICS) || defined(MEM_TRACE)
+#include "SerialManager.h"
+#endif
+#if defined(MEM_TRACKING) && defined(MEM_STATISTICS)
+#include "TimersManager.h"
+#endif
 
 /*! *********************************************************************************
 *************************************************************************************
@@ -50,27 +56,33 @@
 *************************************************************************************
 ********************************************************************************** */
 
-#define _block_size_  {
+#define _block_size_  { sizeof(listHeader_t), FALSE,
+#define _compact_block_size_(h)  { h, TRUE,
 #define _number_of_blocks_  ,
-#define _pool_id_(a) , a ,
+#define _pool_id_(a) , .poolId = a
+#define _reserved_blocks_(n) , .reservedBlocks = n
 #define _eol_  },
 
 
 poolInfo_t poolInfo[] =
 {
   PoolsDetails_c
-  {0, 0, 0} /*termination tag*/
+  {0, 0, 0, 0, 0, 0} /*termination tag*/
 };
 
 #undef _block_size_
+#undef _compact_block_size_
 #undef _number_of_blocks_
 #undef _eol_
 #undef _pool_id_
+#undef _reserved_blocks_
 
 #define _block_size_ (sizeof(listHeader_t)+
+#define _compact_block_size_(h) (h+
 #define _number_of_blocks_ ) *
 #define _eol_  +
 #define _pool_id_(a)
+#define _reserved_blocks_(n)
 
 #define heapSize_c (PoolsDetails_c 0)
 
@@ -79,14 +91,18 @@ uint8_t memHeap[heapSize_c];
 const uint32_t heapSize = heapSize_c;
 
 #undef _block_size_
+#undef _compact_block_size_
 #undef _number_of_blocks_
 #undef _eol_
 #undef _pool_id_
+#undef _reserved_blocks_
 
 #define _block_size_ 0 *
+#define _compact_block_size_(h) 0 *
 #define _number_of_blocks_ + 0 *
 #define _eol_  + 1 +
 #define _pool_id_(a)
+#define _reserved_blocks_(n)
 
 #define poolCount (PoolsDetails_c 0)
 
@@ -97,31 +113,97 @@ pools_t  memPoolsSnapShot[poolCount];
 #endif
 
 #undef _block_size_
+#undef _compact_block_size_
 #undef _number_of_blocks_
 #undef _eol_
 #undef _pool_id_
+#undef _reserved_blocks_
 
-#ifdef MEM_TRACKING
+#define _block_size_ + 0 *
+#define _compact_block_size_(h) + 1 + 0 *
+#define _number_of_blocks_ + 0 *
+#define _eol_
+#define _pool_id_(a)
+#define _reserved_blocks_(n)
 
-#ifndef NUM_OF_TRACK_PTR
-#define NUM_OF_TRACK_PTR 1
-#endif
+/* Number of compact pools. See MEM_GetCompactPool() */
+static const uint8_t memCompactPoolCount = (0 PoolsDetails_c);
+
+#undef _block_size_
+#undef _compact_block_size_
+#undef _number_of_blocks_
+#undef _eol_
+#undef _pool_id_
+#undef _reserved_blocks_
+
+/* Size classes have a 4 byte granularity, since all block sizes are 4 byte alligned.
+   The sum of all block sizes is an upper bound for the biggest block size. */
+#define mMemSizeClassShift_c 2
+
+#define _block_size_ + (
+#define _compact_block_size_(h) + (
+#define _number_of_blocks_ ) + 0 *
+#define _eol_
+#define _pool_id_(a)
+#define _reserved_blocks_(n)
+
+#define mMemSizeClassCount_c ((0 PoolsDetails_c) >> mMemSizeClassShift_c)
+
+/* Maps a size class to the index of the first pool with a big enough block size */
+static uint8_t memSizeClass[mMemSizeClassCount_c];
+/* The biggest block size available in the memory pools */
+static uint16_t memMaxBlockSize;
+
+#undef _block_size_
+#undef _compact_block_size_
+#undef _number_of_blocks_
+#undef _eol_
+#undef _pool_id_
+#undef _reserved_blocks_
 
 #define _block_size_ 0*
+#define _compact_block_size_(h) 0*
 #define _number_of_blocks_ +
 #define _eol_  +
 #define _pool_id_(a)
+#define _reserved_blocks_(n)
 
 #define mTotalNoOfMsgs_d (PoolsDetails_c 0)
+
+/* Number of extra references held on each block, in heap order. See MEM_BufferRetain() */
+static uint8_t memRefCount[mTotalNoOfMsgs_d];
+/* Free state of the blocks of compact pools, one bit per block in heap order.
+   A set bit marks a free block. Bits of the other pools are always clear. */
+static uint32_t memFreeBitmap[(mTotalNoOfMsgs_d + 31) >> 5];
+#define mMemBitmapWord(blockIndex) memFreeBitmap[(blockIndex) >> 5]
+#define mMemBitmapMask(blockIndex) (1UL << ((blockIndex) & 0x1F))
+
+#ifdef MEM_POOL_SPLITTING
+#ifdef MEM_TRACKING
+#error "MEM_POOL_SPLITTING cannot be used together with MEM_TRACKING"
+#endif
+/* Split state of each block, in heap order. 0 if the block is not split, else 1 plus
+   the number of allocated blocks carved out of it. See MEM_SplitBlock() */
+static uint8_t memSplitState[mTotalNoOfMsgs_d];
+#endif /*MEM_POOL_SPLITTING*/
+
+#ifdef MEM_TRACKING
+
+#ifndef NUM_OF_TRACK_PTR
+#define NUM_OF_TRACK_PTR 1
+#endif
+
 static const uint16_t mTotalNoOfMsgs_c = mTotalNoOfMsgs_d;
 blockTracking_t memTrack[mTotalNoOfMsgs_d];
 
+#endif /*MEM_TRACKING*/
+
 #undef _block_size_
+#undef _compact_block_size_
 #undef _number_of_blocks_
 #undef _eol_
 #undef _pool_id_
-
-#endif /*MEM_TRACKING*/
+#undef _reserved_blocks_
 
 /* Free messages counter. Not used by module. */
 uint16_t gFreeMessagesCount;
@@ -129,7 +211,47 @@ uint16_t gFreeMessagesCount;
 uint16_t gFreeMessagesCountMin = 0xFFFF;
 uint16_t gTotalFragmentWaste = 0;
 uint16_t gMaxTotalFragmentWaste = 0;
+#ifdef MEM_TRACKING
+/* Longest MEM_CheckIfMemBuffersAreFreed() call, in microseconds */
+uint32_t gMemLeakCheckMaxDuration = 0;
+#endif
+#endif
+
+#ifdef MEM_TRACE
+#if (MEM_TraceRingSize_c & (MEM_TraceRingSize_c - 1))
+#error "MEM_TraceRingSize_c must be a power of 2"
+#endif
+/* Trace ring. The newest record is at memTraceSequence - 1, modulo the ring size. */
+static memTraceRecord_t memTraceRing[MEM_TraceRingSize_c];
+static uint32_t memTraceSequence;
+/* Recording is paused while the ring is dumped */
+static volatile bool_t memTracePaused;
+#endif /*MEM_TRACE*/
+
+/*! *********************************************************************************
+*************************************************************************************
+* Private prototypes
+*************************************************************************************
+********************************************************************************** */
+static void MEM_InitSizeClasses(void);
+static pools_t* MEM_GetFirstPool(uint32_t numBytes, uint8_t poolId);
+static void* MEM_BufferAllocFromPools(pools_t *pPools, uint32_t numBytes, uint8_t poolId);
+static memStatus_t MEM_BufferFreeToPool(void* buffer, pools_t *pCompactPool);
+static bool_t MEM_BufferIsValid(void* buffer, pools_t *pCompactPool);
+static uint8_t* MEM_GetRefCount(void* buffer, pools_t *pCompactPool);
+static pools_t* MEM_GetParentPool(void* buffer);
+#ifdef MEM_TRACE
+static void MEM_Trace(memTraceOp_t op, void *buffer, void *pCaller, uint32_t size);
 #endif
+static pools_t* MEM_GetCompactPool(void* buffer);
+static bool_t MEM_GetCompactBlockIndex(pools_t *pPool, void* buffer, uint32_t *pBlockIndex);
+static void* MEM_CompactBlockAlloc(pools_t *pPool);
+#ifdef MEM_POOL_SPLITTING
+static listHeader_t* MEM_SplitBlock(listHeader_t *pBlock, pools_t *pDonorPool, pools_t *pPool);
+static listHeader_t* MEM_GetDonorBlock(listHeader_t *pHeader, pools_t **ppDonorPool, uint32_t *pDonorIndex);
+static bool_t MEM_SplitBlockIsValid(listHeader_t *pHeader);
+static void MEM_UpdateSplitBlock(listHeader_t *pHeader, bool_t alloc);
+#endif /*MEM_POOL_SPLITTING*/
 
 /*! *********************************************************************************
 *************************************************************************************
@@ -143,7 +265,8 @@ uint16_t gMaxTotalFragmentWaste = 0;
 *
 * \param[in] none
 *
-* \return MEM_SUCCESS_c if initialization is successful. (It's always successful).
+* \return MEM_SUCCESS_c if initialization is successful, MEM_INIT_ERROR_c if
+*         PoolsDetails_c is invalid. All allocations fail after an error.
 *
 ********************************************************************************** */
 memStatus_t MEM_Init(void)
@@ -153,22 +276,53 @@ memStatus_t MEM_Init(void)
   uint8_t *pHeap = memHeap;/* IN: Memory heap.*/
 
   uint16_t poolN;
-#ifdef MEM_TRACKING
-  uint16_t memTrackIndex = 0;
-#endif /*MEM_TRACKING*/
+  uint16_t blockIndex = 0;
 
   gFreeMessagesCount = 0;
+  memMaxBlockSize = 0;
+#ifdef MEM_TRACE
+  memTraceSequence = 0;
+  memTracePaused = FALSE;
+#endif
+
+  /* Check the whole layout before creating any pool. Compact pools must have a
+     pool Id, so that their blocks never reach the default allocator users, which
+     may enqueue them with the Messaging module. */
+  for( ; pPoolInfo->blockSize; pPoolInfo++ )
+  {
+    if( (pPoolInfo->compact && (0 == pPoolInfo->poolId)) ||
+        (pPoolInfo->compact && pPoolInfo->headerSize &&
+         (pPoolInfo->headerSize != sizeof(compactHeader_t))) ||
+        (pPoolInfo->reservedBlocks > pPoolInfo->poolSize) )
+    {
+      return MEM_INIT_ERROR_c;
+    }
+  }
+  pPoolInfo = poolInfo;
 
   for(;;)
   {
     poolN = pPoolInfo->poolSize;
     ListInit((listHandle_t)&pPools->anchor, poolN);
+    pPools->pHeapStart = pHeap;
+    pPools->firstBlockIndex = blockIndex;
+    pPools->headerSize = pPoolInfo->headerSize;
+    pPools->compact = pPoolInfo->compact;
+    pPools->reservedBlocks = pPoolInfo->reservedBlocks;
+    pPools->numBlocks = 0;
+    pPools->allocatedBlocks = 0;
 #ifdef MEM_STATISTICS
     pPools->poolStatistics.numBlocks = 0;
     pPools->poolStatistics.allocatedBlocks = 0;
     pPools->poolStatistics.allocatedBlocksPeak = 0;
     pPools->poolStatistics.allocationFailures = 0;
     pPools->poolStatistics.freeFailures = 0;
+    pPools->poolStatistics.reserveHits = 0;
+    pPools->poolStatistics.reserveMisses = 0;
+#ifdef MEM_POOL_SPLITTING
+    pPools->poolStatistics.splitCount = 0;
+    pPools->poolStatistics.coalesceCount = 0;
+#endif /*MEM_POOL_SPLITTING*/
 #ifdef MEM_TRACKING
     pPools->poolStatistics.poolFragmentWaste = 0;
     pPools->poolStatistics.poolFragmentWastePeak = 0;
@@ -178,32 +332,50 @@ memStatus_t MEM_Init(void)
 
     while(poolN)
     {
-      /* Add block to list of free memory. */
-      ListAddTail((listHandle_t)&pPools->anchor, (listElementHandle_t)&((listHeader_t *)pHeap)->link);
-      ((listHeader_t *)pHeap)->pParentPool = pPools;
+      if( pPools->compact )
+      {
+        /* Mark the block as free in the bitmap */
+        mMemBitmapWord(blockIndex) |= mMemBitmapMask(blockIndex);
+        if( pPools->headerSize )
+        {
+          ((compactHeader_t *)pHeap)->blockIndex = blockIndex;
+          ((compactHeader_t *)pHeap)->check = (uint16_t)~blockIndex;
+        }
+      }
+      else
+      {
+        /* Add block to list of free memory. */
+        ListAddTail((listHandle_t)&pPools->anchor, (listElementHandle_t)&((listHeader_t *)pHeap)->link);
+        ((listHeader_t *)pHeap)->pParentPool = pPools;
+      }
 #ifdef MEM_STATISTICS
       pPools->poolStatistics.numBlocks++;
 #endif /*MEM_STATISTICS*/
 
       pPools->numBlocks++;
       gFreeMessagesCount++;
+      memRefCount[blockIndex] = 0;
+#ifdef MEM_POOL_SPLITTING
+      memSplitState[blockIndex] = 0;
+#endif /*MEM_POOL_SPLITTING*/
 #ifdef MEM_TRACKING
-      memTrack[memTrackIndex].blockAddr = (void *)(pHeap + sizeof(listHeader_t));
-      memTrack[memTrackIndex].blockSize = pPoolInfo->blockSize;
-      memTrack[memTrackIndex].fragmentWaste = 0;
-      memTrack[memTrackIndex].allocAddr = NULL;
-      memTrack[memTrackIndex].allocCounter = 0;
-      memTrack[memTrackIndex].allocStatus = MEM_TRACKING_FREE_c;
-      memTrack[memTrackIndex].freeAddr = NULL;
-      memTrack[memTrackIndex].freeCounter = 0;
-      memTrackIndex++;
+      memTrack[blockIndex].blockAddr = (void *)(pHeap + pPoolInfo->headerSize);
+      memTrack[blockIndex].blockSize = pPoolInfo->blockSize;
+      memTrack[blockIndex].fragmentWaste = 0;
+      memTrack[blockIndex].allocAddr = NULL;
+      memTrack[blockIndex].allocCounter = 0;
+      memTrack[blockIndex].allocStatus = MEM_TRACKING_FREE_c;
+      memTrack[blockIndex].freeAddr = NULL;
+      memTrack[blockIndex].freeCounter = 0;
 #endif /*MEM_TRACKING*/
+      blockIndex++;
 
-        /* Add block size (without list header)*/
-      pHeap += pPoolInfo->blockSize + sizeof(listHeader_t);
+        /* Add block size (without block header)*/
+      pHeap += pPoolInfo->blockSize + pPoolInfo->headerSize;
       poolN--;
     }
 
+    pPools->pHeapEnd = pHeap;
     pPools->blockSize = pPoolInfo->blockSize;
     pPools->poolId = pPoolInfo->poolId;
     pPools->nextBlockSize = (pPoolInfo+1)->blockSize;
@@ -216,6 +388,11 @@ memStatus_t MEM_Init(void)
     pPoolInfo++;
   }
 
+  MEM_InitSizeClasses();
+#ifdef MEM_STATISTICS
+  gFreeMessagesCountMin = gFreeMessagesCount;
+#endif
+
   return MEM_SUCCESS_c;
 }
 
@@ -242,7 +419,14 @@ uint32_t size
     {
         if(size <= pPools->blockSize)
         {
-            pTotalCount += ListGetSize((listHandle_t)&pPools->anchor);
+            if( pPools->compact )
+            {
+                pTotalCount += pPools->numBlocks - pPools->allocatedBlocks;
+            }
+            else
+            {
+                pTotalCount += ListGetSize((listHandle_t)&pPools->anchor);
+            }
         }
         
         if(pPools->nextBlockSize == 0)
@@ -271,7 +455,8 @@ uint32_t size
 * \brief     Allocate a block from the memory pools. The function uses the
 *            numBytes argument to look up a pool with adequate block sizes.
 * \param[in] numBytes - Size of buffer to allocate.
-* \param[in] poolId - The ID of the pool where to search for a free buffer.
+* \param[in] poolId - The ID of the pool where to search for a free buffer. If
+*                     MEM_CriticalAllocFlag_c is set, the reserved blocks may be used.
 * \param[in] pCaller - pointer to the caller function (Debug purpose)
 *
 * \return Pointer to the allocated buffer, NULL if failed.
@@ -289,83 +474,110 @@ void *pCaller
 #ifdef MEM_TRACKING
     /* Save the Link Register */
     volatile uint32_t savedLR = (uint32_t) __get_LR();
-    uint16_t requestedSize = numBytes;
 #endif /*MEM_TRACKING*/
-#ifdef MEM_STATISTICS
-    bool_t allocFailure = FALSE;
+    pools_t *pPools = MEM_GetFirstPool(numBytes, poolId);
+    void *pBlock;
+
+    OSA_InterruptDisable();
+    
+    pBlock = MEM_BufferAllocFromPools(pPools, numBytes, poolId);
+    
+#ifdef MEM_TRACKING
+    if( NULL != pBlock )
+    {
+        MEM_Track(pBlock, MEM_TRACKING_ALLOC_c, savedLR, numBytes, pCaller);
+    }
+#endif /*MEM_TRACKING*/
+#ifdef MEM_TRACE
+    MEM_Trace(MEM_TRACE_ALLOC_c, pBlock, pCaller, numBytes);
 #endif
     
-    pools_t *pPools = memPools;
-    listHeader_t *pBlock;
+#ifdef MEM_DEBUG_OUT_OF_MEMORY
+    if( NULL == pBlock )
+    {
+        panic( 0, (uint32_t)MEM_BufferAllocWithId, 0, 0);
+    }
+#endif
+    
+    OSA_InterruptEnable();
+    return pBlock;
+}
+
+/*! *********************************************************************************
+* \brief     Allocate multiple blocks from the memory pools, using a single critical
+*            section. Either all the requested blocks are allocated, or none.
+*
+* \param[out] ppBuffers - Array where the allocated buffers are stored.
+* \param[in]  pNumBytes - Array with the size of each buffer to allocate.
+* \param[in]  count - Number of buffers to allocate.
+* \param[in]  poolId - The ID of the pool where to search for free buffers. If
+*                      MEM_CriticalAllocFlag_c is set, the reserved blocks may be used.
+* \param[in]  pCaller - pointer to the caller function (Debug purpose)
+*
+* \return MEM_SUCCESS_c if all buffers were allocated, MEM_ALLOC_ERROR_c if not.
+*         On failure, all entries of ppBuffers are set to NULL.
+*
+* \pre Memory manager must be previously initialized.
+*
+********************************************************************************** */
+memStatus_t MEM_BufferAllocBatchWithId
+(
+void **ppBuffers,
+const uint32_t *pNumBytes,
+uint32_t count,
+uint8_t  poolId,
+void *pCaller
+)
+{
+#ifdef MEM_TRACKING
+    /* Save the Link Register */
+    volatile uint32_t savedLR = (uint32_t) __get_LR();
+#endif /*MEM_TRACKING*/
+    uint32_t i;
 
     OSA_InterruptDisable();
     
-    while(numBytes)
+    for( i = 0; i < count; i++ )
     {
-        if( (numBytes <= pPools->blockSize) && (poolId == pPools->poolId) )
+        ppBuffers[i] = MEM_BufferAllocFromPools(MEM_GetFirstPool(pNumBytes[i], poolId), pNumBytes[i], poolId);
+#ifdef MEM_TRACE
+        MEM_Trace(MEM_TRACE_ALLOC_c, ppBuffers[i], pCaller, pNumBytes[i]);
+#endif
+        if( NULL == ppBuffers[i] )
         {
-            pBlock = (listHeader_t *)ListRemoveHead((listHandle_t)&pPools->anchor);
-            
-            if(NULL != pBlock)
-            {
-                pBlock++;
-                gFreeMessagesCount--;
-                pPools->allocatedBlocks++;
-                
-#ifdef MEM_STATISTICS
-                if(gFreeMessagesCount < gFreeMessagesCountMin)
-                {
-                    gFreeMessagesCountMin = gFreeMessagesCount;
-                }
-                
-                pPools->poolStatistics.allocatedBlocks++;
-                if ( pPools->poolStatistics.allocatedBlocks > pPools->poolStatistics.allocatedBlocksPeak )
-                {
-                    pPools->poolStatistics.allocatedBlocksPeak = pPools->poolStatistics.allocatedBlocks;
-                }
-                MEM_ASSERT(pPools->poolStatistics.allocatedBlocks <= pPools->poolStatistics.numBlocks);
-#endif /*MEM_STATISTICS*/
-                
+            break;
+        }
 #ifdef MEM_TRACKING
-                MEM_Track(pBlock, MEM_TRACKING_ALLOC_c, savedLR, requestedSize, pCaller);
+        MEM_Track(ppBuffers[i], MEM_TRACKING_ALLOC_c, savedLR, pNumBytes[i], pCaller);
 #endif /*MEM_TRACKING*/
-                OSA_InterruptEnable();
-                return pBlock;
-            }
-            else
-            {
-#ifdef MEM_STATISTICS
-                if(!allocFailure)
-                {
-                    pPools->poolStatistics.allocationFailures++;
-                    allocFailure = TRUE;
-                }
-#endif /*MEM_STATISTICS*/
-                if(numBytes > pPools->nextBlockSize) 
-                {
-                    break;
-                }
-                /* No more blocks of that size, try next size. */
-                numBytes = pPools->nextBlockSize;   
-            }
-        }
-        /* Try next pool*/
-        if(pPools->nextBlockSize)
-        {
-            pPools++;
-        }
-        else
-        {
-            numBytes = 0;
-        }
     }
     
+    if( i < count )
+    {
+        /* Release the buffers allocated so far */
+        while( i-- )
+        {
+            (void)MEM_BufferFreeToPool(ppBuffers[i], MEM_GetCompactPool(ppBuffers[i]));
+#ifdef MEM_TRACKING
+            MEM_Track(ppBuffers[i], MEM_TRACKING_FREE_c, savedLR, 0, NULL);
+#endif /*MEM_TRACKING*/
+#ifdef MEM_TRACE
+            MEM_Trace(MEM_TRACE_FREE_c, ppBuffers[i], pCaller, 0);
+#endif
+        }
+        
+        /* The entries following the failed allocation were not written either */
+        FLib_MemSet(ppBuffers, 0, count * sizeof(void*));
+        
 #ifdef MEM_DEBUG_OUT_OF_MEMORY
-    panic( 0, (uint32_t)MEM_BufferAllocWithId, 0, 0);
+        panic( 0, (uint32_t)MEM_BufferAllocBatchWithId, 0, 0);
 #endif
+        OSA_InterruptEnable();
+        return MEM_ALLOC_ERROR_c;
+    }
     
     OSA_InterruptEnable();
-    return NULL;
+    return MEM_SUCCESS_c;
 }
 
 /*! *********************************************************************************
@@ -386,126 +598,1159 @@ memStatus_t MEM_BufferFree
 void* buffer /* IN: Block of memory to free*/
 )
 {
-#ifdef MEM_TRACKING
+#if defined(MEM_TRACKING) || defined(MEM_TRACE)
     /* Save the Link Register */
     volatile uint32_t savedLR = (uint32_t) __get_LR();
-#endif /*MEM_TRACKING*/
-    listHeader_t *pHeader;
-    pools_t *pParentPool;
-    pools_t *pool;
+#endif /*MEM_TRACKING || MEM_TRACE*/
+    memStatus_t status = MEM_FREE_ERROR_c;
+    pools_t *pCompactPool;
     
     if( buffer == NULL )
     {
         return MEM_FREE_ERROR_c;
     }
     
-    pHeader = (listHeader_t *)buffer-1;
+    /* The compact pool is looked up once, for all the checks below */
+    pCompactPool = MEM_GetCompactPool(buffer);
     
-    if( ((uint8_t*)pHeader < (uint8_t*)memHeap) || ((uint8_t*)pHeader > ((uint8_t*)memHeap + sizeof(memHeap))) )
-    {
-#ifdef MEM_DEBUG_INVALID_POINTERS
-        panic( 0, (uint32_t)MEM_BufferFree, 0, 0);
-#endif
-        return MEM_FREE_ERROR_c;
-    }
-
+    /* Blocks are split and coalesced with interrupts disabled, which rewrites
+       their headers. Validate the buffer in the same critical section. */
     OSA_InterruptDisable();
     
-    pParentPool = (pools_t *)pHeader->pParentPool;
-    pool = memPools;
-
-    for(;;)
+    if( MEM_BufferIsValid(buffer, pCompactPool) )
     {
-        if (pParentPool == pool)
+        uint8_t *pRefCount = MEM_GetRefCount(buffer, pCompactPool);
+        
+        if( pRefCount && *pRefCount )
         {
-            break;
+            /* The buffer is still referenced. Only drop one reference. */
+            (*pRefCount)--;
+            status = MEM_SUCCESS_c;
         }
-        if(pool->nextBlockSize == 0)
+        else
         {
-            /* The parent pool was not found! This means that the memory buffer is corrupt or
-            that the MEM_BufferFree() function was called with an invalid parameter */
-#ifdef MEM_STATISTICS
-            pParentPool->poolStatistics.freeFailures++;
-#endif /*MEM_STATISTICS*/
-            OSA_InterruptEnable();
-#ifdef MEM_DEBUG_INVALID_POINTERS
-            panic( 0, (uint32_t)MEM_BufferFree, 0, 0);
-#endif
-            return MEM_FREE_ERROR_c;
+            status = MEM_BufferFreeToPool(buffer, pCompactPool);
+            
+#ifdef MEM_TRACKING
+            if( MEM_SUCCESS_c == status )
+            {
+                MEM_Track(buffer, MEM_TRACKING_FREE_c, savedLR, 0, NULL);
+            }
+#endif /*MEM_TRACKING*/
         }
-        pool++;
+#ifdef MEM_TRACE
+        MEM_Trace((MEM_SUCCESS_c == status) ? MEM_TRACE_FREE_c : MEM_TRACE_FREE_ERROR_c, buffer, (void*)savedLR, 0);
+#endif
     }
-    
-    if( pHeader->link.list != NULL )
+#ifdef MEM_TRACE
+    else
     {
-        /* The memory buffer appears to be enqueued in a linked list.
-        This list may be the free memory buffers pool, or another list. */
-#ifdef MEM_STATISTICS
-        pParentPool->poolStatistics.freeFailures++;
-#endif /*MEM_STATISTICS*/
-        OSA_InterruptEnable();
-#ifdef MEM_DEBUG_INVALID_POINTERS
-        panic( 0, (uint32_t)MEM_BufferFree, 0, 0);
-#endif
-        return MEM_FREE_ERROR_c;
+        MEM_Trace(MEM_TRACE_FREE_ERROR_c, buffer, (void*)savedLR, 0);
     }
+#endif
     
-    gFreeMessagesCount++;
-    
-    ListAddTail((listHandle_t)&pParentPool->anchor, (listElementHandle_t)&pHeader->link);
-    pParentPool->allocatedBlocks--;
-    
-#ifdef MEM_STATISTICS
-    MEM_ASSERT(pParentPool->poolStatistics.allocatedBlocks > 0);
-    pParentPool->poolStatistics.allocatedBlocks--;
-#endif /*MEM_STATISTICS*/
-    
-#ifdef MEM_TRACKING
-    MEM_Track(buffer, MEM_TRACKING_FREE_c, savedLR, 0, NULL);
-#endif /*MEM_TRACKING*/
     OSA_InterruptEnable();
-    return MEM_SUCCESS_c;
+    
+#ifdef MEM_DEBUG_INVALID_POINTERS
+    if( MEM_SUCCESS_c != status )
+    {
+        panic( 0, (uint32_t)MEM_BufferFree, 0, 0);
+    }
+#endif
+    return status;
 }
 
 /*! *********************************************************************************
-* \brief     Determines the size of a memory block
+* \brief     Deallocate multiple memory blocks, using a single critical section.
+*            NULL entries are ignored.
 *
-* \param[in] buffer - Pointer to buffer.
+* \param[in] ppBuffers - Array of buffers to deallocate.
+* \param[in] count - Number of entries in the array.
 *
-* \return size of memory block
+* \return MEM_SUCCESS_c if all buffers were deallocated, MEM_FREE_ERROR_c if at
+*         least one of them could not be deallocated.
 *
 * \pre Memory manager must be previously initialized.
 *
+* \remarks Never deallocate the same buffer twice.
+*
 ********************************************************************************** */
-uint16_t MEM_BufferGetSize
+memStatus_t MEM_BufferFreeBatch
 (
-void* buffer /* IN: Block of memory to free*/
+void **ppBuffers,
+uint32_t count
 )
 {
-    if( buffer )
-    {
-        return ((pools_t *)((listHeader_t *)buffer-1)->pParentPool)->blockSize;
-    }
-
-    return 0;
-}
+#if defined(MEM_TRACKING) || defined(MEM_TRACE)
+    /* Save the Link Register */
+    volatile uint32_t savedLR = (uint32_t) __get_LR();
+#endif /*MEM_TRACKING || MEM_TRACE*/
+    memStatus_t status = MEM_SUCCESS_c;
+    pools_t *pCompactPool;
+    uint8_t *pRefCount;
+    uint32_t i;
 
-/*! *********************************************************************************
-*************************************************************************************
-* Private functions
-*************************************************************************************
-********************************************************************************** */
-/*! *********************************************************************************
-* \brief     This function updates the tracking array element corresponding to the given
-*            block.
-*
-* \param[in] block - Pointer to the block.
-* \param[in] alloc - Indicates whether an allocation or free operation was performed
-* \param[in] address - Address where MEM_BufferAlloc or MEM_BufferFree was called
-* \param[in] requestedSize - Indicates the requested buffer size  passed to MEM_BufferAlloc.
-*                            Has no use if a free operation was performed.
-*
-* \return Returns TRUE if correct allocation or dealocation was performed, FALSE if a
+    OSA_InterruptDisable();
+    
+    for( i = 0; i < count; i++ )
+    {
+        if( NULL == ppBuffers[i] )
+        {
+            continue;
+        }
+        
+        pCompactPool = MEM_GetCompactPool(ppBuffers[i]);
+        
+        if( !MEM_BufferIsValid(ppBuffers[i], pCompactPool) )
+        {
+#ifdef MEM_TRACE
+            MEM_Trace(MEM_TRACE_FREE_ERROR_c, ppBuffers[i], (void*)savedLR, 0);
+#endif
+            status = MEM_FREE_ERROR_c;
+            continue;
+        }
+        
+        pRefCount = MEM_GetRefCount(ppBuffers[i], pCompactPool);
+        if( pRefCount && *pRefCount )
+        {
+            /* The buffer is still referenced. Only drop one reference. */
+            (*pRefCount)--;
+#ifdef MEM_TRACE
+            MEM_Trace(MEM_TRACE_FREE_c, ppBuffers[i], (void*)savedLR, 0);
+#endif
+            continue;
+        }
+        
+        if( MEM_SUCCESS_c != MEM_BufferFreeToPool(ppBuffers[i], pCompactPool) )
+        {
+#ifdef MEM_TRACE
+            MEM_Trace(MEM_TRACE_FREE_ERROR_c, ppBuffers[i], (void*)savedLR, 0);
+#endif
+            status = MEM_FREE_ERROR_c;
+            continue;
+        }
+        
+#ifdef MEM_TRACKING
+        MEM_Track(ppBuffers[i], MEM_TRACKING_FREE_c, savedLR, 0, NULL);
+#endif /*MEM_TRACKING*/
+#ifdef MEM_TRACE
+        MEM_Trace(MEM_TRACE_FREE_c, ppBuffers[i], (void*)savedLR, 0);
+#endif
+    }
+    
+    OSA_InterruptEnable();
+    
+#ifdef MEM_DEBUG_INVALID_POINTERS
+    if( MEM_SUCCESS_c != status )
+    {
+        panic( 0, (uint32_t)MEM_BufferFreeBatch, 0, 0);
+    }
+#endif
+    return status;
+}
+
+/*! *********************************************************************************
+* \brief     Adds a reference to an allocated buffer. The buffer returns to its pool
+*            only after MEM_BufferFree() was called once for the initial allocation
+*            and once for every MEM_BufferRetain().
+*
+* \param[in] buffer - Pointer to an allocated buffer.
+*
+* \return MEM_SUCCESS_c if the reference was added, MEM_FREE_ERROR_c if the buffer is
+*         invalid, is not allocated or has too many references.
+*
+* \pre Memory manager must be previously initialized.
+*
+********************************************************************************** */
+memStatus_t MEM_BufferRetain
+(
+void* buffer /* IN: Block of memory to reference*/
+)
+{
+#ifdef MEM_TRACE
+    /* Save the Link Register */
+    volatile uint32_t savedLR = (uint32_t) __get_LR();
+#endif /*MEM_TRACE*/
+    memStatus_t status = MEM_FREE_ERROR_c;
+    listHeader_t *pHeader = (listHeader_t *)buffer-1;
+    pools_t *pPool;
+    uint8_t *pRefCount;
+    uint32_t blockIndex;
+    bool_t isFree;
+
+    pPool = MEM_GetCompactPool(buffer);
+
+    /* See MEM_BufferFree() */
+    OSA_InterruptDisable();
+
+    if( MEM_BufferIsValid(buffer, pPool) )
+    {
+        pRefCount = MEM_GetRefCount(buffer, pPool);
+
+        /* Free blocks cannot be referenced. Allocated blocks may be enqueued in
+           other lists. */
+        if( pPool )
+        {
+            (void)MEM_GetCompactBlockIndex(pPool, buffer, &blockIndex);
+            isFree = (mMemBitmapWord(blockIndex) & mMemBitmapMask(blockIndex)) != 0;
+        }
+        else
+        {
+            isFree = (pHeader->link.list == (listHandle_t)&pHeader->pParentPool->anchor);
+        }
+
+        if( pRefCount && !isFree && (*pRefCount < 0xFF) )
+        {
+            (*pRefCount)++;
+            status = MEM_SUCCESS_c;
+#ifdef MEM_TRACE
+            MEM_Trace(MEM_TRACE_RETAIN_c, buffer, (void*)savedLR, 0);
+#endif
+        }
+    }
+
+    OSA_InterruptEnable();
+
+    return status;
+}
+
+/*! *********************************************************************************
+* \brief     Determines the size of a memory block
+*
+* \param[in] buffer - Pointer to buffer.
+*
+* \return size of memory block
+*
+* \pre Memory manager must be previously initialized.
+*
+********************************************************************************** */
+uint16_t MEM_BufferGetSize
+(
+void* buffer /* IN: Block of memory to free*/
+)
+{
+    if( buffer )
+    {
+        return MEM_GetParentPool(buffer)->blockSize;
+    }
+
+    return 0;
+}
+
+#ifdef MEM_STATISTICS
+/*! *********************************************************************************
+* \brief     Writes the statistics of every pool to a serial interface, followed by a
+*            PoolsDetails_c definition sized from the observed peaks. Each pool gets
+*            MEM_PoolsReportHeadroom_c percent of its peak usage as headroom, at least
+*            one block. Pools with allocation failures get twice the headroom, since
+*            their peak only shows the blocks they had; they are marked with '*'.
+*
+* \param[in] interfaceId - The SerialManager interface.
+*
+* \pre Memory manager must be previously initialized.
+*
+********************************************************************************** */
+void MEM_PoolsReport
+(
+uint8_t interfaceId
+)
+{
+    pools_t *pPool;
+    poolStat_t stats;
+    uint32_t i, headroom, count;
+    uint8_t recommended[NumberOfElements(memPools)];
+
+    (void)Serial_Print(interfaceId, "\r\nSize Blocks Used Peak Fail Rec\r\n", gAllowToBlock_d);
+
+    for( i = 0; i < NumberOfElements(memPools); i++ )
+    {
+        pPool = &memPools[i];
+
+        OSA_InterruptDisable();
+        stats = pPool->poolStatistics;
+        OSA_InterruptEnable();
+
+        headroom = (stats.allocatedBlocksPeak * MEM_PoolsReportHeadroom_c + 99) / 100;
+        if( 0 == headroom )
+        {
+            headroom = 1;
+        }
+        if( stats.allocationFailures )
+        {
+            headroom *= 2;
+        }
+
+        count = stats.allocatedBlocksPeak + headroom;
+        if( count <= pPool->reservedBlocks )
+        {
+            count = pPool->reservedBlocks + 1;
+        }
+        recommended[i] = (count > 0xFF) ? 0xFF : count;
+
+        (void)Serial_PrintDec(interfaceId, pPool->blockSize);
+        (void)Serial_Print(interfaceId, " ", gAllowToBlock_d);
+        (void)Serial_PrintDec(interfaceId, stats.numBlocks);
+        (void)Serial_Print(interfaceId, " ", gAllowToBlock_d);
+        (void)Serial_PrintDec(interfaceId, stats.allocatedBlocks);
+        (void)Serial_Print(interfaceId, " ", gAllowToBlock_d);
+        (void)Serial_PrintDec(interfaceId, stats.allocatedBlocksPeak);
+        (void)Serial_Print(interfaceId, " ", gAllowToBlock_d);
+        (void)Serial_PrintDec(interfaceId, stats.allocationFailures);
+        (void)Serial_Print(interfaceId, " ", gAllowToBlock_d);
+        (void)Serial_PrintDec(interfaceId, recommended[i]);
+        (void)Serial_Print(interfaceId, stats.allocationFailures ? "*\r\n" : "\r\n", gAllowToBlock_d);
+    }
+
+    (void)Serial_Print(interfaceId, "Min free ", gAllowToBlock_d);
+    (void)Serial_PrintDec(interfaceId, gFreeMessagesCountMin);
+    (void)Serial_Print(interfaceId, "\r\n#define PoolsDetails_c", gAllowToBlock_d);
+
+    for( i = 0; i < NumberOfElements(memPools); i++ )
+    {
+        pPool = &memPools[i];
+
+        if( pPool->compact )
+        {
+            (void)Serial_Print(interfaceId, " _compact_block_size_(", gAllowToBlock_d);
+            (void)Serial_PrintDec(interfaceId, pPool->headerSize);
+            (void)Serial_Print(interfaceId, ") ", gAllowToBlock_d);
+        }
+        else
+        {
+            (void)Serial_Print(interfaceId, " _block_size_ ", gAllowToBlock_d);
+        }
+        (void)Serial_PrintDec(interfaceId, pPool->blockSize);
+        (void)Serial_Print(interfaceId, " _number_of_blocks_ ", gAllowToBlock_d);
+        (void)Serial_PrintDec(interfaceId, recommended[i]);
+        if( pPool->poolId )
+        {
+            (void)Serial_Print(interfaceId, " _pool_id_(", gAllowToBlock_d);
+            (void)Serial_PrintDec(interfaceId, pPool->poolId);
+            (void)Serial_Print(interfaceId, ")", gAllowToBlock_d);
+        }
+        if( pPool->reservedBlocks )
+        {
+            (void)Serial_Print(interfaceId, " _reserved_blocks_(", gAllowToBlock_d);
+            (void)Serial_PrintDec(interfaceId, pPool->reservedBlocks);
+            (void)Serial_Print(interfaceId, ")", gAllowToBlock_d);
+        }
+        (void)Serial_Print(interfaceId, " _eol_", gAllowToBlock_d);
+    }
+
+    (void)Serial_Print(interfaceId, "\r\n", gAllowToBlock_d);
+}
+#endif /*MEM_STATISTICS*/
+
+#ifdef MEM_TRACE
+/*! *********************************************************************************
+* \brief     Writes the trace ring to a serial interface: a memTraceHeader_t, followed
+*            by the records from the oldest to the newest. Recording is paused while
+*            the records are written, and the operations performed meanwhile are lost.
+*
+* \param[in] interfaceId - The SerialManager interface.
+*
+* \return MEM_SUCCESS_c if the trace was written, MEM_UNKNOWN_ERROR_c otherwise.
+*
+* \pre Memory manager must be previously initialized.
+*
+********************************************************************************** */
+memStatus_t MEM_TraceDump
+(
+uint8_t interfaceId
+)
+{
+    memTraceHeader_t header;
+    uint32_t first, count;
+    serialStatus_t status;
+
+    OSA_InterruptDisable();
+    memTracePaused = TRUE;
+    OSA_InterruptEnable();
+
+    count = (memTraceSequence < MEM_TraceRingSize_c) ? memTraceSequence : MEM_TraceRingSize_c;
+    first = (memTraceSequence - count) & (MEM_TraceRingSize_c - 1);
+
+    header.magic = mMemTraceMagic_c;
+    header.sequence = memTraceSequence;
+    header.heapStart = (uint32_t)memHeap;
+    header.recordSize = sizeof(memTraceRecord_t);
+    header.recordCount = count;
+
+    status = Serial_SyncWrite(interfaceId, (uint8_t*)&header, sizeof(header));
+
+    if( (gSerial_Success_c == status) && (first + count > MEM_TraceRingSize_c) )
+    {
+        /* The oldest records are at the end of the ring */
+        status = Serial_SyncWrite(interfaceId, (uint8_t*)&memTraceRing[first],
+                                  (MEM_TraceRingSize_c - first) * sizeof(memTraceRecord_t));
+        count -= MEM_TraceRingSize_c - first;
+        first = 0;
+    }
+
+    if( (gSerial_Success_c == status) && count )
+    {
+        status = Serial_SyncWrite(interfaceId, (uint8_t*)&memTraceRing[first],
+                                  count * sizeof(memTraceRecord_t));
+    }
+
+    memTracePaused = FALSE;
+
+    return (gSerial_Success_c == status) ? MEM_SUCCESS_c : MEM_UNKNOWN_ERROR_c;
+}
+#endif /*MEM_TRACE*/
+
+/*! *********************************************************************************
+*************************************************************************************
+* Private functions
+*************************************************************************************
+********************************************************************************** */
+/*! *********************************************************************************
+* \brief     This function builds the size class table used by MEM_BufferAllocWithId.
+*            Each size class is mapped to the first pool (in PoolsDetails_c order)
+*            having a block size greater or equal to the size class.
+*
+********************************************************************************** */
+static void MEM_InitSizeClasses(void)
+{
+    uint32_t sizeClass = 0;
+    uint32_t size;
+    uint8_t  poolIdx;
+
+    memMaxBlockSize = 0;
+
+    while( sizeClass < NumberOfElements(memSizeClass) )
+    {
+        size = (sizeClass + 1) << mMemSizeClassShift_c;
+
+        for( poolIdx = 0; poolIdx < NumberOfElements(memPools); poolIdx++ )
+        {
+            if( size <= memPools[poolIdx].blockSize )
+            {
+                break;
+            }
+        }
+
+        if( poolIdx == NumberOfElements(memPools) )
+        {
+            break;
+        }
+
+        memSizeClass[sizeClass++] = poolIdx;
+        memMaxBlockSize = size;
+    }
+}
+
+/*! *********************************************************************************
+* \brief     This function returns the first pool to be searched for a free block
+*            of the requested size, using the size class table.
+*
+* \param[in] numBytes - Size of buffer to allocate.
+* \param[in] poolId - The ID of the pool where to search for a free buffer.
+*
+* \return Pointer to the first candidate pool, NULL if no pool can hold the buffer.
+*
+********************************************************************************** */
+static pools_t* MEM_GetFirstPool(uint32_t numBytes, uint8_t poolId)
+{
+    pools_t *pPools;
+
+    if( (numBytes == 0) || (numBytes > memMaxBlockSize) )
+    {
+        return NULL;
+    }
+
+    /* Jump directly to the first pool that can hold the requested size.
+       Pools with a different Id fall back to a search from the first pool. */
+    pPools = &memPools[memSizeClass[(numBytes - 1) >> mMemSizeClassShift_c]];
+    if( pPools->poolId != (poolId & ~MEM_CriticalAllocFlag_c) )
+    {
+        pPools = memPools;
+    }
+
+    return pPools;
+}
+
+/*! *********************************************************************************
+* \brief     Removes a free block from the first pool, starting with pPools, that
+*            matches the requested size and pool Id. Must be called with interrupts
+*            disabled.
+*
+* \param[in] pPools - The first pool to search, as returned by MEM_GetFirstPool().
+* \param[in] numBytes - Size of buffer to allocate.
+* \param[in] poolId - The ID of the pool where to search for a free buffer. If
+*                     MEM_CriticalAllocFlag_c is set, the reserved blocks may be used.
+*
+* \return Pointer to the allocated buffer, NULL if failed.
+*
+********************************************************************************** */
+static void* MEM_BufferAllocFromPools(pools_t *pPools, uint32_t numBytes, uint8_t poolId)
+{
+#ifdef MEM_STATISTICS
+    bool_t allocFailure = FALSE;
+#endif
+#ifdef MEM_POOL_SPLITTING
+    pools_t *pFirstPool = NULL;
+#endif
+    bool_t critical = (poolId & MEM_CriticalAllocFlag_c) != 0;
+    uint32_t freeBlocks;
+    listHeader_t *pBlock;
+
+    if( NULL == pPools )
+    {
+        return NULL;
+    }
+
+    poolId &= ~MEM_CriticalAllocFlag_c;
+
+    for(;;)
+    {
+        if( (numBytes <= pPools->blockSize) && (poolId == pPools->poolId) )
+        {
+#ifdef MEM_POOL_SPLITTING
+            if( NULL == pFirstPool )
+            {
+                pFirstPool = pPools;
+            }
+#endif
+            if( pPools->compact )
+            {
+                freeBlocks = pPools->numBlocks - pPools->allocatedBlocks;
+            }
+            else
+            {
+                freeBlocks = ListGetSize((listHandle_t)&pPools->anchor);
+            }
+
+            if( (freeBlocks <= pPools->reservedBlocks) && !critical )
+            {
+                /* Only the reserved blocks are left */
+                pBlock = NULL;
+            }
+            else if( pPools->compact )
+            {
+                pBlock = MEM_CompactBlockAlloc(pPools);
+            }
+            else
+            {
+                pBlock = (listHeader_t *)ListRemoveHead((listHandle_t)&pPools->anchor);
+            }
+
+#ifdef MEM_STATISTICS
+            if( critical && pPools->reservedBlocks && (freeBlocks <= pPools->reservedBlocks) )
+            {
+                if( NULL != pBlock )
+                {
+                    pPools->poolStatistics.reserveHits++;
+                }
+                else
+                {
+                    pPools->poolStatistics.reserveMisses++;
+                }
+            }
+#endif /*MEM_STATISTICS*/
+            
+            if(NULL != pBlock)
+            {
+#ifdef MEM_POOL_SPLITTING
+                if( (pPools != pFirstPool) && !pPools->compact && !pFirstPool->compact )
+                {
+                    /* The first pool is exhausted. Split the bigger free block into blocks
+                       of the first pool, rather than using it for a single allocation.
+                       The first pool may still hold its reserved blocks, so the block
+                       is taken from the new ones. */
+                    listHeader_t *pCarvedBlock = MEM_SplitBlock(pBlock, pPools, pFirstPool);
+                    
+                    if( NULL != pCarvedBlock )
+                    {
+                        pPools = pFirstPool;
+                        pBlock = pCarvedBlock;
+                    }
+                }
+
+                if( ((uint8_t*)pBlock < pPools->pHeapStart) || ((uint8_t*)pBlock >= pPools->pHeapEnd) )
+                {
+                    MEM_UpdateSplitBlock(pBlock, TRUE);
+                }
+#endif /*MEM_POOL_SPLITTING*/
+                gFreeMessagesCount--;
+                pPools->allocatedBlocks++;
+                
+#ifdef MEM_STATISTICS
+                if(gFreeMessagesCount < gFreeMessagesCountMin)
+                {
+                    gFreeMessagesCountMin = gFreeMessagesCount;
+                }
+                
+                pPools->poolStatistics.allocatedBlocks++;
+                if ( pPools->poolStatistics.allocatedBlocks > pPools->poolStatistics.allocatedBlocksPeak )
+                {
+                    pPools->poolStatistics.allocatedBlocksPeak = pPools->poolStatistics.allocatedBlocks;
+                }
+                MEM_ASSERT(pPools->poolStatistics.allocatedBlocks <= pPools->poolStatistics.numBlocks);
+#endif /*MEM_STATISTICS*/
+                /* Skip the block header */
+                return (uint8_t*)pBlock + pPools->headerSize;
+            }
+            else
+            {
+#ifdef MEM_STATISTICS
+                if(!allocFailure)
+                {
+                    pPools->poolStatistics.allocationFailures++;
+                    allocFailure = TRUE;
+                }
+#endif /*MEM_STATISTICS*/
+                if(numBytes > pPools->nextBlockSize) 
+                {
+                    break;
+                }
+                /* No more blocks of that size, try next size. */
+                numBytes = pPools->nextBlockSize;   
+            }
+        }
+        /* Try next pool*/
+        if(pPools->nextBlockSize)
+        {
+            pPools++;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+/*! *********************************************************************************
+* \brief     Puts a block back into its parent pool. The block must have been
+*            validated with MEM_BufferIsValid(). Must be called with interrupts
+*            disabled.
+*
+* \param[in] buffer - Pointer to buffer to deallocate.
+* \param[in] pCompactPool - The compact pool of the buffer, as returned by
+*                           MEM_GetCompactPool(). NULL for the other pools.
+*
+* \return MEM_SUCCESS_c if deallocation was successful, MEM_FREE_ERROR_c if not.
+*
+********************************************************************************** */
+static memStatus_t MEM_BufferFreeToPool(void* buffer, pools_t *pCompactPool)
+{
+    listHeader_t *pHeader = (listHeader_t *)buffer-1;
+    pools_t *pParentPool = pCompactPool;
+    uint32_t blockIndex;
+
+    if( pParentPool )
+    {
+        (void)MEM_GetCompactBlockIndex(pParentPool, buffer, &blockIndex);
+        if( mMemBitmapWord(blockIndex) & mMemBitmapMask(blockIndex) )
+        {
+            /* The block is already free */
+#ifdef MEM_STATISTICS
+            pParentPool->poolStatistics.freeFailures++;
+#endif /*MEM_STATISTICS*/
+            return MEM_FREE_ERROR_c;
+        }
+        
+        mMemBitmapWord(blockIndex) |= mMemBitmapMask(blockIndex);
+    }
+    else
+    {
+        pParentPool = (pools_t *)pHeader->pParentPool;
+        
+        if( pHeader->link.list != NULL )
+        {
+            /* The memory buffer appears to be enqueued in a linked list.
+            This list may be the free memory buffers pool, or another list. */
+#ifdef MEM_STATISTICS
+            pParentPool->poolStatistics.freeFailures++;
+#endif /*MEM_STATISTICS*/
+            return MEM_FREE_ERROR_c;
+        }
+        
+        ListAddTail((listHandle_t)&pParentPool->anchor, (listElementHandle_t)&pHeader->link);
+    }
+    
+    gFreeMessagesCount++;
+    pParentPool->allocatedBlocks--;
+    
+#ifdef MEM_STATISTICS
+    MEM_ASSERT(pParentPool->poolStatistics.allocatedBlocks > 0);
+    pParentPool->poolStatistics.allocatedBlocks--;
+#endif /*MEM_STATISTICS*/
+
+#ifdef MEM_POOL_SPLITTING
+    if( !pParentPool->compact &&
+        (((uint8_t*)pHeader < pParentPool->pHeapStart) || ((uint8_t*)pHeader >= pParentPool->pHeapEnd)) )
+    {
+        MEM_UpdateSplitBlock(pHeader, FALSE);
+    }
+#endif /*MEM_POOL_SPLITTING*/
+
+    return MEM_SUCCESS_c;
+}
+
+/*! *********************************************************************************
+* \brief     This function checks that a buffer is located at the start of a block
+*            from the memory heap, and that the block belongs to a valid pool. Must
+*            be called with interrupts disabled, since the headers of the blocks are
+*            rewritten when they are split or coalesced.
+*
+* \param[in] buffer - Pointer to buffer.
+* \param[in] pCompactPool - The compact pool of the buffer, as returned by
+*                           MEM_GetCompactPool(). NULL for the other pools.
+*
+* \return Returns TRUE if the buffer is valid, FALSE otherwise.
+*
+********************************************************************************** */
+static bool_t MEM_BufferIsValid(void* buffer, pools_t *pCompactPool)
+{
+    listHeader_t *pHeader = (listHeader_t *)buffer-1;
+    pools_t *pPool;
+    uint32_t offset;
+    uint32_t blockIndex;
+
+    if( (buffer == NULL) ||
+        ((uint8_t*)buffer < (uint8_t*)memHeap) || ((uint8_t*)buffer >= ((uint8_t*)memHeap + sizeof(memHeap))) )
+    {
+        return FALSE;
+    }
+
+    /* Compact blocks have no parent pool pointer */
+    if( pCompactPool )
+    {
+        return MEM_GetCompactBlockIndex(pCompactPool, buffer, &blockIndex);
+    }
+
+    if( (uint8_t*)pHeader < (uint8_t*)memHeap )
+    {
+        return FALSE;
+    }
+
+    /* The parent pool must be one of the memPools entries */
+    pPool = pHeader->pParentPool;
+    offset = (uint8_t*)pPool - (uint8_t*)memPools;
+    if( (offset >= sizeof(memPools)) || (offset % sizeof(pools_t)) || pPool->compact )
+    {
+        return FALSE;
+    }
+
+    /* The header must be inside the heap range of the parent pool, at a block boundary */
+    if( ((uint8_t*)pHeader < pPool->pHeapStart) || ((uint8_t*)pHeader >= pPool->pHeapEnd) )
+    {
+#ifdef MEM_POOL_SPLITTING
+        /* The block may have been carved out of a bigger block */
+        return MEM_SplitBlockIsValid(pHeader);
+#else
+        return FALSE;
+#endif
+    }
+
+    offset = (uint8_t*)pHeader - pPool->pHeapStart;
+
+    return (offset % (pPool->blockSize + sizeof(listHeader_t))) == 0;
+}
+
+/*! *********************************************************************************
+* \brief     This function returns the reference counter of a block. The buffer must
+*            have been validated with MEM_BufferIsValid().
+*
+* \param[in] buffer - Pointer to buffer.
+* \param[in] pCompactPool - The compact pool of the buffer, as returned by
+*                           MEM_GetCompactPool(). NULL for the other pools.
+*
+* \return Pointer to the number of extra references held on the block, NULL if
+*         the block was carved out of a bigger block and cannot be referenced.
+*
+********************************************************************************** */
+static uint8_t* MEM_GetRefCount(void* buffer, pools_t *pCompactPool)
+{
+    listHeader_t *pHeader = (listHeader_t *)buffer-1;
+    pools_t *pPool;
+    uint32_t blockIndex;
+
+    if( pCompactPool )
+    {
+        (void)MEM_GetCompactBlockIndex(pCompactPool, buffer, &blockIndex);
+        return &memRefCount[blockIndex];
+    }
+
+    pPool = pHeader->pParentPool;
+    if( ((uint8_t*)pHeader < pPool->pHeapStart) || ((uint8_t*)pHeader >= pPool->pHeapEnd) )
+    {
+        return NULL;
+    }
+
+    blockIndex = ((uint8_t*)pHeader - pPool->pHeapStart) / (pPool->blockSize + sizeof(listHeader_t));
+
+    return &memRefCount[pPool->firstBlockIndex + blockIndex];
+}
+
+/*! *********************************************************************************
+* \brief     This function returns the pool of a buffer. The buffer must have been
+*            validated with MEM_BufferIsValid().
+*
+* \param[in] buffer - Pointer to buffer.
+*
+* \return Pointer to the parent pool of the buffer.
+*
+********************************************************************************** */
+static pools_t* MEM_GetParentPool(void* buffer)
+{
+    pools_t *pPool = MEM_GetCompactPool(buffer);
+
+    if( NULL == pPool )
+    {
+        pPool = ((listHeader_t *)buffer-1)->pParentPool;
+    }
+
+    return pPool;
+}
+
+/*! *********************************************************************************
+* \brief     This function returns the compact pool whose heap range contains the
+*            given address.
+*
+* \param[in] buffer - Pointer to buffer.
+*
+* \return Pointer to the compact pool, NULL if the address is not located in the
+*         heap range of a compact pool.
+*
+********************************************************************************** */
+static pools_t* MEM_GetCompactPool(void* buffer)
+{
+    pools_t *pPool = memPools;
+
+    if( 0 == memCompactPoolCount )
+    {
+        return NULL;
+    }
+
+    for(;;)
+    {
+        if( pPool->compact &&
+            ((uint8_t*)buffer >= pPool->pHeapStart) && ((uint8_t*)buffer < pPool->pHeapEnd) )
+        {
+            return pPool;
+        }
+
+        if( 0 == pPool->nextBlockSize )
+        {
+            break;
+        }
+
+        pPool++;
+    }
+
+    return NULL;
+}
+
+/*! *********************************************************************************
+* \brief     This function checks that a buffer is located at the start of a block of
+*            a compact pool, and computes the heap order index of the block.
+*
+* \param[in]  pPool - The compact pool, as returned by MEM_GetCompactPool().
+* \param[in]  buffer - Pointer to buffer.
+* \param[out] pBlockIndex - Heap order index of the block.
+*
+* \return Returns TRUE if the buffer is valid, FALSE otherwise.
+*
+********************************************************************************** */
+static bool_t MEM_GetCompactBlockIndex(pools_t *pPool, void* buffer, uint32_t *pBlockIndex)
+{
+    uint32_t stride = pPool->blockSize + pPool->headerSize;
+    uint32_t offset = (uint8_t*)buffer - pPool->pHeapStart;
+    compactHeader_t *pHeader = (compactHeader_t *)buffer-1;
+
+    if( 0 == pPool->headerSize )
+    {
+        *pBlockIndex = pPool->firstBlockIndex + offset / stride;
+        return (offset % stride) == 0;
+    }
+
+    *pBlockIndex = pPool->firstBlockIndex;
+
+    if( offset < sizeof(compactHeader_t) )
+    {
+        return FALSE;
+    }
+
+    /* The header holds the block index, which avoids the division */
+    if( (pHeader->check != (uint16_t)~pHeader->blockIndex) ||
+        (pHeader->blockIndex < pPool->firstBlockIndex) ||
+        (pHeader->blockIndex >= pPool->firstBlockIndex + pPool->numBlocks) ||
+        (offset != (pHeader->blockIndex - pPool->firstBlockIndex) * stride + sizeof(compactHeader_t)) )
+    {
+        /* The header was overwritten, or the buffer is not at the start of a block */
+        return FALSE;
+    }
+
+    *pBlockIndex = pHeader->blockIndex;
+    return TRUE;
+}
+
+/*! *********************************************************************************
+* \brief     Removes the first free block from a compact pool. Must be called with
+*            interrupts disabled.
+*
+* \param[in] pPool - The compact pool.
+*
+* \return Pointer to the start of the block, including its header. NULL if the pool
+*         has no free block.
+*
+********************************************************************************** */
+static void* MEM_CompactBlockAlloc(pools_t *pPool)
+{
+    uint32_t blockIndex = pPool->firstBlockIndex;
+    uint32_t lastIndex = blockIndex + pPool->numBlocks;
+    uint32_t word;
+
+    while( blockIndex < lastIndex )
+    {
+        word = mMemBitmapWord(blockIndex) >> (blockIndex & 0x1F);
+
+        if( 0 == word )
+        {
+            /* No free block left in this word */
+            blockIndex = (blockIndex | 0x1F) + 1;
+            continue;
+        }
+
+        while( 0 == (word & 0x0F) )
+        {
+            word >>= 4;
+            blockIndex += 4;
+        }
+
+        while( 0 == (word & 1) )
+        {
+            word >>= 1;
+            blockIndex++;
+        }
+
+        /* The bit may belong to the next pool */
+        if( blockIndex >= lastIndex )
+        {
+            break;
+        }
+
+        mMemBitmapWord(blockIndex) &= ~mMemBitmapMask(blockIndex);
+
+        return pPool->pHeapStart + (blockIndex - pPool->firstBlockIndex) * (pPool->blockSize + pPool->headerSize);
+    }
+
+    return NULL;
+}
+
+#ifdef MEM_POOL_SPLITTING
+/*! *********************************************************************************
+* \brief     Splits a free block of a bigger pool into free blocks of a smaller pool.
+*            All the new blocks but the first one are added to the free list of the
+*            smaller pool. Must be called with interrupts disabled.
+*
+* \param[in] pBlock - Header of the free block, already removed from its pool.
+* \param[in] pDonorPool - The pool of the free block.
+* \param[in] pPool - The pool that receives the new blocks.
+*
+* \return Header of the first new block, which is not in the free list and is
+*         counted as free until the caller allocates it. If NULL is returned, the
+*         block fits less than two blocks of the smaller pool and is left untouched.
+*
+********************************************************************************** */
+static listHeader_t* MEM_SplitBlock(listHeader_t *pBlock, pools_t *pDonorPool, pools_t *pPool)
+{
+    uint32_t stride = pPool->blockSize + sizeof(listHeader_t);
+    uint32_t count = (pDonorPool->blockSize + sizeof(listHeader_t)) / stride;
+    uint32_t donorIndex = ((uint8_t*)pBlock - pDonorPool->pHeapStart) / (pDonorPool->blockSize + sizeof(listHeader_t));
+    uint8_t *pHeap = (uint8_t*)pBlock;
+    uint32_t i;
+
+    if( count < 2 )
+    {
+        return NULL;
+    }
+
+    memSplitState[pDonorPool->firstBlockIndex + donorIndex] = 1;
+    pDonorPool->numBlocks--;
+    pPool->numBlocks += count;
+    pPool->anchor.max += count;
+    /* The donor block is no longer free, and count blocks are added */
+    gFreeMessagesCount += count - 1;
+
+    /* The first block shares the header of the donor block, which is not in a list */
+    pBlock->pParentPool = pPool;
+
+    for( i = 1; i < count; i++ )
+    {
+        pHeap += stride;
+        ((listHeader_t *)pHeap)->pParentPool = pPool;
+        ListAddTail((listHandle_t)&pPool->anchor, (listElementHandle_t)&((listHeader_t *)pHeap)->link);
+    }
+
+#ifdef MEM_STATISTICS
+    pDonorPool->poolStatistics.numBlocks--;
+    pDonorPool->poolStatistics.splitCount++;
+    pPool->poolStatistics.numBlocks += count;
+#endif /*MEM_STATISTICS*/
+
+    return pBlock;
+}
+
+/*! *********************************************************************************
+* \brief     Returns the donor block that contains the given address.
+*
+* \param[in]  pHeader - Address inside the memory heap.
+* \param[out] ppDonorPool - The pool of the donor block.
+* \param[out] pDonorIndex - Heap order index of the donor block.
+*
+* \return Header of the donor block.
+*
+********************************************************************************** */
+static listHeader_t* MEM_GetDonorBlock(listHeader_t *pHeader, pools_t **ppDonorPool, uint32_t *pDonorIndex)
+{
+    pools_t *pPool = memPools;
+    uint32_t stride;
+    uint32_t index;
+
+    while( ((uint8_t*)pHeader >= pPool->pHeapEnd) && pPool->nextBlockSize )
+    {
+        pPool++;
+    }
+
+    stride = pPool->blockSize + sizeof(listHeader_t);
+    index = ((uint8_t*)pHeader - pPool->pHeapStart) / stride;
+
+    *ppDonorPool = pPool;
+    *pDonorIndex = pPool->firstBlockIndex + index;
+
+    return (listHeader_t *)(pPool->pHeapStart + index * stride);
+}
+
+/*! *********************************************************************************
+* \brief     This function checks that a block header, located outside the heap range
+*            of its parent pool, is a block carved out of a split donor block.
+*
+* \param[in] pHeader - Pointer to the header of the block.
+*
+* \return Returns TRUE if the block is valid, FALSE otherwise.
+*
+********************************************************************************** */
+static bool_t MEM_SplitBlockIsValid(listHeader_t *pHeader)
+{
+    pools_t *pPool = pHeader->pParentPool;
+    pools_t *pDonorPool;
+    uint32_t donorIndex;
+    listHeader_t *pDonor = MEM_GetDonorBlock(pHeader, &pDonorPool, &donorIndex);
+    uint32_t stride = pPool->blockSize + sizeof(listHeader_t);
+    uint32_t offset = (uint8_t*)pHeader - (uint8_t*)pDonor;
+
+    /* The donor must be split into blocks of the parent pool */
+    if( (0 == memSplitState[donorIndex]) || (pDonor->pParentPool != pPool) )
+    {
+        return FALSE;
+    }
+
+    return ((offset % stride) == 0) &&
+           ((offset + stride) <= (pDonorPool->blockSize + sizeof(listHeader_t)));
+}
+
+/*! *********************************************************************************
+* \brief     Updates the split state of a donor block when one of its blocks is
+*            allocated or freed. When the last allocated block is freed, the blocks
+*            are removed from their pool and the donor block is returned to its own
+*            pool. Must be called with interrupts disabled.
+*
+* \param[in] pHeader - Header of a block carved out of a donor block.
+* \param[in] alloc - TRUE if the block was allocated, FALSE if it was freed.
+*
+********************************************************************************** */
+static void MEM_UpdateSplitBlock(listHeader_t *pHeader, bool_t alloc)
+{
+    pools_t *pPool = pHeader->pParentPool;
+    pools_t *pDonorPool;
+    uint32_t donorIndex;
+    listHeader_t *pDonor = MEM_GetDonorBlock(pHeader, &pDonorPool, &donorIndex);
+    uint32_t stride = pPool->blockSize + sizeof(listHeader_t);
+    uint32_t count = (pDonorPool->blockSize + sizeof(listHeader_t)) / stride;
+    uint8_t *pHeap = (uint8_t*)pDonor;
+    uint32_t i;
+
+    if( alloc )
+    {
+        memSplitState[donorIndex]++;
+        return;
+    }
+
+    if( --memSplitState[donorIndex] > 1 )
+    {
+        return;
+    }
+
+    /* All blocks are free. Coalesce them back into the donor block. */
+    for( i = 0; i < count; i++ )
+    {
+        ListRemoveElement((listElementHandle_t)&((listHeader_t *)pHeap)->link);
+        pHeap += stride;
+    }
+
+    memSplitState[donorIndex] = 0;
+    pPool->numBlocks -= count;
+    pPool->anchor.max -= count;
+    pDonorPool->numBlocks++;
+    gFreeMessagesCount -= count - 1;
+
+    pDonor->pParentPool = pDonorPool;
+    ListAddTail((listHandle_t)&pDonorPool->anchor, (listElementHandle_t)&pDonor->link);
+
+#ifdef MEM_STATISTICS
+    pPool->poolStatistics.numBlocks -= count;
+    pDonorPool->poolStatistics.numBlocks++;
+    pDonorPool->poolStatistics.coalesceCount++;
+#endif /*MEM_STATISTICS*/
+}
+#endif /*MEM_POOL_SPLITTING*/
+
+#ifdef MEM_TRACE
+/*! *********************************************************************************
+* \brief     Adds a record to the trace ring, overwriting the oldest one. Must be called
+*            with interrupts disabled.
+*
+* \param[in] op - The operation performed.
+* \param[in] buffer - Pointer to the buffer.
+* \param[in] pCaller - Return address of the caller.
+* \param[in] size - Requested size for allocations, else 0.
+*
+********************************************************************************** */
+static void MEM_Trace(memTraceOp_t op, void *buffer, void *pCaller, uint32_t size)
+{
+    memTraceRecord_t *pRecord;
+
+    if( memTracePaused )
+    {
+        return;
+    }
+
+    pRecord = &memTraceRing[memTraceSequence++ & (MEM_TraceRingSize_c - 1)];
+    pRecord->timeStamp = MEM_GetTimeStamp();
+    pRecord->block = (uint32_t)buffer;
+    pRecord->caller = (uint32_t)pCaller;
+    pRecord->size = (uint16_t)size;
+    pRecord->op = (uint8_t)op;
+    pRecord->freeBlocks = (gFreeMessagesCount > 0xFF) ? 0xFF : (uint8_t)gFreeMessagesCount;
+}
+#endif /*MEM_TRACE*/
+
+/*! *********************************************************************************
+* \brief     This function updates the tracking array element corresponding to the given
+*            block.
+*
+* \param[in] block - Pointer to the block.
+* \param[in] alloc - Indicates whether an allocation or free operation was performed
+* \param[in] address - Address where MEM_BufferAlloc or MEM_BufferFree was called
+* \param[in] requestedSize - Indicates the requested buffer size  passed to MEM_BufferAlloc.
+*                            Has no use if a free operation was performed.
+*
+* \return Returns TRUE if correct allocation or dealocation was performed, FALSE if a
 *         buffer was allocated or freed twice.
 *
 ********************************************************************************** */
@@ -515,7 +1760,7 @@ uint8_t MEM_Track(listHeader_t *block, memTrackingStatus_t alloc, uint32_t addre
   uint16_t i;
   blockTracking_t *pTrack = NULL;
 #ifdef MEM_STATISTICS
-  poolStat_t * poolStatistics = (poolStat_t *)&((pools_t *)( (listElementHandle_t)(block-1)->pParentPool ))->poolStatistics;
+  poolStat_t * poolStatistics = (poolStat_t *)&MEM_GetParentPool(block)->poolStatistics;
 #endif
 
   for( i=0; i<mTotalNoOfMsgs_c; i++ )
@@ -611,7 +1856,7 @@ uint8_t MEM_BufferCheck(uint8_t *p, uint32_t size)
 
     while( pPollInfo->blockSize )
     {
-        blockBytes = pPollInfo->blockSize + sizeof(listHeader_t);
+        blockBytes = pPollInfo->blockSize + pPollInfo->headerSize;
         poolBytes  = blockBytes * pPollInfo->poolSize;
 
         /* Find the correct message pool */
@@ -660,69 +1905,109 @@ uint8_t MEM_BufferCheck(uint8_t *p, uint32_t size)
 
 /*! *********************************************************************************
 * \brief     This function checks if the buffers are allocated for more than the 
-*            specified duration
+*            specified duration. A check of all the blocks is started every
+*            MEM_CheckMemBufferInterval_c ms, and each call checks at most
+*            MEM_CheckMemBufferBlocksPerCall_c blocks, continuing from where the
+*            previous call stopped.
 *
 ********************************************************************************** */
 #ifdef MEM_TRACKING
 void MEM_CheckIfMemBuffersAreFreed(void)
 {
     uint32_t t;
-    uint16_t i, j = 0;
-    uint8_t trackCount = 0;
+    uint16_t lastIndex;
     pools_t *pParentPool;
     volatile blockTracking_t *pTrack;
     static volatile blockTracking_t *mpTrackTbl[NUM_OF_TRACK_PTR];
     static uint32_t lastTimestamp = 0;
+    /* State of the check in progress */
+    static bool_t scanning = FALSE;
+    static uint16_t i;
+    static uint16_t j;
+    static uint8_t trackCount;
     uint32_t currentTime = MEM_GetTimeStamp();
+#ifdef MEM_STATISTICS
+    uint32_t startTime = MEM_GetTimeStampUs();
+#endif
     
-    if( (currentTime - lastTimestamp) >= MEM_CheckMemBufferInterval_c )
+    if( !scanning )
     {
+        if( (currentTime - lastTimestamp) < MEM_CheckMemBufferInterval_c )
+        {
+            return;
+        }
+
         lastTimestamp = currentTime;
+        scanning = TRUE;
+        i = 0;
         j = 0;
+        trackCount = 0;
+    }
 
-        for( i = 0; i < mTotalNoOfMsgs_c; i++ )
-        {
-            pTrack = &memTrack[i];
+    lastIndex = i + MEM_CheckMemBufferBlocksPerCall_c;
+    if( lastIndex > mTotalNoOfMsgs_c )
+    {
+        lastIndex = mTotalNoOfMsgs_c;
+    }
+
+    for( ; i < lastIndex; i++ )
+    {
+        pTrack = &memTrack[i];
 
-            /* Validate the pParent first */
-            pParentPool = (((listHeader_t *)(pTrack->blockAddr))-1)->pParentPool;
-            if(pParentPool != &memPools[j])
+        /* Validate the pParent first */
+        pParentPool = MEM_GetParentPool(pTrack->blockAddr);
+        if(pParentPool != &memPools[j])
+        {
+            if(j < NumberOfElements(memPools))
             {
-                if(j < NumberOfElements(memPools))
-                {
-                    j++;
-                    if(pParentPool != &memPools[j])
-                    {
-                        panic(0,0,0,0);
-                    }
-                }
-                else
+                j++;
+                if(pParentPool != &memPools[j])
                 {
                     panic(0,0,0,0);
                 }
             }
+            else
+            {
+                panic(0,0,0,0);
+            }
+        }
 
-            /* Check if it should be freed  */
-            OSA_InterruptDisable();
-            if((pTrack->timeStamp != 0xffffffff ) &&
-               (pTrack->allocStatus == MEM_TRACKING_ALLOC_c) &&
-               (currentTime > pTrack->timeStamp))
+        /* Check if it should be freed  */
+        OSA_InterruptDisable();
+        if((pTrack->timeStamp != 0xffffffff ) &&
+           (pTrack->allocStatus == MEM_TRACKING_ALLOC_c) &&
+           (currentTime > pTrack->timeStamp))
+        {
+            t = currentTime - pTrack->timeStamp;
+            if( t > MEM_CheckMemBufferThreshold_c )
             {
-                t = currentTime - pTrack->timeStamp;
-                if( t > MEM_CheckMemBufferThreshold_c )
+                mpTrackTbl[trackCount++] = pTrack;
+                if(trackCount == NUM_OF_TRACK_PTR)
                 {
-                    mpTrackTbl[trackCount++] = pTrack;
-                    if(trackCount == NUM_OF_TRACK_PTR)
-                    {
-                        (void)mpTrackTbl; /* remove compiler warnings */
-                        panic(0,0,0,0);
-                        break;
-                    }
+                    (void)mpTrackTbl; /* remove compiler warnings */
+                    OSA_InterruptEnable();
+                    panic(0,0,0,0);
+                    /* The check ends with the report, as the table is full */
+                    i = mTotalNoOfMsgs_c;
+                    break;
                 }
             }
-            OSA_InterruptEnable();
-        } /* end for */
+        }
+        OSA_InterruptEnable();
+    } /* end for */
+
+    if( i == mTotalNoOfMsgs_c )
+    {
+        scanning = FALSE;
+    }
+
+#ifdef MEM_STATISTICS
+    t = MEM_GetTimeStampUs() - startTime;
+    if( t > gMemLeakCheckMaxDuration )
+    {
+        gMemLeakCheckMaxDuration = t;
     }
+#endif
 }
 #endif /*MEM_TRACKING*/
 
@@ -733,7 +2018,7 @@ void MEM_CheckIfMemBuffersAreFreed(void)
 * \return dymmy time-stamp
 *
 ********************************************************************************** */
-#ifdef MEM_TRACKING
+#if defined(MEM_TRACKING) || defined(MEM_TRACE)
 #if defined(__IAR_SYSTEMS_ICC__)
 __weak uint32_t MEM_GetTimeStamp(void)
 #elif defined(__GNUC__)
@@ -742,7 +2027,29 @@ __attribute__((weak)) uint32_t MEM_GetTimeStamp(void)
 {
     return 0xFFFFFFFF;
 }
-#endif /* MEM_TRACKING */
+#endif /* MEM_TRACKING || MEM_TRACE */
+
+/*! *********************************************************************************
+* \brief     Get time-stamp in microseconds, used to measure the duration of
+*            MEM_CheckIfMemBuffersAreFreed().
+*
+* \return The lower 32 bits of the Timers Manager time-stamp
+*
+********************************************************************************** */
+#if defined(MEM_TRACKING) && defined(MEM_STATISTICS)
+#if !gTMR_Enabled_d
+#error "MEM_TRACKING with MEM_STATISTICS measures MEM_CheckIfMemBuffersAreFreed() with TMR_GetTimestamp(), which needs gTMR_Enabled_d"
+#endif
+#if defined(__IAR_SYSTEMS_ICC__)
+__weak uint32_t MEM_GetTimeStampUs(void)
+#elif defined(__GNUC__)
+__attribute__((weak)) uint32_t MEM_GetTimeStampUs(void)
+#endif
+{
+    /* Only differences are used, so the wrap of the lower 32 bits is harmless */
+    return (uint32_t)TMR_GetTimestamp();
+}
+#endif /* MEM_TRACKING && MEM_STATISTICS */
 
 /*! *********************************************************************************
 * \brief     Performs a write-read-verify test for every byte in all memory pools.
@@ -766,7 +2073,10 @@ uint32_t MEM_WriteReadTest(void)
   {
     for(idx2=0; idx2 < poolInfo[idx1].poolSize; idx2++)
     {
-      data = (uint8_t *)MEM_BufferAlloc(poolInfo[idx1].blockSize);
+      /* The reserved blocks are tested too */
+      data = (uint8_t *)MEM_BufferAllocWithId(poolInfo[idx1].blockSize,
+                                              poolInfo[idx1].poolId | MEM_CriticalAllocFlag_c,
+                                              (void*)__get_LR());
 
       if(data == NULL)
       {
@@ -793,8 +2103,8 @@ uint32_t MEM_WriteReadTest(void)
   {
     for(idx2=0; idx2 < poolInfo[idx1].poolSize; idx2++)
     {
-      /*New block; jump over list header*/
-      data = data + sizeof(listHeader_t);
+      /*New block; jump over block header*/
+      data = data + poolInfo[idx1].headerSize;
       for(idx3=0; idx3<poolInfo[idx1].blockSize; idx3++)
       {
         if(*data == count)
@@ -821,7 +2131,10 @@ uint32_t MEM_WriteReadTest(void)
   for(idx1 = 0; poolInfo[idx1].blockSize != 0; idx1++)
   {
     memPools[idx1].poolStatistics.allocatedBlocksPeak = 0;
+    memPools[idx1].poolStatistics.reserveHits = 0;
+    memPools[idx1].poolStatistics.reserveMisses = 0;
   }
+  gFreeMessagesCountMin = gFreeMessagesCount;
 #endif /*MEM_STATISTICS*/
 
   return MEM_SUCCESS_c;
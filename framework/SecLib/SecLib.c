@@ -639,6 +639,186 @@ uint32_t AES_128_CBC_Decrypt_And_Depad(uint8_t* pInput,
     while( (pOutput[--newLen] != 0x80) && (newLen !=0) ) {}
     return newLen;
 }
+/*! *********************************************************************************
+* \brief  This function stores an AES-128 key into a keyed context.
+*
+* \param[out]  pCtx Pointer to the keyed context.
+*
+* \param[in]  pKey Pointer to the location of the 128-bit key.
+*
+********************************************************************************** */
+void AES_128_SetKey(aes128Context_t* pCtx,
+                    const uint8_t* pKey)
+{
+    FLib_MemCpy(pCtx->key, (uint8_t*)pKey, AES_BLOCK_SIZE);
+}
+
+/*! *********************************************************************************
+* \brief  This function performs AES-128 encryption on a 16-byte block, with the key
+*         of a keyed context.
+*
+* \param[in]  pCtx Pointer to the keyed context.
+*
+* \param[in]  pInput Pointer to the location of the 16-byte plain text block.
+*
+* \param[out]  pOutput Pointer to the location to store the 16-byte ciphered output.
+*
+********************************************************************************** */
+void AES_128_Keyed_Encrypt(const aes128Context_t* pCtx,
+                           const uint8_t* pInput,
+                           uint8_t* pOutput)
+{
+    AES_128_Encrypt(pInput, (const uint8_t*)pCtx->key, pOutput);
+}
+
+/*! *********************************************************************************
+* \brief  This function performs AES-128 decryption on a 16-byte block, with the key
+*         of a keyed context.
+*
+* \param[in]  pCtx Pointer to the keyed context.
+*
+* \param[in]  pInput Pointer to the location of the 16-byte ciphered block.
+*
+* \param[out]  pOutput Pointer to the location to store the 16-byte plain text output.
+*
+********************************************************************************** */
+void AES_128_Keyed_Decrypt(const aes128Context_t* pCtx,
+                           const uint8_t* pInput,
+                           uint8_t* pOutput)
+{
+    AES_128_Decrypt(pInput, (const uint8_t*)pCtx->key, pOutput);
+}
+
+/*! *********************************************************************************
+* \brief  This function performs AES-128-CBC encryption on a message block after
+*         padding it with 1 bit of 1 and 0 bits trail, with the key of a keyed context.
+*
+* \param[in]  pInput Pointer to the location of the input message.
+*
+* \param[in]  inputLen Input message length in bytes. 
+*
+*             IMPORTANT: User must make sure that input and output
+*             buffers have at least inputLen + 16 bytes size
+*
+* \param[in]  pInitVector Pointer to the location of the 128-bit initialization vector.
+*
+* \param[in]  pCtx Pointer to the keyed context.
+*
+* \param[out]  pOutput Pointer to the location to store the ciphered output.
+*
+* Return value: size of output buffer (after padding)
+*
+********************************************************************************** */
+uint32_t AES_128_Keyed_CBC_Encrypt_And_Pad(uint8_t* pInput, 
+                                           uint32_t inputLen,
+                                           uint8_t* pInitVector, 
+                                           const aes128Context_t* pCtx, 
+                                           uint8_t* pOutput)
+{
+    uint32_t newLen = 0;
+    uint32_t idx;
+    /*compute new length*/
+    newLen = inputLen + (AES_BLOCK_SIZE - (inputLen & (AES_BLOCK_SIZE-1)));
+    /*pad the input buffer with 1 bit of 1 and trail of 0's from inputLen to newLen*/
+    for(idx=0; idx < (newLen - inputLen)-1; idx++)
+    {
+        pInput[newLen-1 - idx] = 0x00;
+    }
+    pInput[inputLen] = 0x80;
+
+    /* CBC-Encrypt */
+#if FSL_FEATURE_SOC_LTC_COUNT
+    SecLib_DisallowToSleep();
+    SECLIB_MUTEX_LOCK();
+    LTC_AES_EncryptCbc(LTC0, pInput, pOutput, newLen, pInitVector, (const uint8_t*)pCtx->key, AES_BLOCK_SIZE);
+    SECLIB_MUTEX_UNLOCK();
+    SecLib_AllowToSleep();
+#else
+    uint8_t chain[AES_BLOCK_SIZE] = {0};
+    
+    if( pInitVector != NULL )
+    {
+        FLib_MemCpy(chain, pInitVector, AES_BLOCK_SIZE);
+    }
+    inputLen = newLen;
+    while( inputLen > 0 )
+    {
+        SecLib_XorN(chain, pInput, AES_BLOCK_SIZE);
+        AES_128_Keyed_Encrypt(pCtx, chain, pOutput);
+        FLib_MemCpy(chain, pOutput, AES_BLOCK_SIZE);
+        pInput += AES_BLOCK_SIZE;
+        pOutput += AES_BLOCK_SIZE;
+        inputLen -= AES_BLOCK_SIZE;
+    }
+#endif
+    return newLen;
+}
+
+/*! *********************************************************************************
+* \brief  This function performs AES-128-CBC decryption on a message block, with the
+*         key of a keyed context, and removes the padding.
+*
+* \param[in]  pInput Pointer to the location of the input message.
+*
+* \param[in]  inputLen Input message length in bytes. Must be a multiple of 16.
+*
+* \param[in]  pInitVector Pointer to the location of the 128-bit initialization vector.
+*
+* \param[in]  pCtx Pointer to the keyed context.
+*
+* \param[out]  pOutput Pointer to the location to store the deciphered output.
+*
+* Return value: size of output buffer (after depadding), 0 if inputLen is not valid
+*
+********************************************************************************** */
+uint32_t AES_128_Keyed_CBC_Decrypt_And_Depad(uint8_t* pInput, 
+                                             uint32_t inputLen,
+                                             uint8_t* pInitVector, 
+                                             const aes128Context_t* pCtx, 
+                                             uint8_t* pOutput)
+{
+    uint32_t newLen = inputLen;
+
+    if( (inputLen == 0) || ((inputLen & (AES_BLOCK_SIZE - 1)) != 0) )
+    {
+        return 0;
+    }
+
+#if FSL_FEATURE_SOC_LTC_COUNT
+    SecLib_DisallowToSleep();
+    SECLIB_MUTEX_LOCK();
+    LTC_AES_DecryptCbc(LTC0, pInput, pOutput, inputLen, pInitVector, (const uint8_t*)pCtx->key, AES_BLOCK_SIZE, kLTC_DecryptKey);
+    SECLIB_MUTEX_UNLOCK();
+    SecLib_AllowToSleep();
+
+#else
+    uint8_t chain[AES_BLOCK_SIZE] = {0};
+    uint8_t block[AES_BLOCK_SIZE];
+
+    if(pInitVector != NULL)
+    {
+        FLib_MemCpy(chain, pInitVector, AES_BLOCK_SIZE);
+    }
+
+    while( inputLen > 0 )
+    {
+        /* the input may be overwritten when decrypting in place */
+        FLib_MemCpy(block, pInput, AES_BLOCK_SIZE);
+        AES_128_Keyed_Decrypt(pCtx, block, pOutput);
+        SecLib_XorN(pOutput, chain, AES_BLOCK_SIZE);
+        FLib_MemCpy(chain, block, AES_BLOCK_SIZE);
+        
+        pInput += AES_BLOCK_SIZE;
+        pOutput += AES_BLOCK_SIZE;
+        inputLen -= AES_BLOCK_SIZE;
+    }
+
+    pOutput -= newLen;
+#endif
+    while( (pOutput[--newLen] != 0x80) && (newLen !=0) ) {}
+    return newLen;
+}
+
 /*! *********************************************************************************
 * \brief  This function performs AES-128-CTR encryption on a message block.
 *
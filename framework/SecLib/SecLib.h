@@ -101,6 +101,12 @@ typedef struct HMAC_SHA256_context_tag{
     uint8_t pad[SHA256_BLOCK_SIZE];
 }HMAC_SHA256_context_t;
 
+/*! AES-128 keyed context, filled by AES_128_SetKey. It holds the key, which is
+    expanded for each operation. */
+typedef struct aes128Context_tag{
+    uint32_t key[AES_BLOCK_SIZE/sizeof(uint32_t)];
+}aes128Context_t;
+
 typedef enum ecdhStatus_tag {
     gEcdhSuccess_c,
     gEcdhBadParameters_c,
@@ -294,6 +300,97 @@ uint32_t AES_128_CBC_Decrypt_And_Depad(uint8_t* pInput,
                                        uint8_t* pKey, 
                                        uint8_t* pOutput);
 
+/*! *********************************************************************************
+* \brief  This function stores an AES-128 key into a keyed context, used by the
+*         keyed AES-128 functions.
+*
+* \param[out]  pCtx Pointer to the keyed context.
+*
+* \param[in]  pKey Pointer to the location of the 128-bit key.
+*
+********************************************************************************** */
+void AES_128_SetKey(aes128Context_t* pCtx,
+                    const uint8_t* pKey);
+
+/*! *********************************************************************************
+* \brief  This function performs AES-128 encryption on a 16-byte block, with the key
+*         of a keyed context.
+*
+* \param[in]  pCtx Pointer to the keyed context.
+*
+* \param[in]  pInput Pointer to the location of the 16-byte plain text block.
+*
+* \param[out]  pOutput Pointer to the location to store the 16-byte ciphered output.
+*
+********************************************************************************** */
+void AES_128_Keyed_Encrypt(const aes128Context_t* pCtx,
+                           const uint8_t* pInput,
+                           uint8_t* pOutput);
+
+/*! *********************************************************************************
+* \brief  This function performs AES-128 decryption on a 16-byte block, with the key
+*         of a keyed context.
+*
+* \param[in]  pCtx Pointer to the keyed context.
+*
+* \param[in]  pInput Pointer to the location of the 16-byte ciphered block.
+*
+* \param[out]  pOutput Pointer to the location to store the 16-byte plain text output.
+*
+********************************************************************************** */
+void AES_128_Keyed_Decrypt(const aes128Context_t* pCtx,
+                           const uint8_t* pInput,
+                           uint8_t* pOutput);
+
+/*! *********************************************************************************
+* \brief  This function performs AES-128-CBC encryption on a message block after
+*         padding it with 1 bit of 1 and 0 bits trail, with the key of a keyed context.
+*
+* \param[in]  pInput Pointer to the location of the input message.
+*
+* \param[in]  inputLen Input message length in bytes. 
+*
+*             IMPORTANT: User must make sure that input and output
+*             buffers have at least inputLen + 16 bytes size
+*
+* \param[in]  pInitVector Pointer to the location of the 128-bit initialization vector.
+*
+* \param[in]  pCtx Pointer to the keyed context.
+*
+* \param[out]  pOutput Pointer to the location to store the ciphered output.
+*
+* Return value: size of output buffer (after padding)
+*
+********************************************************************************** */
+uint32_t AES_128_Keyed_CBC_Encrypt_And_Pad(uint8_t* pInput, 
+                                           uint32_t inputLen,
+                                           uint8_t* pInitVector, 
+                                           const aes128Context_t* pCtx, 
+                                           uint8_t* pOutput);
+
+/*! *********************************************************************************
+* \brief  This function performs AES-128-CBC decryption on a message block, with the
+*         key of a keyed context, and removes the padding.
+*
+* \param[in]  pInput Pointer to the location of the input message.
+*
+* \param[in]  inputLen Input message length in bytes. Must be a multiple of 16.
+*
+* \param[in]  pInitVector Pointer to the location of the 128-bit initialization vector.
+*
+* \param[in]  pCtx Pointer to the keyed context.
+*
+* \param[out]  pOutput Pointer to the location to store the deciphered output.
+*
+* Return value: size of output buffer (after depadding), 0 if inputLen is not valid
+*
+********************************************************************************** */
+uint32_t AES_128_Keyed_CBC_Decrypt_And_Depad(uint8_t* pInput, 
+                                             uint32_t inputLen,
+                                             uint8_t* pInitVector, 
+                                             const aes128Context_t* pCtx, 
+                                             uint8_t* pOutput);
+
 /*! *********************************************************************************
 * \brief  This function performs AES-128-CTR encryption on a message block.
 *
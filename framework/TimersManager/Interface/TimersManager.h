@@ -111,6 +111,15 @@
 #define gTMR_EnableMinutesSecondsTimers_d   (1)
 #endif
 
+/*
+ * \brief    Enable/Disable the profiling of the timer callbacks: lateness
+ *           and duration histograms, printed by TMR_ProfilingReport()
+ * VALID RANGE: TRUE/FALSE
+ */
+#ifndef gTMR_EnableProfiling_d
+#define gTMR_EnableProfiling_d   (0)
+#endif
+
 /*
  * \brief   Number of timers needed by the application
  * VALID RANGE: user defined
@@ -135,6 +144,14 @@
 #define gTmrTotalTimers_c   ( gTmrApplicationTimers_c + gTmrStackTimers_c )
 #endif
 
+/*
+ * \brief   Number of RTC alarms which can be queued at the same time
+ * VALID RANGE: user defined (max 254)
+ */
+#ifndef gTmrRTCAlarms_c
+#define gTmrRTCAlarms_c     4
+#endif
+
 /*
  * \brief   Typecast the macro argument into milliseconds
  */
@@ -165,6 +182,11 @@
  */
 #define gTmrInvalidTimerID_c    0xFF
 
+/*
+ * \brief   Reserved for invalid RTC alarm id
+ */
+#define gTmrInvalidRTCAlarmID_c 0xFF
+
 /*
  * \brief   Timer types coded values
  */
@@ -248,6 +270,11 @@ typedef uint8_t     tmrTimerID_t;
  */
 typedef uint8_t     tmrTimerType_t;
 
+/*
+ * \brief   RTC alarm id
+ */
+typedef uint8_t     tmrRTCAlarmID_t;
+
 /*
  * \brief   Timer callback function
  */
@@ -295,6 +322,25 @@ tmrTimerID_t TMR_AllocateTimer
     void
 );
 
+/*! -------------------------------------------------------------------------
+ * \brief   Returns the number of allocated timers
+ * \return  number of allocated timers
+ *---------------------------------------------------------------------------*/
+uint8_t TMR_GetAllocatedTimers
+(
+    void
+);
+
+/*! -------------------------------------------------------------------------
+ * \brief   Returns the high-water mark of the allocated timers.
+ *          Use it to size gTmrApplicationTimers_c / gTmrStackTimers_c.
+ * \return  highest number of timers allocated at the same time
+ *---------------------------------------------------------------------------*/
+uint8_t TMR_GetAllocatedTimersPeak
+(
+    void
+);
+
 /*! -------------------------------------------------------------------------
  * \brief   Check if all timers except the LP timers are OFF.
  * \return  TRUE if there are no active non-low power timers, FALSE otherwise
@@ -384,6 +430,45 @@ tmrErrCode_t TMR_StartTimer
     void *param
 );
 
+/*! -------------------------------------------------------------------------
+ * \brief     Start a specified timer, which may expire late
+ *
+ * \param[in] timerId - the ID of the timer
+ * \param[in] timerType - the type of the timer
+ * \param[in] timeInMilliseconds - time expressed in millisecond units
+ * \param[in] slackInMilliseconds - allowed lateness, in millisecond units
+ * \param[in] pfTmrCallBack - callback function
+ * \param[in] param - parameter to callback function
+ *
+ * \return    the error code
+ * \details   Same as TMR_StartTimer(), but the callback may be called up to
+ *            slackInMilliseconds after the timeout. The timer thread uses the
+ *            slack to process the expirations which fall in overlapping
+ *            windows in a single run.
+ *            For an interval timer, the slack is limited to one tick less than
+ *            the interval, so that no period is skipped: a larger slack is
+ *            reduced to that limit.
+ *---------------------------------------------------------------------------*/
+tmrErrCode_t TMR_StartTimerWithSlack
+(
+    tmrTimerID_t timerID,
+    tmrTimerType_t timerType,
+    tmrTimeInMilliseconds_t timeInMilliseconds,
+    tmrTimeInMilliseconds_t slackInMilliseconds,
+    pfTmrCallBack_t callback,
+    void *param
+);
+
+/*! -------------------------------------------------------------------------
+ * \brief   Returns the number of timer thread runs saved by coalescing the
+ *          expirations of timers started with TMR_StartTimerWithSlack()
+ * \return  number of saved runs
+ *---------------------------------------------------------------------------*/
+uint32_t TMR_GetWakeupsSaved
+(
+    void
+);
+
 /*! -------------------------------------------------------------------------
  * \brief   Start a low power timer. When the timer goes off, call the
  *              callback function in non-interrupt context.
@@ -614,6 +699,27 @@ void TMR_TimeStampInit(void);
  *---------------------------------------------------------------------------*/
 uint64_t TMR_GetTimestamp(void);
 
+#if gTMR_EnableProfiling_d
+/*! -------------------------------------------------------------------------
+ * \brief     Writes the timer callbacks profile to a serial interface: the
+ *            expirations, worst lateness and worst duration of each timer,
+ *            followed by the lateness and duration histograms.
+ * \param[in] interfaceId - The SerialManager interface.
+ *---------------------------------------------------------------------------*/
+void TMR_ProfilingReport
+(
+    uint8_t interfaceId
+);
+
+/*! -------------------------------------------------------------------------
+ * \brief   Clears the timer callbacks profile
+ *---------------------------------------------------------------------------*/
+void TMR_ProfilingReset
+(
+    void
+);
+#endif
+
 /*! -------------------------------------------------------------------------
  * \brief   Reserve a minute timer
  * \return   gTmrInvalidTimerID_c if there are no timers available
@@ -655,10 +761,14 @@ uint64_t TMR_GetTimestamp(void);
 #define TMR_Init()
 #define TMR_NotifyClkChanged()
 #define TMR_AllocateTimer()         gTmrInvalidTimerID_c
+#define TMR_GetAllocatedTimers()     0
+#define TMR_GetAllocatedTimersPeak() 0
 #define TMR_AreAllTimersOff()       1
 #define TMR_FreeTimer(timerID)      0
 #define TMR_IsTimerActive(timerID)  0
 #define TMR_StartTimer(timerID,timerType,timeInMilliseconds, pfTimerCallBack, param) 0
+#define TMR_StartTimerWithSlack(timerID,timerType,timeInMilliseconds,slackInMilliseconds,pfTimerCallBack,param) 0
+#define TMR_GetWakeupsSaved()       0
 #define TMR_StartLowPowerTimer(timerId,timerType,timeIn,pfTmrCallBack,param) 0
 #if gTMR_EnableMinutesSecondsTimers_d
 #define TMR_StartMinuteTimer(timerId,timeInMinutes,pfTmrCallBack,param) 0
@@ -686,6 +796,8 @@ uint64_t TMR_GetTimestamp(void);
 #define TMR_StopSecondTimer(timerID)  TMR_StopTimer(timerID)
 #define TMR_TimeStampInit()
 #define TMR_GetTimestamp()                          0
+#define TMR_ProfilingReport(interfaceId)
+#define TMR_ProfilingReset()
 
 #endif /* gTMR_Enabled_d */
 
@@ -710,7 +822,8 @@ void TMR_RTCInit(void);
 uint64_t TMR_RTCGetTimestamp(void);
 
 /*! -------------------------------------------------------------------------
- * \brief     Sets the absolute time.
+ * \brief     Sets the absolute time. The alarms which are due at the new time
+ *            are run from the RTC alarm interrupt, after the call returns.
  * \param[in] microseconds
  *---------------------------------------------------------------------------*/
 void TMR_RTCSetTime(uint64_t microseconds);
@@ -718,19 +831,53 @@ void TMR_RTCSetTime(uint64_t microseconds);
 /*! -------------------------------------------------------------------------
  * \brief     Sets the alarm absolute time in seconds.
  * \param[in] seconds Time in seconds for the alarm. 
- * \param[in] callback function pointer. 
+ * \param[in] callback function pointer, called in interrupt context.
  * \param[in] param Parameter for callback.
  *---------------------------------------------------------------------------*/
 void TMR_RTCSetAlarm(uint64_t seconds, pfTmrCallBack_t callback, void *param);
 
 /*! -------------------------------------------------------------------------
- * \brief     Sets the alarm relative time in seconds.
+ * \brief     Sets the alarm relative time in seconds. An alarm in 0 seconds
+ *            is run from the RTC alarm interrupt, after the call returns.
  * \param[in] seconds number of seconds until the alarm. 
- * \param[in] callback function pointer. 
+ * \param[in] callback function pointer, called in interrupt context.
  * \param[in] param Parameter for callback.
  *---------------------------------------------------------------------------*/
 void TMR_RTCSetAlarmRelative(uint32_t seconds, pfTmrCallBack_t callback, void *param);
 
+/*! -------------------------------------------------------------------------
+ * \brief     Queues an RTC alarm at an absolute time. All the queued alarms
+ *            share the RTC compare, which is set for the earliest one.
+ *            The alarms are independent of the one set by TMR_RTCSetAlarm().
+ *            The resolution is one second, and an alarm never expires early.
+ *            The callbacks of all the alarms are only called from the RTC
+ *            alarm interrupt, never from the RTC alarm functions: an alarm
+ *            which is already due runs after the call returns.
+ * \param[in] seconds Absolute time of the first alarm, in seconds.
+ * \param[in] intervalSeconds Period of the following alarms, 0 for a single alarm.
+ * \param[in] callback function pointer, called in interrupt context.
+ * \param[in] param Parameter for callback.
+ * \return    the alarm id, or gTmrInvalidRTCAlarmID_c if the queue is full
+ *---------------------------------------------------------------------------*/
+tmrRTCAlarmID_t TMR_RTCStartAlarm(uint64_t seconds, uint32_t intervalSeconds, pfTmrCallBack_t callback, void *param);
+
+/*! -------------------------------------------------------------------------
+ * \brief     Queues an RTC alarm relative to the current time.
+ * \param[in] seconds number of seconds until the first alarm.
+ * \param[in] intervalSeconds Period of the following alarms, 0 for a single alarm.
+ * \param[in] callback function pointer, called in interrupt context.
+ * \param[in] param Parameter for callback.
+ * \return    the alarm id, or gTmrInvalidRTCAlarmID_c if the queue is full
+ *---------------------------------------------------------------------------*/
+tmrRTCAlarmID_t TMR_RTCStartAlarmRelative(uint32_t seconds, uint32_t intervalSeconds, pfTmrCallBack_t callback, void *param);
+
+/*! -------------------------------------------------------------------------
+ * \brief     Removes an alarm from the RTC alarm queue.
+ * \param[in] alarmID the id returned when the alarm was started.
+ * \return    gTmrSuccess_c, or gTmrInvalidId_c if the alarm is not queued
+ *---------------------------------------------------------------------------*/
+tmrErrCode_t TMR_RTCStopAlarm(tmrRTCAlarmID_t alarmID);
+
 #else /*stub functions*/
 
 #define TMR_RTCInit()
@@ -738,6 +885,9 @@ void TMR_RTCSetAlarmRelative(uint32_t seconds, pfTmrCallBack_t callback, void *p
 #define TMR_RTCSetTime()
 #define TMR_RTCSetAlarm()
 #define TMR_RTCSetAlarmRelative()
+#define TMR_RTCStartAlarm(seconds, intervalSeconds, callback, param)            gTmrInvalidRTCAlarmID_c
+#define TMR_RTCStartAlarmRelative(seconds, intervalSeconds, callback, param)    gTmrInvalidRTCAlarmID_c
+#define TMR_RTCStopAlarm(alarmID)                                               gTmrInvalidId_c
 
 #endif /*gTimestamp_Enabled_d*/
 
@@ -54,7 +54,14 @@
 * Private memory declarations
 *************************************************************************************
 ************************************************************************************/
-#if FSL_FEATURE_SOC_FTM_COUNT
+#if gStackTimer_HostBackend_d
+static void (*mStackTimerHostCb)(void);
+static uint16_t mStackTimerHostCounter;
+static uint16_t mStackTimerHostCompare;
+static bool_t   mStackTimerHostEnabled;
+static bool_t   mStackTimerHostIrq;
+
+#elif FSL_FEATURE_SOC_FTM_COUNT
 static const IRQn_Type mFtmIrqId[] = FTM_IRQS;
 static FTM_Type * mFtmBase[] = FTM_BASE_PTRS;
 static const ftm_config_t mFtmConfig = {
@@ -93,6 +100,91 @@ static const tpm_config_t mTpmConfig = {
 * Public functions
 *************************************************************************************
 ************************************************************************************/
+#if gStackTimer_HostBackend_d
+void StackTimer_Init(void (*cb)(void))
+{
+    mStackTimerHostCb = cb;
+    mStackTimerHostCounter = 0;
+    mStackTimerHostCompare = 0x01;
+    mStackTimerHostEnabled = FALSE;
+    mStackTimerHostIrq = FALSE;
+}
+
+/*************************************************************************************/
+void StackTimer_Enable(void)
+{
+    mStackTimerHostEnabled = TRUE;
+}
+
+/*************************************************************************************/
+void StackTimer_Disable(void)
+{
+    mStackTimerHostEnabled = FALSE;
+}
+
+/*************************************************************************************/
+uint32_t StackTimer_GetInputFrequency(void)
+{
+    return gStackTimer_HostFrequency_c;
+}
+
+/*************************************************************************************/
+uint32_t StackTimer_GetCounterValue(void)
+{
+    uint32_t counter = mStackTimerHostCounter;
+
+    /* Each read takes one tick, so that the timer thread does not wait forever
+       for an expiry too close to be loaded in the compare register */
+    StackTimer_HostAdvance(1);
+
+    return counter;
+}
+
+/*************************************************************************************/
+void StackTimer_SetOffsetTicks(uint32_t offset)
+{
+    mStackTimerHostCompare = (uint16_t)offset;
+}
+
+/*************************************************************************************/
+void StackTimer_ClearIntFlag(void)
+{
+    mStackTimerHostIrq = FALSE;
+}
+
+/*************************************************************************************/
+void StackTimer_HostAdvance(uint32_t ticks)
+{
+    uint32_t toCompare;
+    uint32_t toOverflow;
+    uint32_t step;
+
+    /* The counter only runs while enabled, and raises an interrupt on the channel
+       match and on the overflow, as the free-running hardware counter does */
+    while( ticks && mStackTimerHostEnabled )
+    {
+        toCompare  = ((uint32_t)(uint16_t)(mStackTimerHostCompare - mStackTimerHostCounter - 1)) + 1;
+        toOverflow = 0x10000 - (uint32_t)mStackTimerHostCounter;
+        step = (toCompare < toOverflow) ? toCompare : toOverflow;
+
+        if( step > ticks )
+        {
+            mStackTimerHostCounter += (uint16_t)ticks;
+            break;
+        }
+
+        mStackTimerHostCounter += (uint16_t)step;
+        ticks -= step;
+        mStackTimerHostIrq = TRUE;
+
+        if( mStackTimerHostCb )
+        {
+            mStackTimerHostCb();
+        }
+    }
+}
+
+#else
 void StackTimer_Init(void (*cb)(void))
 {
     IRQn_Type irqId;
@@ -198,9 +290,43 @@ void StackTimer_ClearIntFlag(void)
 #endif
 }
 
+#endif /* gStackTimer_HostBackend_d */
+
 /*************************************************************************************/
 /*                                       PWM                                         */
 /*************************************************************************************/
+#if gStackTimer_HostBackend_d
+/* No PWM outputs on the host */
+void PWM_Init(uint8_t instance)
+{
+    (void)instance;
+}
+
+/*************************************************************************************/
+void PWM_SetChnCountVal(uint8_t instance, uint8_t channel, uint16_t val)
+{
+    (void)instance;
+    (void)channel;
+    (void)val;
+}
+
+/*************************************************************************************/
+uint16_t PWM_GetChnCountVal(uint8_t instance, uint8_t channel)
+{
+    (void)instance;
+    (void)channel;
+    return 0;
+}
+
+/*************************************************************************************/
+void PWM_StartEdgeAlignedLowTrue(uint8_t instance, tmr_adapter_pwm_param_t *param, uint8_t channel)
+{
+    (void)instance;
+    (void)param;
+    (void)channel;
+}
+
+#else
 void PWM_Init(uint8_t instance)
 {
 #if FSL_FEATURE_SOC_FTM_COUNT
@@ -263,3 +389,4 @@ void PWM_StartEdgeAlignedLowTrue(uint8_t instance, tmr_adapter_pwm_param_t *para
     TPM_SetupPwm(mTpmBase[instance], &pwmChannelConfig, 1, kTPM_EdgeAlignedPwm, param->frequency, BOARD_GetTpmClock(instance));
 #endif  
 }
+#endif /* gStackTimer_HostBackend_d */
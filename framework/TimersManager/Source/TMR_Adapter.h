@@ -74,6 +74,17 @@
 
 #define gStackTimer_IsrPrio_c (0x80)
 
+/* Replace the stack timer hardware with a virtual counter, advanced by
+   StackTimer_HostAdvance(), to run the timers scheduler on a host */
+#ifndef gStackTimer_HostBackend_d
+#define gStackTimer_HostBackend_d (0)
+#endif
+
+/* Input frequency of the virtual counter, in Hz */
+#ifndef gStackTimer_HostFrequency_c
+#define gStackTimer_HostFrequency_c (250000)
+#endif
+
 /************************************************************************************
 *************************************************************************************
 * Public types
@@ -97,6 +108,9 @@ void StackTimer_ClearIntFlag(void);
 uint32_t StackTimer_GetInputFrequency(void);
 uint32_t StackTimer_GetCounterValue(void);
 void StackTimer_SetOffsetTicks(uint32_t offset);
+#if gStackTimer_HostBackend_d
+void StackTimer_HostAdvance(uint32_t ticks);
+#endif
 
 void PWM_Init(uint8_t instance);
 void PWM_SetChnCountVal(uint8_t instance, uint8_t channel, uint16_t val);
@@ -43,6 +43,10 @@
 #include "fsl_clock.h"
 #include "pin_mux.h"
 
+#if gTMR_EnableProfiling_d
+#include "SerialManager.h"
+#endif
+
 
 /*****************************************************************************
 ******************************************************************************
@@ -51,6 +55,29 @@
 *****************************************************************************/
 #define mTmrDummyEvent_c (1<<16)
 
+/*
+ * \brief Minimum distance in ticks between the counter and a new compare value.
+ *        Timers expiring closer than this are processed by the current run of
+ *        the timer thread instead of programming the compare in the past.
+ */
+#define mTmrMinCompareTicks_c (2)
+
+/*
+ * \brief Size of the stack used to walk the expiry heap. A walk never holds more
+ *        than one pending node per heap level, plus one.
+ */
+#define mTmrHeapWalkDepth_c   (9)
+
+#if gTMR_EnableProfiling_d
+/*
+ * \brief Number of bins of the profiling histograms. The first bin counts the
+ *        values below 64 us (1 << mTmrProfilingFirstBinShift_c), each next bin
+ *        covers a 4 times larger range and the last one counts everything above.
+ */
+#define mTmrProfilingBins_c           (8)
+#define mTmrProfilingFirstBinShift_c  (6)
+#endif
+
 /*****************************************************************************
 ******************************************************************************
 * Public memory declarations
@@ -112,7 +139,74 @@ static void TMR_SetTimerType
     tmrTimerType_t type
 );
 
+/*! -------------------------------------------------------------------------
+ * \brief     Extend the hardware counter to 64 bits
+ * \return    the absolute time in ticks
+ *---------------------------------------------------------------------------*/
+static tmrTimerTicks64_t TMR_GetCurrentTicks
+(
+    void
+);
+
+/*! -------------------------------------------------------------------------
+ * \brief     Get the latest time at which the first timer can be processed
+ * \return    the wakeup time in ticks
+ *---------------------------------------------------------------------------*/
+static tmrTimerTicks64_t TMR_GetCoalescedWakeup
+(
+    void
+);
+
+/*! -------------------------------------------------------------------------
+ * \brief     Insert an active timer in the expiry heap
+ * \param[in] timerID - the timer ID
+ *---------------------------------------------------------------------------*/
+static void TMR_HeapInsert
+(
+    tmrTimerID_t timerID
+);
+
+/*! -------------------------------------------------------------------------
+ * \brief     Remove a timer from the expiry heap
+ * \param[in] timerID - the timer ID
+ *---------------------------------------------------------------------------*/
+static void TMR_HeapRemove
+(
+    tmrTimerID_t timerID
+);
 
+/*! -------------------------------------------------------------------------
+ * \brief     Restore the heap order after the key at a position decreased
+ * \param[in] pos - the heap position
+ *---------------------------------------------------------------------------*/
+static void TMR_HeapSiftUp
+(
+    uint32_t pos
+);
+
+/*! -------------------------------------------------------------------------
+ * \brief     Restore the heap order after the key at a position increased
+ * \param[in] pos - the heap position
+ *---------------------------------------------------------------------------*/
+static void TMR_HeapSiftDown
+(
+    uint32_t pos
+);
+
+#if gTMR_EnableProfiling_d
+/*! -------------------------------------------------------------------------
+ * \brief     Record the lateness and the duration of a timer callback
+ * \param[in] timerID - the timer ID
+ * \param[in] latenessTicks - ticks between the deadline and the callback
+ * \param[in] durationTicks - execution time of the callback in ticks
+ *---------------------------------------------------------------------------*/
+static void TMR_ProfilingRecord
+(
+    tmrTimerID_t timerID,
+    tmrTimerTicks64_t latenessTicks,
+    tmrTimerTicks64_t durationTicks
+);
+#endif
 
 /*! -------------------------------------------------------------------------
  * \brief Function called by driver ISR on channel match in interrupt context.
@@ -145,6 +239,54 @@ void TMR_RTCAlarmNotify
     void
 );
 
+/*! -------------------------------------------------------------------------
+ * \brief Insert an alarm in the RTC alarm queue, sorted by deadline.
+ *        Must be called with interrupts disabled.
+ *---------------------------------------------------------------------------*/
+static void TMR_RTCAlarmInsert
+(
+    tmrRTCAlarmID_t alarmID
+);
+
+/*! -------------------------------------------------------------------------
+ * \brief Remove an alarm from the RTC alarm queue.
+ *        Must be called with interrupts disabled.
+ *---------------------------------------------------------------------------*/
+static bool_t TMR_RTCAlarmRemove
+(
+    tmrRTCAlarmID_t alarmID
+);
+
+/*! -------------------------------------------------------------------------
+ * \brief Run the callbacks of the expired alarms and program the RTC
+ *        compare for the first alarm left in the queue.
+ *        Called from the RTC alarm interrupt only.
+ *---------------------------------------------------------------------------*/
+static void TMR_RTCAlarmExpire
+(
+    void
+);
+
+/*! -------------------------------------------------------------------------
+ * \brief Program the RTC compare for the first alarm in the queue, or pend
+ *        the RTC alarm interrupt if that alarm is already due.
+ *        Must be called with interrupts disabled.
+ *---------------------------------------------------------------------------*/
+static void TMR_RTCAlarmProgram
+(
+    void
+);
+
+/*! -------------------------------------------------------------------------
+ * \brief Align the RTC seconds with the current time, so that a relative
+ *        alarm expires after an exact number of seconds.
+ *        Must be called with interrupts disabled.
+ *---------------------------------------------------------------------------*/
+static void TMR_RTCAlignSeconds
+(
+    void
+);
+
 #endif /*gTimestamp_Enabled_d*/
 
 
@@ -163,18 +305,20 @@ void TMR_RTCAlarmNotify
 static tmrTimerTicks16_t previousTimeInTicks;
 
 /*
- * \brief  Count to maximum (0xffff - 2*4ms(in ticks)), to be sure that
- * the currentTimeInTicks will never roll over previousTimeInTicks in the
- * TMR_Task(); A thread have to be executed at most in 4ms.
- * VALUES: 0..65535
+ * \brief Absolute time in ticks: the hardware counter extended to 64 bits.
+ *        Updated each time the counter is read by TMR_GetCurrentTicks().
+ *        The expiry deadlines of the timers are kept on this time base.
+ * VALUES: 64-bit range
  */
-static uint16_t mMaxToCountDown_c;
+static tmrTimerTicks64_t mTmrCurrentTicks;
 
 /*
- * \brief  Ticks for 4ms. The TMR_Task()event will not be issued faster than 4ms
- * VALUES: uint16_t range
+ * \brief  Count to maximum (0xffff - 8ms(in ticks)), to be sure that
+ * the counter will never roll over previousTimeInTicks between two runs
+ * of the TMR_Task(); A thread have to be executed at most in 8ms.
+ * VALUES: 0..65535
  */
-static uint16_t mTicksFor4ms;
+static uint16_t mMaxToCountDown_c;
 
 /*
  * \brief  The counter frequency in hz.
@@ -197,6 +341,77 @@ static tmrTimerTableEntry_t maTmrTimerTable[gTmrTotalTimers_c];
  */
 static tmrStatus_t maTmrTimerStatusTable[gTmrTotalTimers_c];
 
+/*
+ * \brief One bit for each allocated timer, so a free timer is found without
+ *              scanning the whole status table.
+ * VALUES: see definition
+ */
+static uint32_t maTmrAllocatedBitmap[mTmrBitmapWords_c];
+
+/*
+ * \brief Number of allocated timers and the highest number of timers
+ *              allocated at the same time.
+ * VALUES: 0..gTmrTotalTimers_c
+ */
+static uint8_t mTmrAllocatedTimers = 0;
+static uint8_t mTmrAllocatedTimersPeak = 0;
+
+/*
+ * \brief Expiry heap. Binary min-heap of the started timer IDs, ordered by
+ *              expireTicks, so the next timer to expire is always maTmrHeap[0].
+ * VALUES: timer IDs
+ */
+static tmrTimerID_t maTmrHeap[gTmrTotalTimers_c];
+
+/*
+ * \brief Position of each timer in the expiry heap. Only valid while
+ *              the timer is in the mTmrStatusActive_c or mTmrStatusReady_c state.
+ * VALUES: 0..gTmrTotalTimers_c-1
+ */
+static uint8_t maTmrHeapIndex[gTmrTotalTimers_c];
+
+/*
+ * \brief Number of timers queued in the expiry heap
+ * VALUES: 0..gTmrTotalTimers_c
+ */
+static uint8_t mTmrHeapCount = 0;
+
+/*
+ * \brief One bit for each timer in the mTmrStatusReady_c state, so the timer
+ *              thread does not have to scan the whole table to activate them.
+ * VALUES: see definition
+ */
+static uint32_t maTmrReadyBitmap[mTmrBitmapWords_c];
+
+/*
+ * \brief Wakeup programmed later than the first deadline, thanks to the slack
+ *              of the timers. The expirations up to this time are coalesced.
+ *              0 if the last wakeup was not coalesced.
+ * VALUES: 64-bit range
+ */
+static tmrTimerTicks64_t mTmrCoalescedWakeup = 0;
+
+/*
+ * \brief Number of timer thread runs saved by coalescing expirations
+ * VALUES: 32-bit range
+ */
+static uint32_t mTmrWakeupsSaved = 0;
+
+#if gTMR_EnableProfiling_d
+/*
+ * \brief Worst case lateness and duration of the callback of each timer
+ * VALUES: see definition
+ */
+static tmrTimerProfile_t maTmrProfile[gTmrTotalTimers_c];
+
+/*
+ * \brief Histograms of the lateness and of the duration of all timer callbacks
+ * VALUES: see mTmrProfilingBins_c
+ */
+static uint32_t maTmrLatenessHistogram[mTmrProfilingBins_c];
+static uint32_t maTmrDurationHistogram[mTmrProfilingBins_c];
+#endif
+
 /*
  * \brief Number of Active timers (without low power capability)
  *              the MCU can not enter low power if numberOfActiveTimers!=0
@@ -257,14 +472,15 @@ static volatile uint64_t gRTCTimeOffset;
 static volatile uint16_t gRTCPrescalerOffset;
 
 /*
- * \brief Callback for the alarm.
+ * \brief RTC alarms. The last entry holds the alarm set by TMR_RTCSetAlarm()
+ *        and TMR_RTCSetAlarmRelative().
  */
-static pfTmrCallBack_t gRTCAlarmCallback;
+static tmrRTCAlarm_t gRTCAlarms[gTmrRTCAlarms_c + 1];
 
 /*
- * \brief Parameter for the alarm callback.
+ * \brief First alarm of the queue, gTmrInvalidRTCAlarmID_c if the queue is empty.
  */
-static void *gRTCAlarmCallbackParam;
+static tmrRTCAlarmID_t gRTCAlarmHead = gTmrInvalidRTCAlarmID_c;
 
 /*
  * \brief signals the state of the RTC.
@@ -344,6 +560,255 @@ static void TMR_SetTimerType
     maTmrTimerStatusTable[timerID] = (tmrStatus_t)(maTmrTimerStatusTable[timerID] & (tmrStatus_t)(~mTimerType_c)) | type;
 }
 
+/*! -------------------------------------------------------------------------
+* \brief     Extend the hardware counter to 64 bits
+* \return    the absolute time in ticks
+* \details   Must be called with interrupts disabled. The counter is read by
+*            the timer thread at least once per mMaxToCountDown_c ticks, so
+*            the elapsed ticks always fit in 16 bits.
+*---------------------------------------------------------------------------*/
+static tmrTimerTicks64_t TMR_GetCurrentTicks
+(
+    void
+)
+{
+    tmrTimerTicks16_t currentTimeInTicks = StackTimer_GetCounterValue();
+
+    mTmrCurrentTicks += (tmrTimerTicks16_t)(currentTimeInTicks - previousTimeInTicks);
+    previousTimeInTicks = currentTimeInTicks;
+
+    return mTmrCurrentTicks;
+}
+
+/*! -------------------------------------------------------------------------
+* \brief     Restore the heap order after the key at a position decreased
+* \param[in] pos - the heap position
+* \details   Must be called with interrupts disabled.
+*---------------------------------------------------------------------------*/
+static void TMR_HeapSiftUp
+(
+    uint32_t pos
+)
+{
+    tmrTimerID_t timerID = maTmrHeap[pos];
+    tmrTimerTicks64_t expireTicks = maTmrTimerTable[timerID].expireTicks;
+    uint32_t parent;
+
+    while( pos > 0 )
+    {
+        parent = (pos - 1) >> 1;
+
+        if( maTmrTimerTable[maTmrHeap[parent]].expireTicks <= expireTicks )
+        {
+            break;
+        }
+
+        maTmrHeap[pos] = maTmrHeap[parent];
+        maTmrHeapIndex[maTmrHeap[pos]] = pos;
+        pos = parent;
+    }
+
+    maTmrHeap[pos] = timerID;
+    maTmrHeapIndex[timerID] = pos;
+}
+
+/*! -------------------------------------------------------------------------
+* \brief     Restore the heap order after the key at a position increased
+* \param[in] pos - the heap position
+* \details   Must be called with interrupts disabled.
+*---------------------------------------------------------------------------*/
+static void TMR_HeapSiftDown
+(
+    uint32_t pos
+)
+{
+    tmrTimerID_t timerID = maTmrHeap[pos];
+    tmrTimerTicks64_t expireTicks = maTmrTimerTable[timerID].expireTicks;
+    uint32_t child;
+
+    while( (child = (pos << 1) + 1) < mTmrHeapCount )
+    {
+        /* Pick the child which expires first */
+        if( ((child + 1) < mTmrHeapCount) &&
+            (maTmrTimerTable[maTmrHeap[child + 1]].expireTicks < maTmrTimerTable[maTmrHeap[child]].expireTicks) )
+        {
+            child++;
+        }
+
+        if( expireTicks <= maTmrTimerTable[maTmrHeap[child]].expireTicks )
+        {
+            break;
+        }
+
+        maTmrHeap[pos] = maTmrHeap[child];
+        maTmrHeapIndex[maTmrHeap[pos]] = pos;
+        pos = child;
+    }
+
+    maTmrHeap[pos] = timerID;
+    maTmrHeapIndex[timerID] = pos;
+}
+
+/*! -------------------------------------------------------------------------
+* \brief     Get the latest time at which the first timer can be processed
+* \return    the wakeup time in ticks
+* \details   Must be called with interrupts disabled and a non-empty heap.
+*            The wakeup is the earliest end of the slack windows of the timers.
+*            All timers which expire before it are processed in the same run.
+*            Only the heap nodes which expire before the wakeup are visited:
+*            the subtree of a node which expires later is skipped as a whole.
+*---------------------------------------------------------------------------*/
+static tmrTimerTicks64_t TMR_GetCoalescedWakeup
+(
+    void
+)
+{
+    uint8_t stack[mTmrHeapWalkDepth_c];
+    uint32_t top = 0;
+    uint32_t pos, child;
+    tmrTimerTableEntry_t *pTimer = &maTmrTimerTable[maTmrHeap[0]];
+    tmrTimerTicks64_t wakeup = pTimer->expireTicks + pTimer->slackInTicks;
+
+    stack[top++] = 0;
+
+    while( top )
+    {
+        pos = stack[--top];
+        pTimer = &maTmrTimerTable[maTmrHeap[pos]];
+
+        if( pTimer->expireTicks > wakeup )
+        {
+            continue;
+        }
+
+        if( pTimer->expireTicks + pTimer->slackInTicks < wakeup )
+        {
+            wakeup = pTimer->expireTicks + pTimer->slackInTicks;
+        }
+
+        child = (pos << 1) + 1;
+
+        if( child < mTmrHeapCount )
+        {
+            stack[top++] = child;
+        }
+
+        if( (child + 1) < mTmrHeapCount )
+        {
+            stack[top++] = child + 1;
+        }
+    }
+
+    return wakeup;
+}
+
+/*! -------------------------------------------------------------------------
+* \brief     Insert an active timer in the expiry heap
+* \param[in] timerID - the timer ID
+* \details   Must be called with interrupts disabled.
+*---------------------------------------------------------------------------*/
+static void TMR_HeapInsert
+(
+    tmrTimerID_t timerID
+)
+{
+    maTmrHeap[mTmrHeapCount] = timerID;
+    TMR_HeapSiftUp(mTmrHeapCount++);
+}
+
+/*! -------------------------------------------------------------------------
+* \brief     Remove a timer from the expiry heap
+* \param[in] timerID - the timer ID
+* \details   Must be called with interrupts disabled, only for timers in the
+*            mTmrStatusActive_c or mTmrStatusReady_c state.
+*---------------------------------------------------------------------------*/
+static void TMR_HeapRemove
+(
+    tmrTimerID_t timerID
+)
+{
+    uint32_t pos = maTmrHeapIndex[timerID];
+
+    if( pos < --mTmrHeapCount )
+    {
+        /* Move the last timer in the freed slot and restore the heap order */
+        maTmrHeap[pos] = maTmrHeap[mTmrHeapCount];
+        maTmrHeapIndex[maTmrHeap[pos]] = pos;
+
+        if( (pos > 0) &&
+            (maTmrTimerTable[maTmrHeap[pos]].expireTicks < maTmrTimerTable[maTmrHeap[(pos - 1) >> 1]].expireTicks) )
+        {
+            TMR_HeapSiftUp(pos);
+        }
+        else
+        {
+            TMR_HeapSiftDown(pos);
+        }
+    }
+}
+
+#if gTMR_EnableProfiling_d
+/*! -------------------------------------------------------------------------
+* \brief     Returns the histogram bin of a value in microseconds
+* \param[in] valueUs - the value in microseconds
+* \return    the bin index
+*---------------------------------------------------------------------------*/
+static uint32_t TMR_ProfilingBin
+(
+    uint32_t valueUs
+)
+{
+    uint32_t bin = 0;
+
+    valueUs >>= mTmrProfilingFirstBinShift_c;
+
+    while( valueUs && (bin < (mTmrProfilingBins_c - 1)) )
+    {
+        valueUs >>= 2;
+        bin++;
+    }
+
+    return bin;
+}
+
+/*! -------------------------------------------------------------------------
+* \brief     Record the lateness and the duration of a timer callback
+* \param[in] timerID - the timer ID
+* \param[in] latenessTicks - ticks between the deadline and the callback
+* \param[in] durationTicks - execution time of the callback in ticks
+*---------------------------------------------------------------------------*/
+static void TMR_ProfilingRecord
+(
+    tmrTimerID_t timerID,
+    tmrTimerTicks64_t latenessTicks,
+    tmrTimerTicks64_t durationTicks
+)
+{
+    tmrTimerProfile_t *pProfile = &maTmrProfile[timerID];
+    uint32_t latenessUs = (uint32_t)(latenessTicks * 1000000 / mCounterFreqHz);
+    uint32_t durationUs = (uint32_t)(durationTicks * 1000000 / mCounterFreqHz);
+
+    TmrIntDisableAll();
+
+    pProfile->expirations++;
+
+    if( latenessUs > pProfile->maxLatenessUs )
+    {
+        pProfile->maxLatenessUs = latenessUs;
+    }
+
+    if( durationUs > pProfile->maxDurationUs )
+    {
+        pProfile->maxDurationUs = durationUs;
+    }
+
+    maTmrLatenessHistogram[TMR_ProfilingBin(latenessUs)]++;
+    maTmrDurationHistogram[TMR_ProfilingBin(durationUs)]++;
+
+    TmrIntRestoreAll();
+}
+#endif
+
 #endif /*gTMR_Enabled_d*/
 
 
@@ -361,9 +826,203 @@ void TMR_RTCAlarmNotify
     /* Clear Interrupt Flag */
     RTC->TAR = RTC->TAR;
     
-    if( gRTCAlarmCallback != NULL )
+    TMR_RTCAlarmExpire();
+}
+
+/*! -------------------------------------------------------------------------
+ * \brief Insert an alarm in the RTC alarm queue, sorted by deadline.
+ *        Must be called with interrupts disabled.
+ *---------------------------------------------------------------------------*/
+static void TMR_RTCAlarmInsert
+(
+    tmrRTCAlarmID_t alarmID
+)
+{
+    tmrRTCAlarmID_t *pLink = &gRTCAlarmHead;
+    
+    /* Alarms with the same deadline expire in the order they were queued */
+    while( (*pLink != gTmrInvalidRTCAlarmID_c) &&
+           (gRTCAlarms[*pLink].deadline <= gRTCAlarms[alarmID].deadline) )
+    {
+        pLink = &gRTCAlarms[*pLink].next;
+    }
+    
+    gRTCAlarms[alarmID].next = *pLink;
+    *pLink = alarmID;
+}
+
+/*! -------------------------------------------------------------------------
+ * \brief Remove an alarm from the RTC alarm queue.
+ *        Must be called with interrupts disabled.
+ * \return TRUE if the alarm was queued
+ *---------------------------------------------------------------------------*/
+static bool_t TMR_RTCAlarmRemove
+(
+    tmrRTCAlarmID_t alarmID
+)
+{
+    tmrRTCAlarmID_t *pLink = &gRTCAlarmHead;
+    
+    while( *pLink != gTmrInvalidRTCAlarmID_c )
+    {
+        if( *pLink == alarmID )
+        {
+            *pLink = gRTCAlarms[alarmID].next;
+            gRTCAlarms[alarmID].pfCallBack = NULL;
+            return TRUE;
+        }
+        pLink = &gRTCAlarms[*pLink].next;
+    }
+    
+    return FALSE;
+}
+
+/*! -------------------------------------------------------------------------
+ * \brief Run the callbacks of the expired alarms and program the RTC
+ *        compare for the first alarm left in the queue.
+ *        Called from the RTC alarm interrupt only.
+ *---------------------------------------------------------------------------*/
+static void TMR_RTCAlarmExpire
+(
+    void
+)
+{
+    tmrRTCAlarm_t *pAlarm;
+    tmrRTCAlarmID_t alarmID;
+    pfTmrCallBack_t pfCallBack;
+    void *param;
+    uint64_t now;
+    
+    for(;;)
+    {
+        TmrIntDisableAll();
+        now = TMR_RTCGetTimestamp();
+        
+        if( (gRTCAlarmHead == gTmrInvalidRTCAlarmID_c) ||
+            (gRTCAlarms[gRTCAlarmHead].deadline > now) )
+        {
+            TMR_RTCAlarmProgram();
+            TmrIntRestoreAll();
+            break;
+        }
+        
+        alarmID = gRTCAlarmHead;
+        pAlarm = &gRTCAlarms[alarmID];
+        pfCallBack = pAlarm->pfCallBack;
+        param = pAlarm->param;
+        gRTCAlarmHead = pAlarm->next;
+        
+        if( pAlarm->intervalInSeconds )
+        {
+            pAlarm->deadline += TmrSecondsToMicroseconds((uint64_t)pAlarm->intervalInSeconds);
+            
+            /* Skip the periods which were missed */
+            if( pAlarm->deadline <= now )
+            {
+                pAlarm->deadline = now + TmrSecondsToMicroseconds((uint64_t)pAlarm->intervalInSeconds);
+            }
+            
+            TMR_RTCAlarmInsert(alarmID);
+        }
+        else
+        {
+            pAlarm->pfCallBack = NULL;
+        }
+        
+        TmrIntRestoreAll();
+        
+        if( pfCallBack != NULL )
+        {
+            pfCallBack(param);
+        }
+    }
+}
+
+/*! -------------------------------------------------------------------------
+ * \brief Program the RTC compare for the first alarm in the queue, or pend
+ *        the RTC alarm interrupt if that alarm is already due.
+ *        Must be called with interrupts disabled.
+ * \details The callbacks are only run by TMR_RTCAlarmExpire(), from the RTC
+ *        alarm interrupt, never in the context of the caller.
+ *---------------------------------------------------------------------------*/
+static void TMR_RTCAlarmProgram
+(
+    void
+)
+{
+    tmrRTCAlarm_t *pAlarm;
+    uint64_t ticks;
+    uint32_t seconds;
+    
+    if( gRTCAlarmHead == gTmrInvalidRTCAlarmID_c )
+    {
+        /* Disable alarm interrupt */
+        RTC->IER &= ~RTC_IER_TAIE_MASK;
+        return;
+    }
+    
+    pAlarm = &gRTCAlarms[gRTCAlarmHead];
+    
+    if( pAlarm->deadline <= TMR_RTCGetTimestamp() )
+    {
+        NVIC_SetPendingIRQ(RTC_IRQn);
+        return;
+    }
+    
+    /* The alarm flag is set when the RTC seconds advance past TAR, which is
+       the time ((TAR << 15) + gRTCPrescalerOffset) RTC ticks from the offset.
+       Use the first second which is not earlier than the deadline. */
+    ticks = pAlarm->deadline - gRTCTimeOffset;
+    ticks = ((ticks << 9) + 15624) / 15625;
+    ticks = (ticks > gRTCPrescalerOffset) ? (ticks - gRTCPrescalerOffset) : 0;
+    seconds = (uint32_t)((ticks + 0x7FFF) >> 15);
+    
+    RTC->TAR = seconds;
+    /* Enable alarm interrupt */
+    RTC->IER |= RTC_IER_TAIE_MASK;
+    
+    /* If the seconds already went past TAR, the alarm was missed */
+    if( RTC->TSR > seconds )
     {
-        gRTCAlarmCallback(gRTCAlarmCallbackParam);
+        NVIC_SetPendingIRQ(RTC_IRQn);
+    }
+}
+
+/*! -------------------------------------------------------------------------
+ * \brief Align the RTC seconds with the current time, so that a relative
+ *        alarm expires after an exact number of seconds.
+ *        Must be called with interrupts disabled.
+ *---------------------------------------------------------------------------*/
+static void TMR_RTCAlignSeconds
+(
+    void
+)
+{
+    uint32_t rtcSeconds, rtcPrescaler;
+    
+    /* Stop counter */
+    RTC->SR &= ~RTC_SR_TCE_MASK;
+    rtcSeconds = RTC->TSR;
+    rtcPrescaler = RTC->TPR;
+    RTC->TPR = 0x00;
+    /*If bit prescaler 14 transitions from 1 to 0 the seconds reg get incremented.
+    Rewrite seconds register to prevent this.*/
+    RTC->TSR = rtcSeconds;
+    /* Start counter */
+    RTC->SR |= RTC_SR_TCE_MASK;
+    rtcPrescaler &= 0x7fff;
+    
+    gRTCPrescalerOffset += rtcPrescaler;
+    
+    if(gRTCPrescalerOffset & 0x8000)
+    {
+        rtcSeconds++;
+        /* Stop counter */
+        RTC->SR &= ~RTC_SR_TCE_MASK;
+        RTC->TSR = rtcSeconds;
+        /* Start counter */
+        RTC->SR |= RTC_SR_TCE_MASK;
+        gRTCPrescalerOffset = gRTCPrescalerOffset & 0x7FFF;
     }
 }
 
@@ -454,11 +1113,9 @@ void TMR_NotifyClkChanged
 {
     mCounterFreqHz = (uint32_t)((StackTimer_GetInputFrequency()));
     /* Clock was changed, so calculate again  mMaxToCountDown_c.
-    Count to maximum (0xffff - 2*4ms(in ticks)), to be sure that the currentTimeInTicks
-    will never roll over previousTimeInTicks in the TMR_Task() */
+    Count to maximum (0xffff - 8ms(in ticks)), to be sure that the counter
+    will never roll over previousTimeInTicks between two runs of the TMR_Task() */
     mMaxToCountDown_c = 0xFFFF - TmrTicksFromMilliseconds(8);
-    /* The TMR_Task()event will not be issued faster than 4ms*/
-    mTicksFor4ms = TmrTicksFromMilliseconds(4);
 }
 
 /*! -------------------------------------------------------------------------
@@ -470,20 +1127,63 @@ tmrTimerID_t TMR_AllocateTimer
     void
 )
 {
-    uint32_t i;
+    uint32_t i, word, freeTimers;
     tmrTimerID_t id = gTmrInvalidTimerID_c;
 
-    for (i = 0; i < NumberOfElements(maTmrTimerTable); ++i)
+    TmrIntDisableAll();
+
+    for (word = 0; word < mTmrBitmapWords_c; ++word)
     {
-        if (!TMR_IsTimerAllocated(i))
+        freeTimers = ~maTmrAllocatedBitmap[word];
+
+        if (freeTimers)
         {
-            TMR_SetTimerStatus(i, mTmrStatusInactive_c);
-            id = i;
+            /* Lowest free timer ID of this word. Bits past the end of the
+               table are never set, so they are only found if the table is full */
+            i = (word << 5) + (31 - __CLZ(freeTimers & (0 - freeTimers)));
+
+            if (i < NumberOfElements(maTmrTimerTable))
+            {
+                maTmrAllocatedBitmap[word] |= mTmrBitmapMask(i);
+                TMR_SetTimerStatus(i, mTmrStatusInactive_c);
+                id = i;
+
+                if (++mTmrAllocatedTimers > mTmrAllocatedTimersPeak)
+                {
+                    mTmrAllocatedTimersPeak = mTmrAllocatedTimers;
+                }
+            }
             break;
         }
-   }
+    }
 
-   return id;
+    TmrIntRestoreAll();
+
+    return id;
+}
+
+/*! -------------------------------------------------------------------------
+ * \brief  Returns the number of allocated timers
+ * \return number of allocated timers
+ *---------------------------------------------------------------------------*/
+uint8_t TMR_GetAllocatedTimers
+(
+    void
+)
+{
+    return mTmrAllocatedTimers;
+}
+
+/*! -------------------------------------------------------------------------
+ * \brief  Returns the high-water mark of the allocated timers
+ * \return highest number of timers allocated at the same time
+ *---------------------------------------------------------------------------*/
+uint8_t TMR_GetAllocatedTimersPeak
+(
+    void
+)
+{
+    return mTmrAllocatedTimersPeak;
 }
 
 /*! -------------------------------------------------------------------------
@@ -515,7 +1215,11 @@ tmrErrCode_t TMR_FreeTimer
 
     if( status == gTmrSuccess_c )
     {
+        TmrIntDisableAll();
         TMR_MarkTimerFree(timerID);
+        maTmrAllocatedBitmap[mTmrBitmapWord(timerID)] &= ~mTmrBitmapMask(timerID);
+        mTmrAllocatedTimers--;
+        TmrIntRestoreAll();
     }
 
     return gTmrSuccess_c;
@@ -568,11 +1272,11 @@ uint32_t TMR_GetRemainingTime
     tmrTimerID_t tmrID
 )
 {
-    tmrTimerTicks16_t currentTime, elapsedRemainingTicks;
+    tmrTimerTicks64_t currentTime, remainingTicks;
+    tmrStatus_t status;
     uint32_t remainingTime, freq = mCounterFreqHz;
     
-    if( (tmrID >= gTmrTotalTimers_c) || (!TMR_IsTimerAllocated(tmrID)) ||
-        (maTmrTimerTable[tmrID].remainingTicks == 0) )
+    if( (tmrID >= gTmrTotalTimers_c) || (!TMR_IsTimerAllocated(tmrID)) )
     {
         remainingTime = 0;
     }
@@ -580,25 +1284,30 @@ uint32_t TMR_GetRemainingTime
     {
         TmrIntDisableAll();
         
-        currentTime = StackTimer_GetCounterValue();
+        status = TMR_GetTimerStatus(tmrID);
         
-        if(currentTime < maTmrTimerTable[tmrID].timestamp)
+        if( (status == mTmrStatusActive_c) || (status == mTmrStatusReady_c) )
         {
-            currentTime += 0xFFFF;
-        }
-        
-        elapsedRemainingTicks = currentTime - maTmrTimerTable[tmrID].timestamp;
-        
-        if(elapsedRemainingTicks > maTmrTimerTable[tmrID].remainingTicks)
-        {
-            remainingTime = 1;
+            currentTime = TMR_GetCurrentTicks();
+            
+            if( maTmrTimerTable[tmrID].expireTicks > currentTime )
+            {
+                remainingTicks = maTmrTimerTable[tmrID].expireTicks - currentTime;
+            }
+            else
+            {
+                /* Expired, but not yet processed by the timer thread */
+                remainingTicks = 1;
+            }
         }
         else
         {
-            remainingTime = ((uint64_t)(maTmrTimerTable[tmrID].remainingTicks - elapsedRemainingTicks) * 1000 + freq - 1) / freq;
+            remainingTicks = 0;
         }
         
         TmrIntRestoreAll();
+        
+        remainingTime = (remainingTicks * 1000 + freq - 1) / freq;
     }
     
     return remainingTime;
@@ -633,28 +1342,56 @@ uint32_t TMR_GetFirstExpireTime(tmrTimerType_t timerType)
 }
 
 /*! -------------------------------------------------------------------------
- * \brief Start a specified timer
+ * \brief Start a specified timer
+ * \param[in] timerId - the ID of the timer
+ * \param[in] timerType - the type of the timer
+ * \param[in] timeInMilliseconds - time expressed in millisecond units
+ * \param[in] pfTmrCallBack - callback function
+ * \param[in] param - parameter to callback function
+ *
+ * \details When the timer expires, the callback function is called in
+ *        non-interrupt context. If the timer is already running when
+ *        this function is called, it will be stopped and restarted.
+ *---------------------------------------------------------------------------*/
+tmrErrCode_t TMR_StartTimer
+(
+    tmrTimerID_t timerID,
+    tmrTimerType_t timerType,
+    tmrTimeInMilliseconds_t timeInMilliseconds,
+    pfTmrCallBack_t callback,
+    void *param
+)
+{
+    return TMR_StartTimerWithSlack(timerID, timerType, timeInMilliseconds, 0, callback, param);
+}
+
+/*! -------------------------------------------------------------------------
+ * \brief Start a specified timer, which may expire late
  * \param[in] timerId - the ID of the timer
  * \param[in] timerType - the type of the timer
  * \param[in] timeInMilliseconds - time expressed in millisecond units
+ * \param[in] slackInMilliseconds - allowed lateness, in millisecond units
  * \param[in] pfTmrCallBack - callback function
  * \param[in] param - parameter to callback function
  *
- * \details When the timer expires, the callback function is called in
- *        non-interrupt context. If the timer is already running when
- *        this function is called, it will be stopped and restarted.
+ * \details Same as TMR_StartTimer(), but the callback may be called up to
+ *        slackInMilliseconds after the timeout, so that the timer thread
+ *        processes it in the same run as other timers. The slack of an
+ *        interval timer is kept below its interval.
  *---------------------------------------------------------------------------*/
-tmrErrCode_t TMR_StartTimer
+tmrErrCode_t TMR_StartTimerWithSlack
 (
     tmrTimerID_t timerID,
     tmrTimerType_t timerType,
     tmrTimeInMilliseconds_t timeInMilliseconds,
+    tmrTimeInMilliseconds_t slackInMilliseconds,
     pfTmrCallBack_t callback,
     void *param
 )
 {
     tmrErrCode_t status;
     tmrTimerTicks64_t intervalInTicks;
+    tmrTimerTicks64_t slackInTicks;
 
     /* Stopping an already stopped timer is harmless. */
     status = TMR_StopTimer(timerID);
@@ -662,16 +1399,24 @@ tmrErrCode_t TMR_StartTimer
     if( status == gTmrSuccess_c )
     {
         intervalInTicks = TmrTicksFromMilliseconds(timeInMilliseconds);
-        maTmrTimerTable[timerID].timestamp = StackTimer_GetCounterValue();
         
         if( !intervalInTicks )
         {
             intervalInTicks = 1;
         }
         
+        slackInTicks = TmrTicksFromMilliseconds(slackInMilliseconds);
+
+        /* An interval timer processed after its next period would skip it */
+        if( !(timerType & (gTmrSingleShotTimer_c | gTmrSetMinuteTimer_c | gTmrSetSecondTimer_c)) &&
+            (slackInTicks >= intervalInTicks) )
+        {
+            slackInTicks = intervalInTicks - 1;
+        }
+
         TMR_SetTimerType(timerID, timerType);
         maTmrTimerTable[timerID].intervalInTicks = intervalInTicks;
-        maTmrTimerTable[timerID].remainingTicks = intervalInTicks;
+        maTmrTimerTable[timerID].slackInTicks = slackInTicks;
         maTmrTimerTable[timerID].pfCallBack = callback;
         maTmrTimerTable[timerID].param = param;
         
@@ -682,6 +1427,111 @@ tmrErrCode_t TMR_StartTimer
     return status;
 }
 
+/*! -------------------------------------------------------------------------
+ * \brief  Returns the number of timer thread runs saved by coalescing
+ * \return number of saved runs
+ *---------------------------------------------------------------------------*/
+uint32_t TMR_GetWakeupsSaved
+(
+    void
+)
+{
+    return mTmrWakeupsSaved;
+}
+
+#if gTMR_EnableProfiling_d
+/*! -------------------------------------------------------------------------
+ * \brief     Writes the timer callbacks profile to a serial interface: the
+ *            expirations, worst lateness and worst duration of each timer,
+ *            followed by the lateness and duration histograms.
+ * \param[in] interfaceId - The SerialManager interface.
+ *---------------------------------------------------------------------------*/
+void TMR_ProfilingReport
+(
+    uint8_t interfaceId
+)
+{
+    tmrTimerProfile_t profile;
+    uint32_t lateness, duration;
+    uint32_t i;
+
+    (void)Serial_Print(interfaceId, "\r\nTimer Count MaxLate(us) MaxRun(us)\r\n", gAllowToBlock_d);
+
+    for( i = 0; i < NumberOfElements(maTmrProfile); i++ )
+    {
+        TmrIntDisableAll();
+        profile = maTmrProfile[i];
+        TmrIntRestoreAll();
+
+        if( profile.expirations )
+        {
+            (void)Serial_PrintDec(interfaceId, i);
+            (void)Serial_Print(interfaceId, " ", gAllowToBlock_d);
+            (void)Serial_PrintDec(interfaceId, profile.expirations);
+            (void)Serial_Print(interfaceId, " ", gAllowToBlock_d);
+            (void)Serial_PrintDec(interfaceId, profile.maxLatenessUs);
+            (void)Serial_Print(interfaceId, " ", gAllowToBlock_d);
+            (void)Serial_PrintDec(interfaceId, profile.maxDurationUs);
+            (void)Serial_Print(interfaceId, "\r\n", gAllowToBlock_d);
+        }
+    }
+
+    (void)Serial_Print(interfaceId, "Bin(us) Late Run\r\n", gAllowToBlock_d);
+
+    for( i = 0; i < mTmrProfilingBins_c; i++ )
+    {
+        TmrIntDisableAll();
+        lateness = maTmrLatenessHistogram[i];
+        duration = maTmrDurationHistogram[i];
+        TmrIntRestoreAll();
+
+        if( i < (mTmrProfilingBins_c - 1) )
+        {
+            (void)Serial_Print(interfaceId, "<", gAllowToBlock_d);
+            (void)Serial_PrintDec(interfaceId, 1UL << (mTmrProfilingFirstBinShift_c + 2 * i));
+        }
+        else
+        {
+            (void)Serial_Print(interfaceId, ">=", gAllowToBlock_d);
+            (void)Serial_PrintDec(interfaceId, 1UL << (mTmrProfilingFirstBinShift_c + 2 * (i - 1)));
+        }
+        (void)Serial_Print(interfaceId, " ", gAllowToBlock_d);
+        (void)Serial_PrintDec(interfaceId, lateness);
+        (void)Serial_Print(interfaceId, " ", gAllowToBlock_d);
+        (void)Serial_PrintDec(interfaceId, duration);
+        (void)Serial_Print(interfaceId, "\r\n", gAllowToBlock_d);
+    }
+}
+
+/*! -------------------------------------------------------------------------
+ * \brief   Clears the timer callbacks profile
+ *---------------------------------------------------------------------------*/
+void TMR_ProfilingReset
+(
+    void
+)
+{
+    uint32_t i;
+
+    TmrIntDisableAll();
+
+    for( i = 0; i < NumberOfElements(maTmrProfile); i++ )
+    {
+        maTmrProfile[i].expirations = 0;
+        maTmrProfile[i].maxLatenessUs = 0;
+        maTmrProfile[i].maxDurationUs = 0;
+    }
+
+    for( i = 0; i < mTmrProfilingBins_c; i++ )
+    {
+        maTmrLatenessHistogram[i] = 0;
+        maTmrDurationHistogram[i] = 0;
+    }
+
+    TmrIntRestoreAll();
+}
+#endif
+
 /*! -------------------------------------------------------------------------
  * \brief Start a low power timer. When the timer goes off, call the
  *              callback function in non-interrupt context.
@@ -880,6 +1730,9 @@ tmrErrCode_t TMR_StopTimer
         
         if ( (status == mTmrStatusActive_c) || (status == mTmrStatusReady_c) )
         {
+            TMR_HeapRemove(timerID);
+            maTmrReadyBitmap[mTmrBitmapWord(timerID)] &= ~mTmrBitmapMask(timerID);
+            
             TMR_SetTimerStatus(timerID, mTmrStatusInactive_c);
             DecrementActiveTimerNumber(TMR_GetTimerType(timerID));
             /* if no sw active timers are enabled, */
@@ -913,13 +1766,22 @@ void TMR_Task
     osaTaskParam_t param
 )
 {
+    tmrTimerTicks64_t currentTicks;
+    tmrTimerTicks64_t ticksToNextExpiry;
     tmrTimerTicks16_t nextInterruptTime;
-    tmrTimerTicks16_t currentTimeInTicks;
-    tmrTimerTicks16_t ticksSinceLastHere, ticksdiff;
     pfTmrCallBack_t   pfCallBack;
     tmrTimerType_t    timerType;
-    tmrTimerStatus_t  status;
-    uint8_t timerID;
+    void             *callbackParam;
+    uint32_t          readyTimers;
+    uint32_t          word;
+    uint32_t          timerID;
+    bool_t            runAgain;
+    bool_t            firstExpiry;
+    tmrTimerTicks64_t lastExpireTicks = 0;
+#if gTMR_EnableProfiling_d
+    tmrTimerTicks64_t callbackStartTicks;
+    tmrTimerTicks64_t callbackEndTicks;
+#endif
 
     param=param;
 
@@ -932,141 +1794,173 @@ void TMR_Task
     {
         (void)OSA_EventWait(mTimerThreadEventId, osaEventFlagsAll_c, FALSE, osaWaitForever_c, &ev);
 #endif
-        TmrIntDisableAll();
-
-        currentTimeInTicks = StackTimer_GetCounterValue();
-
-        TmrIntRestoreAll();
-
-        /* calculate difference between current and previous.  */
-        ticksSinceLastHere = (currentTimeInTicks - previousTimeInTicks);
-        /* remember for next time */
-        previousTimeInTicks = currentTimeInTicks;
-        /* Find the shortest active timer. */
-        nextInterruptTime = mMaxToCountDown_c;
-
-        for (timerID = 0; timerID < NumberOfElements(maTmrTimerTable); ++timerID)
+        do
         {
-            timerType = TMR_GetTimerType(timerID);
-
             TmrIntDisableAll();
-            status = TMR_GetTimerStatus(timerID);
-            /* If TMR_StartTimer() has been called for this timer, start it's count */
-            /* down as of now. */
-            if( status == mTmrStatusReady_c )
+            currentTicks = TMR_GetCurrentTicks();
+            TmrIntRestoreAll();
+
+            /* The timers started since the last run are already queued, */
+            /* with their absolute deadline. Mark them as active. */
+            for (word = 0; word < mTmrBitmapWords_c; ++word)
             {
-                TMR_SetTimerStatus(timerID, mTmrStatusActive_c);
-                TmrIntRestoreAll();
+                TmrIntDisableAll();
+                readyTimers = maTmrReadyBitmap[word];
+                maTmrReadyBitmap[word] = 0;
 
-                if (nextInterruptTime > maTmrTimerTable[timerID].remainingTicks)
+                while (readyTimers)
                 {
-                    nextInterruptTime = maTmrTimerTable[timerID].remainingTicks;
-                }                
+                    timerID = (word << 5) + (31 - __CLZ(readyTimers));
+                    readyTimers &= ~mTmrBitmapMask(timerID);
+                    TMR_SetTimerStatus(timerID, mTmrStatusActive_c);
+                }
+
+                TmrIntRestoreAll();
             }
-            else if (status == mTmrStatusActive_c)
+
+            /* Process the expired timers, in expiry order. */
+            firstExpiry = TRUE;
+
+            while (1)
             {
-                TmrIntRestoreAll();
-                /* This timer is active. Decrement it's countdown.. */
-                if (maTmrTimerTable[timerID].remainingTicks > ticksSinceLastHere)
+                TmrIntDisableAll();
+
+                if ( (mTmrHeapCount == 0) ||
+                     (maTmrTimerTable[maTmrHeap[0]].expireTicks > currentTicks) )
                 {
-                    TmrIntDisableAll();
-                    maTmrTimerTable[timerID].remainingTicks -= ticksSinceLastHere;
-                    maTmrTimerTable[timerID].timestamp = StackTimer_GetCounterValue();
                     TmrIntRestoreAll();
-                    
-                    if (nextInterruptTime > maTmrTimerTable[timerID].remainingTicks)
+                    break;
+                }
+
+                timerID = maTmrHeap[0];
+                timerType = TMR_GetTimerType(timerID);
+
+                /* Each different deadline up to the coalesced wakeup would have
+                   needed its own run, without the slack */
+                if ( (!firstExpiry) &&
+                     (maTmrTimerTable[timerID].expireTicks != lastExpireTicks) &&
+                     (maTmrTimerTable[timerID].expireTicks <= mTmrCoalescedWakeup) )
+                {
+                    mTmrWakeupsSaved++;
+                }
+
+                firstExpiry = FALSE;
+                lastExpireTicks = maTmrTimerTable[timerID].expireTicks;
+
+                /* If this is an interval timer, restart it. Otherwise, mark it as inactive. */
+                if ( (timerType & gTmrSingleShotTimer_c) ||
+                     (timerType & gTmrSetMinuteTimer_c)  ||
+                     (timerType & gTmrSetSecondTimer_c)  )
+                {
+                    (void)TMR_StopTimer(timerID);
+                }
+                else
+                {
+                    maTmrTimerTable[timerID].expireTicks += maTmrTimerTable[timerID].intervalInTicks;
+
+                    /* Do not try to catch up with periods missed by a late thread.
+                       The slack alone never gets here: it is below the interval. */
+                    if (maTmrTimerTable[timerID].expireTicks <= currentTicks)
                     {
-                        nextInterruptTime = maTmrTimerTable[timerID].remainingTicks;
+                        maTmrTimerTable[timerID].expireTicks = currentTicks + maTmrTimerTable[timerID].intervalInTicks;
                     }
+
+                    TMR_HeapSiftDown(0);
                 }
-                else
+
+                /* This timer has expired. */
+                pfCallBack = maTmrTimerTable[timerID].pfCallBack;
+                callbackParam = maTmrTimerTable[timerID].param;
+#if gTMR_EnableProfiling_d
+                callbackStartTicks = TMR_GetCurrentTicks();
+#endif
+                TmrIntRestoreAll();
+
+                /*Call callback if it is not NULL
+                This is done after the timer got updated,
+                in case the timer gets stopped or restarted in the callback*/
+                if (pfCallBack)
+                {
+                    pfCallBack(callbackParam);
+                }
+
+#if gTMR_EnableProfiling_d
+                TmrIntDisableAll();
+                callbackEndTicks = TMR_GetCurrentTicks();
+                TmrIntRestoreAll();
+                TMR_ProfilingRecord(timerID, callbackStartTicks - lastExpireTicks, callbackEndTicks - callbackStartTicks);
+#endif
+            }
+
+            TmrIntDisableAll();
+
+            /* The callbacks took some time, so read the counter again */
+            currentTicks = TMR_GetCurrentTicks();
+            runAgain = FALSE;
+            mTmrCoalescedWakeup = 0;
+
+            if ( numberOfActiveTimers || numberOfLowPowerActiveTimers ) /*not about to stop*/
+            {
+                /* Find the shortest active timer. */
+                ticksToNextExpiry = mMaxToCountDown_c;
+
+                if ( (mTmrHeapCount) &&
+                     (maTmrTimerTable[maTmrHeap[0]].expireTicks < currentTicks + ticksToNextExpiry) )
                 {
-                    /* If this is an interval timer, restart it. Otherwise, mark it as inactive. */
-                    if ( (timerType & gTmrSingleShotTimer_c) ||
-                         (timerType & gTmrSetMinuteTimer_c)  ||
-                         (timerType & gTmrSetSecondTimer_c)  )
+                    ticksToNextExpiry = maTmrTimerTable[maTmrHeap[0]].expireTicks - currentTicks;
+
+                    /* Next ticks to count already expired or too close to be
+                       loaded in Cmp Reg.?? Process them now. */
+                    if ( (maTmrTimerTable[maTmrHeap[0]].expireTicks <= currentTicks) ||
+                         (ticksToNextExpiry < mTmrMinCompareTicks_c) )
                     {
-                        maTmrTimerTable[timerID].remainingTicks = 0;
-                        (void)TMR_StopTimer(timerID);
+                        runAgain = TRUE;
                     }
-                    else
+                    else if ( maTmrTimerTable[maTmrHeap[0]].slackInTicks )
                     {
-                        TmrIntDisableAll();
-                        
-                        maTmrTimerTable[timerID].remainingTicks = maTmrTimerTable[timerID].intervalInTicks;
-                        maTmrTimerTable[timerID].timestamp = StackTimer_GetCounterValue();
-                        if (nextInterruptTime > maTmrTimerTable[timerID].remainingTicks)
+                        /* Delay the wakeup within the slack windows, to process
+                           more timers in a single run */
+                        mTmrCoalescedWakeup = TMR_GetCoalescedWakeup();
+
+                        if ( mTmrCoalescedWakeup > maTmrTimerTable[maTmrHeap[0]].expireTicks )
                         {
-                            nextInterruptTime = maTmrTimerTable[timerID].remainingTicks;
+                            ticksToNextExpiry = mTmrCoalescedWakeup - currentTicks;
+
+                            if ( ticksToNextExpiry > mMaxToCountDown_c )
+                            {
+                                ticksToNextExpiry = mMaxToCountDown_c;
+                            }
+                        }
+                        else
+                        {
+                            mTmrCoalescedWakeup = 0;
                         }
-                        
-                        TmrIntRestoreAll();
-                    }
-                    /* This timer has expired. */
-                    pfCallBack = maTmrTimerTable[timerID].pfCallBack;
-                    /*Call callback if it is not NULL
-                    This is done after the timer got updated,
-                    in case the timer gets stopped or restarted in the callback*/
-                    if (pfCallBack)
-                    {
-                        pfCallBack(maTmrTimerTable[timerID].param);
                     }
                 }
+
+                if ( !runAgain )
+                {
+                    /* Update the compare register */
+                    nextInterruptTime = previousTimeInTicks + (tmrTimerTicks16_t)ticksToNextExpiry;
+
+                    /*Causes a bug with flex timers if CxV is set before hw timer switches off*/
+                    StackTimer_Disable();
+                    StackTimer_SetOffsetTicks(nextInterruptTime);
+                    StackTimer_Enable();
+                    timerHardwareIsRunning = TRUE;
+                }
             }
             else
             {
-                TmrIntRestoreAll();
-                /* Ignore any timer that is not active. */
-            }
-        }  /* for (timerID = 0; timerID < ... */
-
-        TmrIntDisableAll();
-
-        /* Check to be sure that the timer was not programmed in the past for different source clocks.
-         * The interrupts are now disabled.
-         */
-        ticksdiff = StackTimer_GetCounterValue();
-
-        /* Number of ticks to be here */
-        ticksdiff = (uint16_t)(ticksdiff - currentTimeInTicks);
-
-        /* Next ticks to count already expired?? */
-        if(ticksdiff >= nextInterruptTime)
-        {
-            /* Is assumed that a thread has to be executed in 4ms...
-            so if the ticks already expired enter in TMR_Task() after 4ms*/
-            nextInterruptTime = ticksdiff + mTicksFor4ms;
-        }
-        else
-        {
-            /* Time reference is 4ms, so be sure that won't be loaded
-               in Cmp Reg. less that 4ms in ticks */
-            if((nextInterruptTime - ticksdiff) < mTicksFor4ms)
-            {
-                nextInterruptTime = ticksdiff + mTicksFor4ms;
+                if( timerHardwareIsRunning )
+                {
+                    StackTimer_Disable();
+                    timerHardwareIsRunning = FALSE;
+                }
             }
-        }
-        /* Update the compare register */
-        nextInterruptTime += currentTimeInTicks;
 
-        if( numberOfActiveTimers || numberOfLowPowerActiveTimers ) /*not about to stop*/
-        {
-            /*Causes a bug with flex timers if CxV is set before hw timer switches off*/
-            StackTimer_Disable();
-            StackTimer_SetOffsetTicks(nextInterruptTime);
-            StackTimer_Enable();
-            timerHardwareIsRunning = TRUE;
-        }
-        else
-        {
-            if( timerHardwareIsRunning )
-            {
-                StackTimer_Disable();
-                timerHardwareIsRunning = FALSE;
-            }
-        }
-            
-        TmrIntRestoreAll();      
+            TmrIntRestoreAll();
+        } while (runAgain);
 
 #if !defined(FWK_SMALL_RAM_CONFIG)        
         /* For BareMetal break the while(1) after 1 run */
@@ -1093,6 +1987,10 @@ void TMR_EnableTimer
     {
         IncrementActiveTimerNumber(TMR_GetTimerType(tmrID));
         TMR_SetTimerStatus(tmrID, mTmrStatusReady_c);
+        /* The deadline is absolute, the countdown starts now */
+        maTmrTimerTable[tmrID].expireTicks = TMR_GetCurrentTicks() + maTmrTimerTable[tmrID].intervalInTicks;
+        TMR_HeapInsert(tmrID);
+        maTmrReadyBitmap[mTmrBitmapWord(tmrID)] |= mTmrBitmapMask(tmrID);
         (void)OSA_EventSet(mTimerThreadEventId, mTmrDummyEvent_c);
     }
 
@@ -1140,39 +2038,19 @@ void TMR_SyncLpmTimers
 )
 {
 #if (gTMR_EnableLowPowerTimers_d)
-    uint32_t  timerID;
-    tmrTimerType_t timerType;
-
     /* Check if there are low power active timer */
     if (numberOfLowPowerActiveTimers)
     {
-        /* For each timer, detect the timer type and count down the spent duration in sleep */
-        for (timerID = 0; timerID < NumberOfElements(maTmrTimerTable); ++timerID)
-        {
-            /* Detect the timer type and count down the spent duration in sleep */
-            timerType = TMR_GetTimerType(timerID);
-            
-            /* Sync. only the low power timers that are active */
-            if ( (TMR_GetTimerStatus(timerID) == mTmrStatusActive_c)
-                && (IsLowPowerTimer(timerType)) )
-            {
-                /* Timer expired when MCU was in sleep mode??? */
-                if( maTmrTimerTable[timerID].remainingTicks > sleepDurationTmrTicks)
-                {
-                    maTmrTimerTable[timerID].remainingTicks -= sleepDurationTmrTicks;
-                    
-                }
-                else
-                {
-                    maTmrTimerTable[timerID].remainingTicks = 0;
-                }
-                
-            }
-            
-        }/* end for (timerID = 0;.... */
+        /* Only the low power timers may be active while the MCU sleeps, so
+           counting down the spent duration in sleep is just a matter of advancing
+           the time base. The timers that expired are processed by the next run of
+           the timer thread */
+        TmrIntDisableAll();
+        mTmrCurrentTicks += sleepDurationTmrTicks;
         
         StackTimer_Enable();
         previousTimeInTicks = StackTimer_GetCounterValue();
+        TmrIntRestoreAll();
     }
 #else
     sleepDurationTmrTicks = sleepDurationTmrTicks;
@@ -1248,6 +2126,8 @@ bool_t TMR_RTCIsOscStarted(void)
  *---------------------------------------------------------------------------*/
 void TMR_RTCInit(void)
 {
+    uint32_t i;
+    
     TmrIntDisableAll();
     
     if( !gRTCInitFlag )
@@ -1283,8 +2163,11 @@ void TMR_RTCInit(void)
         
         gRTCTimeOffset = 0;
         gRTCPrescalerOffset = 0;
-        gRTCAlarmCallback = NULL;
-        gRTCAlarmCallbackParam = NULL;
+        for( i = 0; i <= gTmrRTCAlarms_c; i++ )
+        {
+            gRTCAlarms[i].pfCallBack = NULL;
+        }
+        gRTCAlarmHead = gTmrInvalidRTCAlarmID_c;
         
         /* Overwrite old ISR */
         OSA_InstallIntHandler(RTC_IRQn, TMR_RTCAlarmNotify);
@@ -1355,40 +2238,25 @@ uint64_t TMR_RTCGetTimestamp(void)
  *---------------------------------------------------------------------------*/
 void TMR_RTCSetTime(uint64_t microseconds)
 {
-    uint64_t initialAlarm;
-    
     if( gRTCInitFlag )
     {
         TmrIntDisableAll();
         /* Stop counter */
         RTC->SR &= ~RTC_SR_TCE_MASK;
         
-        initialAlarm = gRTCTimeOffset;
-        initialAlarm = RTC->TAR + (initialAlarm/1000000L);
         gRTCTimeOffset = microseconds;
         /* Set RTC seconds */
         RTC->TSR = 0x01;
         /* Set RTC Prescaller */
         RTC->TPR = 0x00;
         
-        if( (initialAlarm * 1000000L) <= microseconds )
-        {
-            /* Disable alarm interrupt */
-            RTC->IER &= ~RTC_IER_TAIE_MASK;
-            if( gRTCAlarmCallback != NULL )
-            {
-                gRTCAlarmCallback(gRTCAlarmCallbackParam);
-            }
-        }
-        else
-        {
-            /* Set alarm time */
-            RTC->TAR = initialAlarm - (microseconds/1000000L);
-        }
-        
         /* Start counter */
         RTC->SR |= RTC_SR_TCE_MASK;;
         
+        /* Alarms earlier than the new time expire now, the others are
+           rescheduled relative to the new time */
+        TMR_RTCAlarmProgram();
+        
         TmrIntRestoreAll();
     }
 }
@@ -1401,17 +2269,25 @@ void TMR_RTCSetTime(uint64_t microseconds)
  *---------------------------------------------------------------------------*/
 void TMR_RTCSetAlarm(uint64_t seconds, pfTmrCallBack_t callback, void *param)
 {
+    tmrRTCAlarm_t *pAlarm = &gRTCAlarms[gTmrRTCAlarms_c];
+    
     if( gRTCInitFlag )
     {
         TmrIntDisableAll();
         
-        gRTCAlarmCallback = callback;
-        gRTCAlarmCallbackParam = param;
-        seconds = seconds - (gRTCTimeOffset/1000000L);
-        /* Set alarm time */
-        RTC->TAR = seconds;
-        /* Enable alarm interrupt */
-        RTC->IER |= RTC_IER_TAIE_MASK;;
+        /* Replace the previous alarm */
+        (void)TMR_RTCAlarmRemove(gTmrRTCAlarms_c);
+        
+        if( callback != NULL )
+        {
+            pAlarm->deadline = TmrSecondsToMicroseconds(seconds);
+            pAlarm->intervalInSeconds = 0;
+            pAlarm->pfCallBack = callback;
+            pAlarm->param = param;
+            TMR_RTCAlarmInsert(gTmrRTCAlarms_c);
+        }
+        
+        TMR_RTCAlarmProgram();
         
         TmrIntRestoreAll();
     }
@@ -1425,52 +2301,127 @@ void TMR_RTCSetAlarm(uint64_t seconds, pfTmrCallBack_t callback, void *param)
  *---------------------------------------------------------------------------*/
 void TMR_RTCSetAlarmRelative(uint32_t seconds, pfTmrCallBack_t callback, void *param)
 {
-    uint32_t rtcSeconds, rtcPrescaler;
+    tmrRTCAlarm_t *pAlarm = &gRTCAlarms[gTmrRTCAlarms_c];
     
     if( gRTCInitFlag )
     {
-        if( seconds == 0 )
+        TmrIntDisableAll();
+        
+        /* Replace the previous alarm. An alarm in 0 seconds is due at once,
+           and is run by the RTC alarm interrupt as the others. */
+        (void)TMR_RTCAlarmRemove(gTmrRTCAlarms_c);
+        TMR_RTCAlignSeconds();
+        
+        pAlarm->deadline = TMR_RTCGetTimestamp() + TmrSecondsToMicroseconds((uint64_t)seconds);
+        pAlarm->intervalInSeconds = 0;
+        pAlarm->pfCallBack = callback;
+        pAlarm->param = param;
+        TMR_RTCAlarmInsert(gTmrRTCAlarms_c);
+        TMR_RTCAlarmProgram();
+        
+        TmrIntRestoreAll();
+    }
+}
+
+/*! -------------------------------------------------------------------------
+ * \brief     Queues an RTC alarm at an absolute time.
+ * \param[in] seconds - Absolute time in seconds for the first alarm.
+ * \param[in] intervalSeconds - Period of the following alarms, 0 for a single alarm.
+ * \param[in] callback - Callback function pointer.
+ * \param[in] param - Parameter for callback.
+ * \return    the alarm id, or gTmrInvalidRTCAlarmID_c if the queue is full
+ *---------------------------------------------------------------------------*/
+tmrRTCAlarmID_t TMR_RTCStartAlarm(uint64_t seconds, uint32_t intervalSeconds, pfTmrCallBack_t callback, void *param)
+{
+    tmrRTCAlarmID_t alarmID = gTmrInvalidRTCAlarmID_c;
+    tmrRTCAlarmID_t i;
+    
+    if( gRTCInitFlag && (callback != NULL) )
+    {
+        TmrIntDisableAll();
+        
+        for( i = 0; i < gTmrRTCAlarms_c; i++ )
         {
-            callback(param);
+            if( gRTCAlarms[i].pfCallBack == NULL )
+            {
+                gRTCAlarms[i].deadline = TmrSecondsToMicroseconds(seconds);
+                gRTCAlarms[i].intervalInSeconds = intervalSeconds;
+                gRTCAlarms[i].pfCallBack = callback;
+                gRTCAlarms[i].param = param;
+                TMR_RTCAlarmInsert(i);
+                TMR_RTCAlarmProgram();
+                alarmID = i;
+                break;
+            }
         }
-        else
+        
+        TmrIntRestoreAll();
+    }
+    
+    return alarmID;
+}
+
+/*! -------------------------------------------------------------------------
+ * \brief     Queues an RTC alarm relative to the current time.
+ * \param[in] seconds - Time in seconds until the first alarm.
+ * \param[in] intervalSeconds - Period of the following alarms, 0 for a single alarm.
+ * \param[in] callback - Callback function pointer.
+ * \param[in] param - Parameter for callback.
+ * \return    the alarm id, or gTmrInvalidRTCAlarmID_c if the queue is full
+ *---------------------------------------------------------------------------*/
+tmrRTCAlarmID_t TMR_RTCStartAlarmRelative(uint32_t seconds, uint32_t intervalSeconds, pfTmrCallBack_t callback, void *param)
+{
+    tmrRTCAlarmID_t alarmID = gTmrInvalidRTCAlarmID_c;
+    tmrRTCAlarmID_t i;
+    
+    if( gRTCInitFlag && (callback != NULL) )
+    {
+        TmrIntDisableAll();
+        
+        for( i = 0; i < gTmrRTCAlarms_c; i++ )
         {
-            TmrIntDisableAll();
-            /* Stop counter */
-            RTC->SR &= ~RTC_SR_TCE_MASK;
-            rtcSeconds = RTC->TSR;
-            rtcPrescaler = RTC->TPR;
-            RTC->TPR = 0x00;
-            /*If bit prescaler 14 transitions from 1 to 0 the seconds reg get incremented.
-            Rewrite seconds register to prevent this.*/
-            RTC->TSR = rtcSeconds;
-            /* Start counter */
-            RTC->SR |= RTC_SR_TCE_MASK;
-            rtcPrescaler &= 0x7fff;
-            
-            gRTCPrescalerOffset += rtcPrescaler;
-            
-            if(gRTCPrescalerOffset & 0x8000)
+            if( gRTCAlarms[i].pfCallBack == NULL )
             {
-                rtcSeconds++;
-                /* Stop counter */
-                RTC->SR &= ~RTC_SR_TCE_MASK;
-                RTC->TSR = rtcSeconds;
-                /* Start counter */
-                RTC->SR |= RTC_SR_TCE_MASK;
-                gRTCPrescalerOffset = gRTCPrescalerOffset & 0x7FFF;
+                gRTCAlarms[i].deadline = TMR_RTCGetTimestamp() + TmrSecondsToMicroseconds((uint64_t)seconds);
+                gRTCAlarms[i].intervalInSeconds = intervalSeconds;
+                gRTCAlarms[i].pfCallBack = callback;
+                gRTCAlarms[i].param = param;
+                TMR_RTCAlarmInsert(i);
+                TMR_RTCAlarmProgram();
+                alarmID = i;
+                break;
             }
-            
-            gRTCAlarmCallback = callback;
-            gRTCAlarmCallbackParam = param;
-            /* Set alarm time */
-            RTC->TAR = seconds + rtcSeconds - 1;
-            /* Enable alarm interrupt */
-            RTC->IER |= RTC_IER_TAIE_MASK;
-            
-            TmrIntRestoreAll();
         }
+        
+        TmrIntRestoreAll();
+    }
+    
+    return alarmID;
+}
+
+/*! -------------------------------------------------------------------------
+ * \brief     Removes an alarm from the RTC alarm queue.
+ * \param[in] alarmID - The id of the alarm.
+ * \return    gTmrSuccess_c, or gTmrInvalidId_c if the alarm is not queued
+ *---------------------------------------------------------------------------*/
+tmrErrCode_t TMR_RTCStopAlarm(tmrRTCAlarmID_t alarmID)
+{
+    tmrErrCode_t status = gTmrInvalidId_c;
+    
+    if( alarmID < gTmrRTCAlarms_c )
+    {
+        TmrIntDisableAll();
+        
+        if( TMR_RTCAlarmRemove(alarmID) )
+        {
+            TMR_RTCAlarmProgram();
+            status = gTmrSuccess_c;
+        }
+        
+        TmrIntRestoreAll();
     }
+    
+    return status;
 }
 
 
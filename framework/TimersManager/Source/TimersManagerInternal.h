@@ -81,6 +81,17 @@
  */
 #define TMR_MarkTimerFree(timerID)       maTmrTimerStatusTable[(timerID)] = 0
 
+/*
+ * \brief number of 32-bit words in a bitmap holding one bit per timer
+ */
+#define mTmrBitmapWords_c       ((gTmrTotalTimers_c + 31) / 32)
+
+/*
+ * \brief word index and bit mask of a timer inside a timer bitmap
+ */
+#define mTmrBitmapWord(timerID) ((timerID) >> 5)
+#define mTmrBitmapMask(timerID) (1UL << ((timerID) & 0x1F))
+
 /*
  * \brief Detect if the timer is a low-power timer
  */
@@ -136,20 +147,50 @@ typedef uint8_t tmrStatus_t;
  * Members: intervalInTicks - The timer's original duration, in ticks.
  *                            Used to reset intervnal timers.
  *
- *          countDown - When a timer is started, this is set to the duration.
- *                      The timer thread decrements this value. When it reaches
- *                      zero, the timer has expired.
+ *          expireTicks - When a timer is started, this is set to the absolute
+ *                        tick count at which it expires. It is the key of the
+ *                        timer in the expiry heap.
+ *          slackInTicks - How late the timer is allowed to expire, so that its
+ *                         expiry can be processed with other timers.
  *          pfCallBack - Pointer to the callback function
  *          param - Parameter to the callback function
  */
 typedef struct tmrTimerTableEntry_tag {
   tmrTimerTicks64_t intervalInTicks;
-  tmrTimerTicks64_t remainingTicks;
+  tmrTimerTicks64_t expireTicks;
+  tmrTimerTicks64_t slackInTicks;
   pfTmrCallBack_t pfCallBack;
   void *param;
-  tmrTimerTicks16_t timestamp; /* all HW counters are 16-bit wide */
 } tmrTimerTableEntry_t;
 
+/*
+ * \brief   Worst case profile of the callback of one timer.
+ * Members: expirations - Number of times the callback was called.
+ *          maxLatenessUs - Worst delay between the deadline and the callback.
+ *          maxDurationUs - Worst execution time of the callback.
+ */
+typedef struct tmrTimerProfile_tag {
+  uint32_t expirations;
+  uint32_t maxLatenessUs;
+  uint32_t maxDurationUs;
+} tmrTimerProfile_t;
+
+/*
+ * \brief   One entry in the RTC alarm queue.
+ * Members: deadline - Absolute time of the next alarm, in microseconds.
+ *          intervalInSeconds - Period of the alarm, 0 for a single alarm.
+ *          pfCallBack - Pointer to the callback function, NULL if the entry is free
+ *          param - Parameter to the callback function
+ *          next - Next alarm in the queue, sorted by deadline
+ */
+typedef struct tmrRTCAlarm_tag {
+  uint64_t deadline;
+  uint32_t intervalInSeconds;
+  pfTmrCallBack_t pfCallBack;
+  void *param;
+  tmrRTCAlarmID_t next;
+} tmrRTCAlarm_t;
+
 #endif /* #ifndef __TIMER_H__ */
 
  /*****************************************************************************
@@ -86,6 +86,30 @@
 #define gMaxPhyTimers_c                 (5)
 #endif
 
+/*! Configure the maximum number of microsecond timers multiplexed on the PHY event timer.
+    Set to 0 to remove the microsecond timers */
+#ifndef gPhyTimeMaxUsTimers_c
+#define gPhyTimeMaxUsTimers_c           (4)
+#endif
+
+/*! Configure the number of expired events waiting to run in the PHY task.
+    Set to 0 to run the callbacks of the deferred events from the PHY timer ISR as well */
+#ifndef gPhyTimeDeferredQueueSize_c
+#define gPhyTimeDeferredQueueSize_c     (0)
+#endif
+
+/*! Bytes reserved in front of the PSDU in the RX buffer, so that the upper layer
+    can build its own headers in place around the received frame */
+#ifndef gPhyRxBufferHeadroom_c
+#define gPhyRxBufferHeadroom_c          (16)
+#endif
+
+/*! Replace the radio event timer with a virtual clock, advanced by PhyTime_HostAdvance(),
+    to run the PHY timer scheduler on a host */
+#ifndef gPhyTimeHostBackend_d
+#define gPhyTimeHostBackend_d           (0)
+#endif
+
 /*! This define is used as a start time to signal that a current sequence is handled as soon as possible by the PHY layer.  */
 #define gPhySeqStartAsap_c              ((phyTime_t)(-1))
 
@@ -97,6 +121,7 @@
 /*! \cond DOXY_SKIP_TAG */
 #define Phy_BufferAlloc(size) MEM_BufferAllocWithId(size,gPhyPoolId,(void*)__get_LR())
 #define Phy_BufferAllocForever(size) MEM_BufferAllocForever(size,gPhyPoolId)
+#define Phy_BufferAllocCriticalForever(size) MEM_BufferAllocForever(size,gPhyPoolId | MEM_CriticalAllocFlag_c)
 /*! \endcond */
 
 
@@ -234,6 +259,7 @@ typedef struct phyTimeEvent_tag
     phyTime_t          timestamp; /*!< Absolute time of the event */
     phyTimeCallback_t  callback;  /*!< Callback function to handle the event */
     uint32_t           parameter; /*!< Parameter to be specified to the callback function */
+    bool_t             deferred;  /*!< If TRUE, the callback runs in the PHY task instead of the PHY timer ISR */
 }phyTimeEvent_t;
 
 /*! PLME-SET-TRX-STATE.Confirm */
@@ -493,6 +519,7 @@ phyTime_t          PhyTime_GetTimestamp ( void );
 /*! *********************************************************************************
  * \brief This function schedules a timed event. 
  *        The event context is given by the configuration structure.
+ *        A deferred event can no longer be canceled once it expired.
  *
  * \param pEvent Pointer to the event data
  *
@@ -521,6 +548,45 @@ phyTimeStatus_t    PhyTime_CancelEvent  ( phyTimeTimerId_t timerId );
  ********************************************************************************** */
 phyTimeStatus_t    PhyTime_CancelEventsWithParam ( uint32_t param );
 
+#if gPhyTimeMaxUsTimers_c
+/*! *********************************************************************************
+ * \brief Start a microsecond timer. All the microsecond timers share a single
+ *        PHY event, programmed for the earliest deadline.
+ *        The resolution is one PHY symbol, and the timer never expires early.
+ *
+ * \param timeoutUs Time until the first expiration, in microseconds
+ * \param periodUs  Time between the following expirations, in microseconds.
+ *                  If 0, the timer expires only once
+ * \param cb        Callback function, called from the PHY timer context
+ * \param param     Parameter of the callback function
+ *
+ * \return Id of the timer, or gInvalidTimerId_c if no timer is available
+ *
+ ********************************************************************************** */
+phyTimeTimerId_t   PhyTime_StartUsTimer ( uint32_t timeoutUs, uint32_t periodUs, phyTimeCallback_t cb, uint32_t param );
+
+/*! *********************************************************************************
+ * \brief Stop a microsecond timer
+ *
+ * \param timerId The id returned by PhyTime_StartUsTimer()
+ *
+ * \return phyTimeStatus_t
+ *
+ ********************************************************************************** */
+phyTimeStatus_t    PhyTime_StopUsTimer  ( phyTimeTimerId_t timerId );
+#endif
+
+#if gPhyTimeHostBackend_d
+/*! *********************************************************************************
+ * \brief Advance the virtual event timer. PhyTime_ISR() is called on every
+ *        compare match on the way.
+ *
+ * \param symbols Number of symbols to advance
+ *
+ ********************************************************************************** */
+void               PhyTime_HostAdvance  ( uint32_t symbols );
+#endif
+
 #ifdef gPHY_802_15_4g_d
 /*! *********************************************************************************
  * \brief Return a 64-bit time-stamp in microseconds
@@ -713,6 +713,7 @@ static void ASP_TxInterval ( uint32_t param )
     ev.timestamp += PhyTime_GetTimestamp();
     ev.callback = ASP_TxInterval;
     ev.parameter = param;
+    ev.deferred = FALSE;
     mAsp_TxTimer = PhyTime_ScheduleEvent(&ev);
     
     ASP_TelecSendRawData( (uint8_t*)param );
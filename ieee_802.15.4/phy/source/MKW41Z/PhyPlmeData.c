@@ -230,7 +230,8 @@ phyStatus_t PhyPlmeRxRequest( phySlottedMode_t phyRxMode, phyRxParams_t *  pRxPa
         
         if( NULL == pRxParams->pRxData )
         {
-            pRxParams->pRxData = Phy_BufferAllocForever(sizeof(pdDataToMacMessage_t) + gMaxPHYPacketSize_c);
+            /* The RX buffer may use the blocks reserved for critical allocations */
+            pRxParams->pRxData = Phy_BufferAllocCriticalForever(sizeof(pdDataToMacMessage_t) + gPhyRxBufferHeadroom_c + gMaxPHYPacketSize_c);
         }
         
         if( NULL == pRxParams->pRxData )
@@ -243,6 +244,7 @@ phyStatus_t PhyPlmeRxRequest( phySlottedMode_t phyRxMode, phyRxParams_t *  pRxPa
                 event.timestamp = PhyTime_GetTimestamp() + gPhyRxRetryInterval_c;
                 event.parameter = 0;
                 event.callback  = PhyRxRetry;
+                event.deferred  = FALSE;
                 gRxRetryTimer = PhyTime_ScheduleEvent( &event );
             }
 #endif
@@ -254,7 +256,7 @@ phyStatus_t PhyPlmeRxRequest( phySlottedMode_t phyRxMode, phyRxParams_t *  pRxPa
             
             pRxParams->pRxData->msgData.dataInd.pPsdu = 
                 (uint8_t*)&pRxParams->pRxData->msgData.dataInd.pPsdu +
-                    sizeof(pRxParams->pRxData->msgData.dataInd.pPsdu);
+                    sizeof(pRxParams->pRxData->msgData.dataInd.pPsdu) + gPhyRxBufferHeadroom_c;
             
             /* Slotted operation */
             if(gPhySlottedMode_c == phyRxMode)
@@ -1022,6 +1022,7 @@ static void PLME_SendMessage(Phy_PhyLocalStruct_t *pPhyStruct, phyMessageId_t ms
             
             ev.parameter = (uint32_t)msgType;
             ev.callback = Phy_SendLatePLME;
+            ev.deferred = FALSE;
             ev.timestamp = gPhyRxRetryInterval_c + PhyTime_GetTimestamp();
             PhyTime_ScheduleEvent(&ev);
         }
@@ -1094,16 +1095,30 @@ static void PD_SendMessage(Phy_PhyLocalStruct_t *pPhyStruct, phyMessageId_t msgT
                         bitMask &= ~(1 << i);
                         pPhyStruct->currentMacInstance = MPM_GetMacInstanceFromRegSet(i);
                         
-                        /* If the packet passed filtering on muliple PANs, send a copy to each one */
+                        /* If the packet passed filtering on muliple PANs, the same message is sent
+                           to each one. Every SAP handler releases its own reference. */
                         if( bitMask )
                         {
-                            pdDataToMacMessage_t *pDataIndCopy;
-                            
-                            pDataIndCopy = Phy_BufferAlloc(sizeof(pdDataToMacMessage_t) + len);
-                            if( pDataIndCopy )
+                            if( MEM_SUCCESS_c == MEM_BufferRetain(pMsg) )
                             {
-                                FLib_MemCpy(pDataIndCopy, pMsg, sizeof(pdDataToMacMessage_t) + len);
-                                pPhyStruct->PD_MAC_SapHandler(pDataIndCopy, pPhyStruct->currentMacInstance);
+                                pPhyStruct->PD_MAC_SapHandler(pMsg, pPhyStruct->currentMacInstance);
+                            }
+                            else
+                            {
+                                /* Blocks carved out of a bigger block cannot be referenced.
+                                   Send a copy instead, with the same headroom. */
+                                pdDataToMacMessage_t *pDataIndCopy;
+                                
+                                pDataIndCopy = Phy_BufferAlloc(sizeof(pdDataToMacMessage_t) + gPhyRxBufferHeadroom_c + len);
+                                if( pDataIndCopy )
+                                {
+                                    FLib_MemCpy(pDataIndCopy, pMsg, sizeof(pdDataToMacMessage_t));
+                                    pDataIndCopy->msgData.dataInd.pPsdu = 
+                                        (uint8_t*)&pDataIndCopy->msgData.dataInd.pPsdu +
+                                            sizeof(pDataIndCopy->msgData.dataInd.pPsdu) + gPhyRxBufferHeadroom_c;
+                                    FLib_MemCpy(pDataIndCopy->msgData.dataInd.pPsdu, pMsg->msgData.dataInd.pPsdu, len);
+                                    pPhyStruct->PD_MAC_SapHandler(pDataIndCopy, pPhyStruct->currentMacInstance);
+                                }
                             }
                         }
                         else
@@ -1137,6 +1152,7 @@ static void PD_SendMessage(Phy_PhyLocalStruct_t *pPhyStruct, phyMessageId_t msgT
                 phyTimeEvent_t ev;
                 
                 ev.callback = Phy_SendLatePD;
+                ev.deferred = FALSE;
                 ev.parameter = (uint32_t)msgType;
                 ev.timestamp = gPhyRxRetryInterval_c + PhyTime_GetTimestamp();
                 PhyTime_ScheduleEvent(&ev);
@@ -49,12 +49,61 @@
 *************************************************************************************
 ********************************************************************************** */
 #define gPhyTimeMinSetupTime_c (4) /* symbols */
+#define gPhyTimeUsPerSymbol_c  (16)
+#define gPhyTimeUsSetupTime_c  (gPhyTimeMinSetupTime_c * gPhyTimeUsPerSymbol_c) /* microseconds */
+
+/* The slot following the public events is reserved for the microsecond timers */
+#if gPhyTimeMaxUsTimers_c
+#define gPhyTimeUsTimersSlot_c (gMaxPhyTimers_c)
+#define gPhyTimeSlots_c        (gMaxPhyTimers_c + 1)
+#else
+#define gPhyTimeSlots_c        (gMaxPhyTimers_c)
+#endif
+
+/* Heap order of two slots. On equal timestamps the lower slot expires first, so that
+   the overflow event is always processed before the events expiring at the same time */
+#define PhyTimeExpiresBefore(a, b) ((mPhyTimers[(a)].timestamp < mPhyTimers[(b)].timestamp) || \
+                                    ((mPhyTimers[(a)].timestamp == mPhyTimers[(b)].timestamp) && ((a) < (b))))
+
+/* PHY task event signaling expired deferred events */
+#define gPhyTimeDeferredEvent_c (1 << 0)
 
 #define BM_ZLL_IRQSTS_TMRxMSK (ZLL_IRQSTS_TMR1MSK_MASK | \
                                ZLL_IRQSTS_TMR2MSK_MASK | \
                                ZLL_IRQSTS_TMR3MSK_MASK | \
                                ZLL_IRQSTS_TMR4MSK_MASK )
 
+/* TMR1 compare match pending */
+#if gPhyTimeHostBackend_d
+#define gPhyTimeHostMask_c     ((((phyTime_t)1) << gPhyTimeShift_c) - 1)
+#define PhyTimeIsWaitTimeoutPending() (mPhyHostWaitIrq)
+#else
+#define PhyTimeIsWaitTimeoutPending() (ZLL->IRQSTS & ZLL_IRQSTS_TMR1IRQ_MASK)
+#endif
+
+/*! *********************************************************************************
+*************************************************************************************
+* Private type definitions
+*************************************************************************************
+********************************************************************************** */
+#if gPhyTimeMaxUsTimers_c
+typedef struct phyUsTimer_tag
+{
+    phyTime_t          deadline;  /* absolute expiration time, in microseconds */
+    uint32_t           period;    /* microseconds, 0 for single shot timers */
+    phyTimeCallback_t  callback;
+    uint32_t           parameter;
+}phyUsTimer_t;
+#endif
+
+#if gPhyTimeDeferredQueueSize_c
+typedef struct phyDeferredCallback_tag
+{
+    phyTimeCallback_t  callback;
+    uint32_t           parameter;
+}phyDeferredCallback_t;
+#endif
+
 /*! *********************************************************************************
 *************************************************************************************
 * Public memory declarations
@@ -68,10 +117,37 @@ void (*gpfPhyTimeNotify)(void) = NULL;
 * Private memory declarations
 *************************************************************************************
 ********************************************************************************** */
-static phyTimeEvent_t  mPhyTimers[gMaxPhyTimers_c];
+static phyTimeEvent_t  mPhyTimers[gPhyTimeSlots_c];
 static phyTimeEvent_t *pNextEvent;
 volatile uint64_t      gPhyTimerOverflow;
 static uint8_t         mPhyActiveTimers;
+/* The last overflow was accounted by PhyTime_ISR() */
+static bool_t          mPhyOverflowCounted;
+/* Binary min-heap of the active events, keyed by timestamp */
+static phyTimeTimerId_t mPhyTimersHeap[gPhyTimeSlots_c];
+static uint8_t         mPhyTimersHeapIndex[gPhyTimeSlots_c];
+/* Stack of the free public event slots */
+static phyTimeTimerId_t mPhyFreeTimers[gMaxPhyTimers_c];
+static uint8_t         mPhyFreeTimersCount;
+#if gPhyTimeMaxUsTimers_c
+static phyUsTimer_t    mPhyUsTimers[gPhyTimeMaxUsTimers_c];
+#endif
+#if gPhyTimeDeferredQueueSize_c
+/* Ring of the expired deferred events. The head is only written by PhyTime_RunCallback(),
+   with interrupts disabled, and the tail only by the PHY task, so the task does not need
+   to disable interrupts. One entry is always left free. */
+static phyDeferredCallback_t mPhyDeferredQueue[gPhyTimeDeferredQueueSize_c + 1];
+static volatile uint8_t mPhyDeferredHead;
+static volatile uint8_t mPhyDeferredTail;
+static osaEventId_t    mPhyTaskEventId;
+#endif
+#if gPhyTimeHostBackend_d
+/* Virtual event timer, in symbols, and its TMR1 compare */
+static phyTime_t       mPhyHostClock;
+static phyTime_t       mPhyHostWaitCompare;
+static bool_t          mPhyHostWaitEnabled;
+static bool_t          mPhyHostWaitIrq;
+#endif
 
 
 /*! *********************************************************************************
@@ -81,6 +157,23 @@ static uint8_t         mPhyActiveTimers;
 ********************************************************************************** */
 static void PhyTime_OverflowCB( uint32_t param );
 static phyTimeEvent_t* PhyTime_GetNextEvent( void );
+static void PhyTime_ReleaseEvent( phyTimeTimerId_t tmr );
+static void PhyTime_HeapInsert( phyTimeTimerId_t tmr );
+static void PhyTime_HeapRemove( phyTimeTimerId_t tmr );
+static void PhyTime_HeapSiftUp( uint32_t pos );
+static void PhyTime_HeapSiftDown( uint32_t pos );
+#if gPhyTimeMaxUsTimers_c
+static void PhyTime_UsTimersCB( uint32_t param );
+static void PhyTime_UsTimersArm( void );
+#endif
+#if gPhyTimeDeferredQueueSize_c
+static void PhyTime_Task( osaTaskParam_t param );
+
+extern const uint8_t gUseRtos_c;
+
+/* The PHY task runs the callbacks of the deferred events */
+OSA_TASK_DEFINE( PhyTime_Task, gPhyTaskPriority_c, 1, gPhyTaskStackSize_c, FALSE );
+#endif
 
 
 /*! *********************************************************************************
@@ -245,7 +338,11 @@ phyTime_t *pRetClk
     }
 #endif /* PHY_PARAMETERS_VALIDATION */
 
+#if gPhyTimeHostBackend_d
+    *pRetClk = mPhyHostClock & gPhyTimeHostMask_c;
+#else
     *pRetClk = ZLL->EVENT_TMR >> ZLL_EVENT_TMR_EVENT_TMR_SHIFT;
+#endif
 }
 
 /*! *********************************************************************************
@@ -268,7 +365,11 @@ uint32_t *pAbsTime
 
     OSA_InterruptDisable();
 
+#if gPhyTimeHostBackend_d
+    mPhyHostClock = (mPhyHostClock & ~gPhyTimeHostMask_c) | (*pAbsTime & gPhyTimeHostMask_c);
+#else
     ZLL->EVENT_TMR = (*pAbsTime  << ZLL_EVENT_TMR_EVENT_TMR_SHIFT) | ZLL_EVENT_TMR_EVENT_TMR_LD_MASK;
+#endif
 
     OSA_InterruptEnable();
 }
@@ -284,6 +385,13 @@ void PhyTimeSetWaitTimeout
 phyTime_t *pWaitTimeout
 )
 {
+#if gPhyTimeHostBackend_d
+    OSA_InterruptDisable();
+    mPhyHostWaitCompare = *pWaitTimeout & gPhyTimeHostMask_c;
+    mPhyHostWaitEnabled = TRUE;
+    mPhyHostWaitIrq = FALSE;
+    OSA_InterruptEnable();
+#else
     uint32_t irqSts;
 
     OSA_InterruptDisable();
@@ -303,6 +411,7 @@ phyTime_t *pWaitTimeout
     ZLL->PHY_CTRL |= ZLL_PHY_CTRL_TMR1CMP_EN_MASK;
 
     OSA_InterruptEnable();
+#endif
 }
 
 /*! *********************************************************************************
@@ -314,6 +423,12 @@ void PhyTimeDisableWaitTimeout
 void
 )
 {
+#if gPhyTimeHostBackend_d
+    OSA_InterruptDisable();
+    mPhyHostWaitEnabled = FALSE;
+    mPhyHostWaitIrq = FALSE;
+    OSA_InterruptEnable();
+#else
     uint32_t irqSts;
 
     OSA_InterruptDisable();
@@ -326,6 +441,7 @@ void
     irqSts |= ZLL_IRQSTS_TMR1IRQ_MASK;
     ZLL->IRQSTS = irqSts;
     OSA_InterruptEnable();
+#endif
 }
 
 /*! *********************************************************************************
@@ -405,9 +521,10 @@ void
 ********************************************************************************** */
 void PhyTime_ISR(void)
 {
-    if( pNextEvent->callback == PhyTime_OverflowCB )
+    if( (NULL != pNextEvent) && (pNextEvent->callback == PhyTime_OverflowCB) )
     {
         gPhyTimerOverflow += (uint64_t)(1 << gPhyTimeShift_c);
+        mPhyOverflowCounted = TRUE;
     }
     
     if( gpfPhyTimeNotify )
@@ -421,6 +538,47 @@ void PhyTime_ISR(void)
     }
 }
 
+#if gPhyTimeHostBackend_d
+/*! *********************************************************************************
+* \brief  Advance the virtual event timer, and run the PHY Timer Interrupt Service
+*         Routine on every TMR1 compare match
+*
+* \param[in]  symbols  number of symbols to advance
+*
+********************************************************************************** */
+void PhyTime_HostAdvance( uint32_t symbols )
+{
+    phyTime_t distance;
+
+    while( symbols )
+    {
+        distance = symbols;
+
+        if( mPhyHostWaitEnabled && !mPhyHostWaitIrq )
+        {
+            /* The compare matches once per timer period */
+            distance = (mPhyHostWaitCompare - mPhyHostClock - 1) & gPhyTimeHostMask_c;
+            distance++;
+        }
+
+        if( distance > symbols )
+        {
+            mPhyHostClock += symbols;
+            break;
+        }
+
+        mPhyHostClock += distance;
+        symbols -= (uint32_t)distance;
+
+        if( mPhyHostWaitEnabled && !mPhyHostWaitIrq )
+        {
+            mPhyHostWaitIrq = TRUE;
+            PhyTime_ISR();
+        }
+    }
+}
+#endif
+
 /*! *********************************************************************************
 * \brief  Initialize the PHY Timer module
 *
@@ -439,13 +597,36 @@ phyTimeStatus_t PhyTime_TimerInit( void (*cb)(void) )
         gpfPhyTimeNotify = cb;
         gPhyTimerOverflow = 0;
         FLib_MemSet( mPhyTimers, 0, sizeof(mPhyTimers) );
+#if gPhyTimeMaxUsTimers_c
+        FLib_MemSet( mPhyUsTimers, 0, sizeof(mPhyUsTimers) );
+#endif
+        mPhyActiveTimers = 0;
+
+        /* Slot 0 is reserved for the Overflow calback */
+        for( mPhyFreeTimersCount = 0; mPhyFreeTimersCount < gMaxPhyTimers_c - 1; mPhyFreeTimersCount++ )
+        {
+            mPhyFreeTimers[mPhyFreeTimersCount] = gMaxPhyTimers_c - 1 - mPhyFreeTimersCount;
+        }
         
         /* Schedule Overflow Calback */
         pNextEvent = &mPhyTimers[0];
         pNextEvent->callback = PhyTime_OverflowCB;
         pNextEvent->timestamp = (uint64_t)(1 << gPhyTimeShift_c);
+        PhyTime_HeapInsert( 0 );
         PhyTimeSetWaitTimeout( &pNextEvent->timestamp );
-        mPhyActiveTimers = 1;
+
+#if gPhyTimeDeferredQueueSize_c
+        if( NULL == mPhyTaskEventId )
+        {
+            mPhyTaskEventId = OSA_EventCreate( TRUE );
+
+            if( (NULL == mPhyTaskEventId) ||
+                (NULL == OSA_TaskCreate( OSA_TASK(PhyTime_Task), NULL )) )
+            {
+                status = gPhyTimeError_c;
+            }
+        }
+#endif
     }
 
     return status;
@@ -465,9 +646,9 @@ phyTime_t PhyTime_GetTimestamp(void)
     PhyTimeReadClock( &t );
     t |= gPhyTimerOverflow;
     /* Check for overflow */
-    if( pNextEvent->callback == PhyTime_OverflowCB )
+    if( (NULL != pNextEvent) && (pNextEvent->callback == PhyTime_OverflowCB) )
     {
-        if( ZLL->IRQSTS & ZLL_IRQSTS_TMR1IRQ_MASK )
+        if( PhyTimeIsWaitTimeoutPending() )
         {
             t += (1 << gPhyTimeShift_c);
         }
@@ -496,29 +677,20 @@ phyTimeTimerId_t PhyTime_ScheduleEvent( phyTimeEvent_t *pEvent )
     }
     else
     {
-        /* Search for a free slot (slot 0 is reserved for the Overflow calback) */
         OSA_InterruptDisable();
-        for( tmr=1; tmr<gMaxPhyTimers_c; tmr++ )
+        if( mPhyFreeTimersCount )
         {
-            if( mPhyTimers[tmr].callback == NULL )
-            {
-                if( mPhyActiveTimers == 1 )
-                {
-                    PWR_DisallowXcvrToSleep();
-                }
-
-                mPhyActiveTimers++;
-                mPhyTimers[tmr] = *pEvent;
-                break;
-            }
+            tmr = mPhyFreeTimers[--mPhyFreeTimersCount];
+            mPhyTimers[tmr] = *pEvent;
+            PhyTime_HeapInsert( tmr );
         }
-        OSA_InterruptEnable();
-        
-        if( tmr >= gMaxPhyTimers_c )
+        else
         {
             tmr = gInvalidTimerId_c;
         }
-        else
+        OSA_InterruptEnable();
+        
+        if( tmr != gInvalidTimerId_c )
         {
             /* Program the next event */
             if((NULL == pNextEvent) ||
@@ -555,14 +727,7 @@ phyTimeStatus_t PhyTime_CancelEvent( phyTimeTimerId_t timerId )
             pNextEvent = NULL;
         }
         
-        mPhyTimers[timerId].callback = NULL;
-        mPhyActiveTimers--;
-
-        if( mPhyActiveTimers == 1 )
-        {
-            PWR_AllowXcvrToSleep();
-        }
-
+        PhyTime_ReleaseEvent( timerId );
         OSA_InterruptEnable();
     }
 
@@ -588,19 +753,14 @@ phyTimeStatus_t PhyTime_CancelEventsWithParam ( uint32_t param )
         if( (NULL != mPhyTimers[i].callback) && (param == mPhyTimers[i].parameter) )
         {
             status = gPhyTimeOk_c;
-            mPhyTimers[i].callback = NULL;
-            mPhyActiveTimers--;
 
             if( pNextEvent == &mPhyTimers[i] )
             {
                 pNextEvent = NULL;
             }
-        }
-    }
 
-    if( mPhyActiveTimers == 1 )
-    {
-        PWR_AllowXcvrToSleep();
+            PhyTime_ReleaseEvent( (phyTimeTimerId_t)i );
+        }
     }
     OSA_InterruptEnable();
 
@@ -613,26 +773,53 @@ phyTimeStatus_t PhyTime_CancelEventsWithParam ( uint32_t param )
 ********************************************************************************** */
 void PhyTime_RunCallback( void )
 {
-    uint32_t param;
-    phyTimeCallback_t cb;
+    uint32_t param = 0;
+    phyTimeCallback_t cb = NULL;
+#if gPhyTimeDeferredQueueSize_c
+    bool_t deferred = FALSE;
+    uint8_t head;
+#endif
 
+    OSA_InterruptDisable();
     if( pNextEvent )
     {
-        OSA_InterruptDisable();
-
         param = pNextEvent->parameter;
         cb = pNextEvent->callback;
-        pNextEvent->callback = NULL;
-        pNextEvent = NULL;
-        mPhyActiveTimers--;
-
-        if( mPhyActiveTimers == 1 )
+#if gPhyTimeDeferredQueueSize_c
+        if( pNextEvent->deferred )
         {
-            PWR_AllowXcvrToSleep();
+            head = mPhyDeferredHead + 1;
+
+            if( head > gPhyTimeDeferredQueueSize_c )
+            {
+                head = 0;
+            }
+
+            /* If the queue is full, the callback is run from here */
+            if( head != mPhyDeferredTail )
+            {
+                mPhyDeferredQueue[mPhyDeferredHead].callback = cb;
+                mPhyDeferredQueue[mPhyDeferredHead].parameter = param;
+                mPhyDeferredHead = head;
+                cb = NULL;
+                deferred = TRUE;
+            }
         }
+#endif
+        PhyTime_ReleaseEvent( (phyTimeTimerId_t)(pNextEvent - mPhyTimers) );
+        pNextEvent = NULL;
+    }
+    OSA_InterruptEnable();
 
-        OSA_InterruptEnable();
+#if gPhyTimeDeferredQueueSize_c
+    if( deferred )
+    {
+        (void)OSA_EventSet( mPhyTaskEventId, gPhyTimeDeferredEvent_c );
+    }
+#endif
 
+    if( cb )
+    {
         cb(param);
     }
 }
@@ -679,6 +866,256 @@ void PhyTime_Maintenance( void )
     }
 }
 
+#if gPhyTimeMaxUsTimers_c
+/*! *********************************************************************************
+* \brief  Start a microsecond timer
+*
+* \param[in]  timeoutUs  time until the first expiration, in microseconds
+* \param[in]  periodUs   reload value, in microseconds. 0 for a single shot timer
+* \param[in]  cb         callback function
+* \param[in]  param      parameter of the callback function
+*
+* \return  phyTimeTimerId_t  the id of the alocated timer
+*
+********************************************************************************** */
+phyTimeTimerId_t PhyTime_StartUsTimer( uint32_t timeoutUs, uint32_t periodUs, phyTimeCallback_t cb, uint32_t param )
+{
+    phyTimeTimerId_t tmr = gInvalidTimerId_c;
+    uint32_t i;
+
+    if( NULL != cb )
+    {
+        OSA_InterruptDisable();
+        for( i=0; i<gPhyTimeMaxUsTimers_c; i++ )
+        {
+            if( NULL == mPhyUsTimers[i].callback )
+            {
+                /* The timestamp is truncated to a symbol: count from the next symbol boundary
+                   so that the timer does not expire early */
+                mPhyUsTimers[i].deadline = (PhyTime_GetTimestamp() + 1) * gPhyTimeUsPerSymbol_c + timeoutUs;
+                mPhyUsTimers[i].period = periodUs;
+                mPhyUsTimers[i].callback = cb;
+                mPhyUsTimers[i].parameter = param;
+                tmr = (phyTimeTimerId_t)i;
+                break;
+            }
+        }
+        OSA_InterruptEnable();
+
+        if( gInvalidTimerId_c != tmr )
+        {
+            PhyTime_UsTimersArm();
+        }
+    }
+
+    return tmr;
+}
+
+/*! *********************************************************************************
+* \brief  Stop a microsecond timer
+*
+* \param[in]  timerId  the Id of the timer
+*
+* \return  phyTimeStatus_t
+*
+********************************************************************************** */
+phyTimeStatus_t PhyTime_StopUsTimer( phyTimeTimerId_t timerId )
+{
+    phyTimeStatus_t status = gPhyTimeOk_c;
+
+    if( (timerId >= gPhyTimeMaxUsTimers_c) || (NULL == mPhyUsTimers[timerId].callback) )
+    {
+        status = gPhyTimeNotFound_c;
+    }
+    else
+    {
+        mPhyUsTimers[timerId].callback = NULL;
+        PhyTime_UsTimersArm();
+    }
+
+    return status;
+}
+
+/*! *********************************************************************************
+* \brief  Program the PHY event of the microsecond timers for the earliest deadline.
+*         The event is removed if no microsecond timer is running.
+*
+********************************************************************************** */
+static void PhyTime_UsTimersArm( void )
+{
+    phyTimeEvent_t *pSlot = &mPhyTimers[gPhyTimeUsTimersSlot_c];
+    phyTime_t next = (phyTime_t)(-1);
+    bool_t reprogram = FALSE;
+    uint32_t i;
+
+    OSA_InterruptDisable();
+    for( i=0; i<gPhyTimeMaxUsTimers_c; i++ )
+    {
+        if( (NULL != mPhyUsTimers[i].callback) && (mPhyUsTimers[i].deadline < next) )
+        {
+            next = mPhyUsTimers[i].deadline;
+        }
+    }
+
+    if( next != (phyTime_t)(-1) )
+    {
+        /* Round the deadline up to the next symbol */
+        next = (next + gPhyTimeUsPerSymbol_c - 1) / gPhyTimeUsPerSymbol_c;
+
+        if( NULL == pSlot->callback )
+        {
+            pSlot->callback = PhyTime_UsTimersCB;
+            pSlot->timestamp = next;
+            PhyTime_HeapInsert( gPhyTimeUsTimersSlot_c );
+            reprogram = TRUE;
+        }
+        else if( pSlot->timestamp != next )
+        {
+            pSlot->timestamp = next;
+            PhyTime_HeapSiftUp( mPhyTimersHeapIndex[gPhyTimeUsTimersSlot_c] );
+            PhyTime_HeapSiftDown( mPhyTimersHeapIndex[gPhyTimeUsTimersSlot_c] );
+            reprogram = TRUE;
+        }
+
+        if( reprogram && (NULL != pNextEvent) && (pNextEvent != pSlot) &&
+            (pNextEvent->timestamp <= next) )
+        {
+            /* The event already programmed expires first */
+            reprogram = FALSE;
+        }
+    }
+    else if( NULL != pSlot->callback )
+    {
+        if( pNextEvent == pSlot )
+        {
+            pNextEvent = NULL;
+        }
+
+        PhyTime_ReleaseEvent( gPhyTimeUsTimersSlot_c );
+    }
+    OSA_InterruptEnable();
+
+    if( reprogram )
+    {
+        PhyTime_Maintenance();
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Expire the microsecond timers which reached their deadline,
+*         and program the PHY event for the next one
+*
+* \param[in]  param  not used
+*
+********************************************************************************** */
+static void PhyTime_UsTimersCB( uint32_t param )
+{
+    phyTimeCallback_t cb;
+    phyTime_t now;
+    uint32_t cbParam = 0;
+    uint32_t i;
+
+    (void)param;
+
+    for( i=0; i<gPhyTimeMaxUsTimers_c; i++ )
+    {
+        cb = NULL;
+
+        OSA_InterruptDisable();
+        now = PhyTime_GetTimestamp() * gPhyTimeUsPerSymbol_c;
+
+        /* Events closer than the setup time are run by PhyTime_Maintenance() ahead of time.
+           Expire these timers as well, after waiting for their deadline, unless the wait
+           crosses the counter overflow: the timestamp is not valid until the overflow event runs. */
+        if( (NULL != mPhyUsTimers[i].callback) &&
+            (mPhyUsTimers[i].deadline <= now + gPhyTimeUsSetupTime_c) &&
+            (mPhyUsTimers[i].deadline + gPhyTimeUsPerSymbol_c <= mPhyTimers[0].timestamp * gPhyTimeUsPerSymbol_c) )
+        {
+            while( (now < mPhyUsTimers[i].deadline) &&
+                   (mPhyUsTimers[i].deadline - now <= gPhyTimeUsSetupTime_c) )
+            {
+#if gPhyTimeHostBackend_d
+                /* The virtual clock only advances while waiting */
+                mPhyHostClock++;
+#endif
+                now = PhyTime_GetTimestamp() * gPhyTimeUsPerSymbol_c;
+            }
+
+            cb = mPhyUsTimers[i].callback;
+            cbParam = mPhyUsTimers[i].parameter;
+
+            if( mPhyUsTimers[i].period )
+            {
+                mPhyUsTimers[i].deadline += mPhyUsTimers[i].period;
+
+                /* Skip the periods which were missed */
+                if( mPhyUsTimers[i].deadline <= now )
+                {
+                    mPhyUsTimers[i].deadline = now + mPhyUsTimers[i].period;
+                }
+            }
+            else
+            {
+                mPhyUsTimers[i].callback = NULL;
+            }
+        }
+        OSA_InterruptEnable();
+
+        if( cb )
+        {
+            cb(cbParam);
+        }
+    }
+
+    PhyTime_UsTimersArm();
+}
+#endif /* gPhyTimeMaxUsTimers_c */
+
+#if gPhyTimeDeferredQueueSize_c
+/*! *********************************************************************************
+* \brief  PHY task. Run the callbacks of the expired deferred events, in expiry order
+*
+* \param[in]  param  not used
+*
+********************************************************************************** */
+static void PhyTime_Task( osaTaskParam_t param )
+{
+    osaEventFlags_t ev;
+    phyTimeCallback_t cb;
+    uint32_t cbParam;
+    uint8_t tail;
+
+    (void)param;
+
+    while(1)
+    {
+        (void)OSA_EventWait( mPhyTaskEventId, gPhyTimeDeferredEvent_c, FALSE, osaWaitForever_c, &ev );
+
+        tail = mPhyDeferredTail;
+
+        while( tail != mPhyDeferredHead )
+        {
+            cb = mPhyDeferredQueue[tail].callback;
+            cbParam = mPhyDeferredQueue[tail].parameter;
+
+            if( ++tail > gPhyTimeDeferredQueueSize_c )
+            {
+                tail = 0;
+            }
+
+            /* Free the entry before the callback, which may schedule new events */
+            mPhyDeferredTail = tail;
+            cb( cbParam );
+        }
+
+        /* For BareMetal break the while(1) after 1 run */
+        if( gUseRtos_c == 0 )
+        {
+            break;
+        }
+    }
+}
+#endif /* gPhyTimeDeferredQueueSize_c */
 
 /*! *********************************************************************************
 * \brief  Timer Overflow callback
@@ -688,46 +1125,201 @@ void PhyTime_Maintenance( void )
 ********************************************************************************** */
 static void PhyTime_OverflowCB( uint32_t param )
 {
+    phyTime_t clk;
+
     param = param;
 
-    /* Reprogram the next overflow callback */
     OSA_InterruptDisable();
-    mPhyActiveTimers++;
+
+    /* If PhyTime_Maintenance() runs the event instead of the compare match ISR
+       (ahead of time, or behind an event with the same timestamp), the overflow
+       is accounted here, once the counter wrapped. */
+    if( mPhyOverflowCounted )
+    {
+        mPhyOverflowCounted = FALSE;
+    }
+    else
+    {
+        PhyTimeReadClock( &clk );
+
+        while( clk > (((phyTime_t)1 << gPhyTimeShift_c) >> 1) )
+        {
+#if gPhyTimeHostBackend_d
+            /* The virtual clock only advances while waiting */
+            mPhyHostClock++;
+#endif
+            PhyTimeReadClock( &clk );
+        }
+
+        gPhyTimerOverflow += (uint64_t)(1 << gPhyTimeShift_c);
+    }
+
+    /* Reprogram the next overflow callback */
     mPhyTimers[0].callback = PhyTime_OverflowCB;
     mPhyTimers[0].timestamp = gPhyTimerOverflow + (1 << gPhyTimeShift_c);
+    PhyTime_HeapInsert( 0 );
     OSA_InterruptEnable();
 }
 
 /*! *********************************************************************************
-* \brief  Search for the next event to be scheduled
+* \brief  Return the next event to be scheduled
 *
 * \return phyTimeEvent_t pointer to the next event to be scheduled
 *
+* \remarks Must be called with interrupts disabled
+*
 ********************************************************************************** */
 static phyTimeEvent_t* PhyTime_GetNextEvent( void )
 {
     phyTimeEvent_t *pEv = NULL;
-    uint32_t i;
 
-    /* Search for the next event to be serviced */
-    for( i=0; i<gMaxPhyTimers_c; i++ )
+    if( mPhyActiveTimers )
+    {
+        pEv = &mPhyTimers[mPhyTimersHeap[0]];
+    }
+
+    return pEv;
+}
+
+/*! *********************************************************************************
+* \brief  Remove an event from the active events, and free its slot
+*
+* \param[in]  tmr  the slot of the event
+*
+* \remarks Must be called with interrupts disabled
+*
+********************************************************************************** */
+static void PhyTime_ReleaseEvent( phyTimeTimerId_t tmr )
+{
+    PhyTime_HeapRemove( tmr );
+    mPhyTimers[tmr].callback = NULL;
+
+    /* Only the public slots are allocated by PhyTime_ScheduleEvent() */
+    if( (tmr > 0) && (tmr < gMaxPhyTimers_c) )
+    {
+        mPhyFreeTimers[mPhyFreeTimersCount++] = tmr;
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Add an event to the heap of active events
+*
+* \param[in]  tmr  the slot of the event
+*
+* \remarks Must be called with interrupts disabled
+*
+********************************************************************************** */
+static void PhyTime_HeapInsert( phyTimeTimerId_t tmr )
+{
+    if( mPhyActiveTimers == 1 )
+    {
+        PWR_DisallowXcvrToSleep();
+    }
+
+    mPhyTimersHeap[mPhyActiveTimers] = tmr;
+    mPhyTimersHeapIndex[tmr] = mPhyActiveTimers;
+    mPhyActiveTimers++;
+    PhyTime_HeapSiftUp( mPhyTimersHeapIndex[tmr] );
+}
+
+/*! *********************************************************************************
+* \brief  Remove an event from the heap of active events
+*
+* \param[in]  tmr  the slot of the event
+*
+* \remarks Must be called with interrupts disabled
+*
+********************************************************************************** */
+static void PhyTime_HeapRemove( phyTimeTimerId_t tmr )
+{
+    uint32_t pos = mPhyTimersHeapIndex[tmr];
+
+    if( pos < --mPhyActiveTimers )
     {
-        if( NULL != mPhyTimers[i].callback )
+        /* Move the last event in the freed position and restore the heap order */
+        mPhyTimersHeap[pos] = mPhyTimersHeap[mPhyActiveTimers];
+        mPhyTimersHeapIndex[mPhyTimersHeap[pos]] = pos;
+
+        if( (pos > 0) &&
+            PhyTimeExpiresBefore(mPhyTimersHeap[pos], mPhyTimersHeap[(pos - 1) >> 1]) )
         {
-            if( NULL == pEv )
-            {
-                pEv = &mPhyTimers[i];
-            }
-            /* Check which event expires first */
-            else
-            {
-                if( mPhyTimers[i].timestamp < pEv->timestamp )
-                {
-                    pEv = &mPhyTimers[i];
-                }
-            }
+            PhyTime_HeapSiftUp( pos );
+        }
+        else
+        {
+            PhyTime_HeapSiftDown( pos );
         }
     }
 
-    return pEv;
+    if( mPhyActiveTimers == 1 )
+    {
+        PWR_AllowXcvrToSleep();
+    }
+}
+
+/*! *********************************************************************************
+* \brief  Move an event up the heap, until its parent expires first
+*
+* \param[in]  pos  the heap position of the event
+*
+* \remarks Must be called with interrupts disabled
+*
+********************************************************************************** */
+static void PhyTime_HeapSiftUp( uint32_t pos )
+{
+    phyTimeTimerId_t tmr = mPhyTimersHeap[pos];
+    uint32_t parent;
+
+    while( pos > 0 )
+    {
+        parent = (pos - 1) >> 1;
+
+        if( !PhyTimeExpiresBefore(tmr, mPhyTimersHeap[parent]) )
+        {
+            break;
+        }
+
+        mPhyTimersHeap[pos] = mPhyTimersHeap[parent];
+        mPhyTimersHeapIndex[mPhyTimersHeap[pos]] = pos;
+        pos = parent;
+    }
+
+    mPhyTimersHeap[pos] = tmr;
+    mPhyTimersHeapIndex[tmr] = pos;
+}
+
+/*! *********************************************************************************
+* \brief  Move an event down the heap, until it expires before its children
+*
+* \param[in]  pos  the heap position of the event
+*
+* \remarks Must be called with interrupts disabled
+*
+********************************************************************************** */
+static void PhyTime_HeapSiftDown( uint32_t pos )
+{
+    phyTimeTimerId_t tmr = mPhyTimersHeap[pos];
+    uint32_t child;
+
+    while( (child = (pos << 1) + 1) < mPhyActiveTimers )
+    {
+        /* Pick the child which expires first */
+        if( ((child + 1) < mPhyActiveTimers) &&
+            PhyTimeExpiresBefore(mPhyTimersHeap[child + 1], mPhyTimersHeap[child]) )
+        {
+            child++;
+        }
+
+        if( !PhyTimeExpiresBefore(mPhyTimersHeap[child], tmr) )
+        {
+            break;
+        }
+
+        mPhyTimersHeap[pos] = mPhyTimersHeap[child];
+        mPhyTimersHeapIndex[mPhyTimersHeap[pos]] = pos;
+        pos = child;
+    }
+
+    mPhyTimersHeap[pos] = tmr;
+    mPhyTimersHeapIndex[tmr] = pos;
 }
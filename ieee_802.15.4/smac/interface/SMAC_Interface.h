@@ -38,6 +38,7 @@
 ************************************************************************************/
 #include "EmbeddedTypes.h"                   
 #include "PhyTypes.h"
+#include "MpmInterface.h"
 /************************************************************************************
 *************************************************************************************
 * Interface macro definitions 
@@ -51,6 +52,12 @@
 #define gSmacUseSecurity_c         (0)
 #endif
 
+/* Number of data requests queued behind the packet under transmission. If 0, a
+   data request is rejected with gErrorBusy_c until the previous one is confirmed */
+#ifndef gSmacTxQueueSize_c
+#define gSmacTxQueueSize_c         (0)
+#endif
+
 #define gSmacHeaderBytes_c	   ( sizeof(smacHeader_t) )
 
 #if !gSmacUseSecurity_c
@@ -333,6 +340,9 @@ extern void Smac_RegisterSapHandlers(SMAC_APP_MCPS_SapHandler_t pSMAC_APP_MCPS_S
 * This data primitive is used to send an over the air packet. This is an asyncronous 
 * function,  it means it ask SMAC to transmit one OTA packet,  but when the function 
 * returns it is not sent already.
+* If gSmacTxQueueSize_c is not 0, up to gSmacTxQueueSize_c requests are queued while
+* a packet is being transmitted. Each one is sent when the previous one is done, 
+* and gets its own data confirm, in the order of the requests.
 *
 * Interface assumptions:
 *   The SMAC and radio driver have been initialized and are ready to be used. 
@@ -341,12 +351,70 @@ extern void Smac_RegisterSapHandlers(SMAC_APP_MCPS_SapHandler_t pSMAC_APP_MCPS_S
 *   gErrorNoError_c: Everything is ok and the transmission will be performed.
 *   gErrorOutOfRange_c: One of the members in the pTxMessage structure is out of 
 *                      range (no valid bufer size or data buffer pointer is NULL)
-*   gErrorNoResourcesAvailable_c: the radio is performing another action.
+*   gErrorBusy_c: SMAC is not idle and the packet cannot be queued: the TX queue
+*                 is full, or SMAC is doing something else than transmitting.
+*   gErrorNoResourcesAvailable_c: There is no buffer for the packet, in SMAC or in
+*                                 the PHY.
 *   gErrorNoValidCondition_c: The SMAC has not been initialized 
 *
 ************************************************************************************/
 extern smacErrors_t MCPSDataRequest(txPacket_t *psTxPacket);
 
+/************************************************************************************
+* MCPSDataAcquire
+* 
+* This data primitive allocates an over the air packet inside the message that SMAC
+* gives to the PHY. The application builds the header and payload of the packet in 
+* place and sends it with MCPSDataCommit, so that the packet is not copied by SMAC.
+*
+* Interface assumptions:
+*   The SMAC and radio driver have been initialized and are ready to be used. 
+*
+* Arguments:
+*   uint8_t u8MaxDataLength: the maximum length of the payload of the packet.
+*
+* Return value:  
+*   Pointer to the packet, with u8DataLength set to 0. 
+*   NULL if the SMAC has not been initialized, the length is out of range or there
+*   is no memory available. The data confirm of the packet is allocated here too, 
+*   so MCPSDataCommit does not allocate memory.
+*
+************************************************************************************/
+extern txPacket_t* MCPSDataAcquire(uint8_t u8MaxDataLength);
+
+/************************************************************************************
+* MCPSDataCommit
+* 
+* This data primitive sends a packet obtained from MCPSDataAcquire. This is an 
+* asyncronous function, like MCPSDataRequest. The packet belongs to SMAC once the
+* function returns gErrorNoError_c or gErrorNoResourcesAvailable_c. Otherwise it
+* still belongs to the application, which can commit it again or release it.
+*
+* Interface assumptions:
+*   The SMAC and radio driver have been initialized and are ready to be used. 
+*
+* Return value:  
+*   gErrorNoError_c: Everything is ok and the transmission will be performed.
+*   gErrorOutOfRange_c: The packet pointer is NULL or u8DataLength is greater than
+*                       the length given to MCPSDataAcquire.
+*   gErrorBusy_c: SMAC is not idle and the packet cannot be queued: the TX queue
+*                 is full, or SMAC is doing something else than transmitting.
+*   gErrorNoResourcesAvailable_c: The PHY could not start the transmission. The
+*                                 packet is freed.
+*   gErrorNoValidCondition_c: The SMAC has not been initialized 
+*
+************************************************************************************/
+extern smacErrors_t MCPSDataCommit(txPacket_t *psTxPacket);
+
+/************************************************************************************
+* MCPSDataRelease
+* 
+* This data primitive frees a packet obtained from MCPSDataAcquire, which will not
+* be sent.
+*
+************************************************************************************/
+extern void MCPSDataRelease(txPacket_t *psTxPacket);
+
 /***********************************************************************************/
 /******************************** SMAC Radio primitives ****************************/
 /***********************************************************************************/
@@ -436,6 +504,80 @@ uint8_t u8Scale
 *************************************************************************************/
 extern smacErrors_t MLMERXEnableRequest(rxPacket_t *gsRxPacket, smacTime_t stTimeout);
 
+#if !gMpmIncluded_d
+/************************************************************************************
+* MLMERXEnableZeroCopyRequest
+* 
+* Function used to place the radio into receive mode, without copying the received
+* packet. The pRxPacket of the data indication points inside the indication message,
+* to the buffer where the PHY received the packet. It is valid until the application
+* frees the indication message with MEM_BufferFree(). 
+* 
+* Interface assumptions:
+*   The SMAC and radio driver have been initialized and are ready to be used.
+*   Not available when the PHY shares the received packets between two PANs.
+*    
+* Arguments:
+* 
+*        smacTime_t stTimeout: 64-bit timeout value, absolute time in symbols
+*        
+*  Return Value:
+*		gErrorNoError_c: Everything is ok and the reception will be performed.
+*		gErrorBusy_c: the radio is performing another action.
+*		gErrorNoValidCondition_c: The SMAC has not been initialized.
+*		gErrorNoResourcesAvailable_c: The PHY could not enable the reception.
+*************************************************************************************/
+extern smacErrors_t MLMERXEnableZeroCopyRequest(smacTime_t stTimeout);
+#endif
+
+/************************************************************************************
+* MLMERXEnableContinuousRequest
+* 
+* Function used to place the radio into receive mode until MLMERXDisableRequest is
+* called. The received packets are stored in turn in the buffers of a ring, and each
+* one is reported in a data indication. A buffer is used again only after the 
+* application gives it back with MLMERXContinuousRelease. A packet received while
+* the next buffer is not given back is dropped and counted.
+* 
+* Interface assumptions:
+*   The SMAC and radio driver have been initialized and are ready to be used.
+*   The array of buffers and the buffers stay valid until the reception is disabled.
+*    
+* Arguments:
+* 
+*        rxPacket_t **ppRxPackets: Array of buffers where the received packets will
+*                                  be stored. u8MaxDataLength must be set in each one.
+*        uint8_t u8NumPackets: Number of buffers in the array.
+*        
+*  Return Value:
+*		gErrorNoError_c: Everything is ok and the reception will be performed.
+*		gErrorOutOfRange_c: One of the buffers is NULL or its u8MaxDataLength is
+*                           greater than the maximum SMAC SDU length.
+*		gErrorBusy_c: the radio is performing another action.
+*		gErrorNoValidCondition_c: The SMAC has not been initialized.
+*		gErrorNoResourcesAvailable_c: The PHY could not enable the reception.
+*************************************************************************************/
+extern smacErrors_t MLMERXEnableContinuousRequest(rxPacket_t **ppRxPackets, uint8_t u8NumPackets);
+
+/************************************************************************************
+* MLMERXContinuousRelease
+* 
+* Gives a buffer of the continuous reception back to SMAC, once the application is
+* done with the packet received in it.
+*
+*************************************************************************************/
+extern void MLMERXContinuousRelease(rxPacket_t *pRxPacket);
+
+/************************************************************************************
+* MLMERXContinuousDropCount
+* 
+* Returns the number of SMAC packets dropped by the continuous reception of the 
+* active PAN because no buffer was free. Frames which are not SMAC packets are not 
+* counted. The count is cleared when the continuous reception is enabled.
+*
+*************************************************************************************/
+extern uint32_t MLMERXContinuousDropCount(void);
+
 
 /************************************************************************************
 * MLMERXDisableRequest
@@ -772,6 +914,8 @@ extern smacErrors_t MLMECcaRequest();
 * MLMETXDisableRequest
 * 
 * Returns the radio to idle mode from Tx mode.
+* The packets waiting in the TX queue are dropped. Each one gets its data confirm,
+* with the gErrorNoResourcesAvailable_c status.
 *
 ************************************************************************************/
 extern void MLMETXDisableRequest(void);
@@ -37,6 +37,8 @@
 #include "FunctionLib.h"
 #include "Panic.h"
 
+#include <stddef.h>
+
 
 /************************************************************************************
 *************************************************************************************
@@ -81,6 +83,22 @@ phyStatus_t PLME_SMAC_SapHandler(void* pMsg, instanceId_t instance);
 static bool_t SMACPacketCheck(pdDataToMacMessage_t* pMsgFromPhy, 
                               smacMultiPanInstances_t instance);
 static void BackoffTimeElapsed(void* param);    
+static void SMACFreeDataMessages(instanceId_t instance, void* pExtraMsg);
+static smacErrors_t SMACDataRequestSend(macToPdDataMessage_t *pMsg, 
+                                        smacToAppDataMessage_t *pCnfMsg,
+                                        uint8_t u8DataLength);
+static phyStatus_t SMACDataRequestStart(instanceId_t instance, 
+                                        macToPdDataMessage_t *pMsg, 
+                                        smacToAppDataMessage_t *pCnfMsg);
+static bool_t SMACDataRequestAccepted(instanceId_t instance);
+static void SMACDataConfirm(instanceId_t instance, smacErrors_t status, void* pExtraMsg);
+static void SMACTxQueueNext(instanceId_t instance);
+static smacErrors_t SMACRxEnable(rxPacket_t *gsRxPacket, smacTime_t stTimeout, bool_t bContinuous);
+#if !gMpmIncluded_d
+static void SMACRxIndicationInPlace(pdDataToMacMessage_t* pDataMsg, 
+                                    instanceId_t instance, 
+                                    rxStatus_t rxStatus);
+#endif
 
 #if gSmacUseSecurity_c
 #define ENC_BLOCK_SIZE (16)
@@ -88,6 +106,13 @@ static void SMAC_Encrypt(uint8_t* pIn, uint8_t* pOut, uint8_t *len, smacMultiPan
 static void SMAC_Decrypt(uint8_t* pIn, uint8_t* pOut, uint8_t *len, smacMultiPanInstances_t panID);
 #endif
 
+/* Layout of a message from MCPSDataAcquire. The PSDU pointer of the data request is
+   followed by the data confirm allocated with the message, then by the packet built
+   by the application */
+#define mSmacTxCnfOffset_c     (offsetof(macToPdDataMessage_t, msgData.dataReq.pPsdu) + sizeof(uint8_t*))
+#define mSmacTxPacketOffset_c  (mSmacTxCnfOffset_c + sizeof(smacToAppDataMessage_t*))
+#define mSmacTxCnfMessage(pMsg) (*(smacToAppDataMessage_t**)((uint8_t*)(pMsg) + mSmacTxCnfOffset_c))
+
 /************************************************************************************
 *************************************************************************************
 * Interface functions
@@ -113,7 +138,8 @@ txPacket_t *psTxPacket        //IN:Pointer to the packet to be transmitted
 )
 {  
   macToPdDataMessage_t *pMsg;
-  phyStatus_t u8PhyRes = gPhySuccess_c; 
+  void *pMsgs[2];
+  uint32_t msgSizes[2];
   
 #if(TRUE == smacInitializationValidation_d)
   if(FALSE == mSmacInitialized)
@@ -130,64 +156,26 @@ txPacket_t *psTxPacket        //IN:Pointer to the packet to be transmitted
   }  
 #endif         /* TRUE == smacParametersValidation_d */
   
-  if(mSmacStateIdle_c != maSmacAttributes[mSmacActivePan].smacState)
+  if(!SMACDataRequestAccepted(mSmacActivePan))
   {
     return gErrorBusy_c;
   }
   
 #if !gSmacUseSecurity_c
-  pMsg = MEM_BufferAlloc( sizeof(macToPdDataMessage_t) +
-                          psTxPacket->u8DataLength+ gSmacHeaderBytes_c);
+  msgSizes[0] = sizeof(macToPdDataMessage_t) +
+                psTxPacket->u8DataLength+ gSmacHeaderBytes_c;
 #else
-  pMsg = MEM_BufferAlloc( sizeof(macToPdDataMessage_t) + 
-                          psTxPacket->u8DataLength + gSmacHeaderBytes_c + ENC_BLOCK_SIZE );
+  msgSizes[0] = sizeof(macToPdDataMessage_t) + 
+                psTxPacket->u8DataLength + gSmacHeaderBytes_c + ENC_BLOCK_SIZE;
 #endif
-  if(pMsg == NULL )
+  //the data confirm for the application is allocated together with the data request
+  msgSizes[1] = sizeof(smacToAppDataMessage_t);
+  if(MEM_SUCCESS_c != MEM_BufferAllocBatch(pMsgs, msgSizes, 2))
   {
     return gErrorNoResourcesAvailable_c;
   }
+  pMsg = (macToPdDataMessage_t*)pMsgs[0];
   
-  maSmacAttributes[mSmacActivePan].u8SmacSeqNo++;
-  maSmacAttributes[mSmacActivePan].u8AckRetryCounter = 0;
-  maSmacAttributes[mSmacActivePan].u8CCARetryCounter = 0;
-  
-  /* Fill with Phy related data */
-  pMsg->macInstance = mSmacActivePan;
-  pMsg->msgType = gPdDataReq_c;
-  //SMAC doesn't use slotted mode
-  pMsg->msgData.dataReq.slottedTx = gPhyUnslottedMode_c;
-  //start transmission immediately
-  pMsg->msgData.dataReq.startTime = gPhySeqStartAsap_c;
-#ifdef gPHY_802_15_4g_d
-  //for sub-Gig phy handles duration in case of ACK
-  pMsg->msgData.dataReq.txDuration = 0xFFFFFFFF;
-#else
-  
-#if !gUseSMACLegacy_c
-  if(maSmacAttributes[mSmacActivePan].txConfigurator.autoAck && 
-     psTxPacket->smacHeader.destAddr != 0xFFFF &&
-       psTxPacket->smacHeader.panId != 0xFFFF)
-  {
-                                    //Turn@       +       phy payload(symbols)+ Turn@ + ACK
-    pMsg->msgData.dataReq.txDuration = 12 + (6 + psTxPacket->u8DataLength + 2)*2 + 12 + 42; 
-    if(maSmacAttributes[mSmacActivePan].txConfigurator.ccaBeforeTx)
-    {
-      pMsg->msgData.dataReq.txDuration += 0x08; //CCA Duration: 8 symbols
-    }
-#if gSmacUseSecurity_c
-	/*if security is used take padding into account for tx duration*/
-    pMsg->msgData.dataReq.txDuration += ( ENC_BLOCK_SIZE - ((psTxPacket->u8DataLength - gSmacHeaderBytes_c
-                                                            +ENC_BLOCK_SIZE)&(ENC_BLOCK_SIZE-1))
-                                         )*2;
-#endif
-  }
-  else
-#endif  
-  {
-    pMsg->msgData.dataReq.txDuration = 0xFFFFFFFF;
-  }
-#endif
-  pMsg->msgData.dataReq.psduLength = psTxPacket->u8DataLength + gSmacHeaderBytes_c;
   pMsg->msgData.dataReq.pPsdu = (uint8_t*)&pMsg->msgData.dataReq.pPsdu +
     sizeof(pMsg->msgData.dataReq.pPsdu);
   
@@ -196,64 +184,130 @@ txPacket_t *psTxPacket        //IN:Pointer to the packet to be transmitted
               &(psTxPacket->smacPdu), 
               psTxPacket->u8DataLength);
 
-  if(maSmacAttributes[mSmacActivePan].txConfigurator.ccaBeforeTx)
+  return SMACDataRequestSend(pMsg, (smacToAppDataMessage_t*)pMsgs[1], psTxPacket->u8DataLength);
+}
+
+/************************************************************************************
+* MCPSDataAcquire
+* 
+* This data primitive allocates the message of an over the air packet. The packet
+* is built by the application directly in the message, and sent by MCPSDataCommit.
+*
+************************************************************************************/
+txPacket_t* MCPSDataAcquire
+(
+uint8_t u8MaxDataLength       //IN:Maximum length of the payload of the packet
+)
+{
+  macToPdDataMessage_t *pMsg;
+  txPacket_t *psTxPacket;
+  void *pMsgs[2];
+  uint32_t msgSizes[2];
+  
+#if(TRUE == smacInitializationValidation_d)
+  if(FALSE == mSmacInitialized)
   {
-    //tell phy to perform CCA before transmission
-    pMsg->msgData.dataReq.CCABeforeTx = gPhyCCAMode1_c;
+    return NULL;
   }
-  else
+#endif      /* TRUE == smacInitializationValidation_d */
+  
+#if(TRUE == smacParametersValidation_d)
+  if(gMaxSmacSDULength_c < u8MaxDataLength)
   {
-    pMsg->msgData.dataReq.CCABeforeTx = gPhyNoCCABeforeTx_c;
+    return NULL;
+  }  
+#endif         /* TRUE == smacParametersValidation_d */
+  
+#if !gSmacUseSecurity_c
+  msgSizes[0] = mSmacTxPacketOffset_c + offsetof(txPacket_t, smacPdu) + u8MaxDataLength;
+#else
+  msgSizes[0] = mSmacTxPacketOffset_c + offsetof(txPacket_t, smacPdu) + u8MaxDataLength + ENC_BLOCK_SIZE;
+#endif
+  //the data confirm is allocated now, so that the commit does not need memory
+  msgSizes[1] = sizeof(smacToAppDataMessage_t);
+  if(MEM_SUCCESS_c != MEM_BufferAllocBatch(pMsgs, msgSizes, 2))
+  {
+    return NULL;
   }
-#if !gUseSMACLegacy_c  
-  if(maSmacAttributes[mSmacActivePan].txConfigurator.autoAck && 
-     psTxPacket->smacHeader.destAddr != 0xFFFF &&
-       psTxPacket->smacHeader.panId != 0xFFFF)
+  pMsg = (macToPdDataMessage_t*)pMsgs[0];
+  mSmacTxCnfMessage(pMsg) = (smacToAppDataMessage_t*)pMsgs[1];
+  psTxPacket = (txPacket_t*)((uint8_t*)pMsg + mSmacTxPacketOffset_c);
+  psTxPacket->u8DataLength = 0;
+  //the PSDU is the header and payload of the packet built by the application
+  pMsg->msgData.dataReq.pPsdu = (uint8_t*)&psTxPacket->smacHeader;
+  
+  return psTxPacket;
+}
+
+/************************************************************************************
+* MCPSDataCommit
+* 
+* This data primitive sends an over the air packet built with MCPSDataAcquire. The
+* packet belongs to SMAC once the function returns gErrorNoError_c or
+* gErrorNoResourcesAvailable_c.
+*
+************************************************************************************/
+smacErrors_t MCPSDataCommit
+(
+txPacket_t *psTxPacket        //IN:Pointer to the packet returned by MCPSDataAcquire
+)
+{
+  macToPdDataMessage_t *pMsg;
+  
+#if(TRUE == smacInitializationValidation_d)
+  if(FALSE == mSmacInitialized)
   {
-    //set frame control option: ACK.
-    pMsg->msgData.dataReq.pPsdu[0] |=   gFrameCtrlAckReqMsk_c;
-    pMsg->msgData.dataReq.ackRequired = gPhyRxAckRqd_c;
+    return gErrorNoValidCondition_c;
   }
-  else
-#endif
+#endif      /* TRUE == smacInitializationValidation_d */
+  
+  if(NULL == psTxPacket)
   {
-    pMsg->msgData.dataReq.ackRequired = gPhyNoAckRqd_c;
+    return gErrorOutOfRange_c;
   }
-#if gSmacUseSecurity_c
-  uint8_t inputLen = pMsg->msgData.dataReq.psduLength - gSmacHeaderBytes_c;
-  SMAC_Encrypt(pMsg->msgData.dataReq.pPsdu + gSmacHeaderBytes_c, pMsg->msgData.dataReq.pPsdu + gSmacHeaderBytes_c, 
-               &(inputLen),
-               mSmacActivePan);
-  pMsg->msgData.dataReq.psduLength = inputLen + gSmacHeaderBytes_c;
-#endif
-  //set sequence number;
-#if !gUseSMACLegacy_c
-  pMsg->msgData.dataReq.pPsdu[2] = maSmacAttributes[mSmacActivePan].u8SmacSeqNo;
+  pMsg = (macToPdDataMessage_t*)((uint8_t*)psTxPacket - mSmacTxPacketOffset_c);
+  
+#if(TRUE == smacParametersValidation_d)
+#if !gSmacUseSecurity_c
+  if(MEM_BufferGetSize(pMsg) < mSmacTxPacketOffset_c + offsetof(txPacket_t, smacPdu) + psTxPacket->u8DataLength)
+#else
+  if(MEM_BufferGetSize(pMsg) < mSmacTxPacketOffset_c + offsetof(txPacket_t, smacPdu) + psTxPacket->u8DataLength + ENC_BLOCK_SIZE)
 #endif
-  maSmacAttributes[mSmacActivePan].gSmacDataMessage = pMsg;      //Store pointer for freeing later 
+  {
+    return gErrorOutOfRange_c;
+  }  
+#endif         /* TRUE == smacParametersValidation_d */
   
-  OSA_InterruptDisable();
-  maSmacAttributes[mSmacActivePan].smacState = mSmacStateTransmitting_c; 
-  OSA_InterruptEnable();
-  u8PhyRes = MAC_PD_SapHandler(pMsg, 0);
-
-  if(u8PhyRes == gPhySuccess_c)
+  if(!SMACDataRequestAccepted(mSmacActivePan))
   {
-    return gErrorNoError_c;
+    return gErrorBusy_c;
   }
-  else
+  
+  return SMACDataRequestSend(pMsg, mSmacTxCnfMessage(pMsg), psTxPacket->u8DataLength);
+}
+
+/************************************************************************************
+* MCPSDataRelease
+* 
+* This data primitive frees a packet allocated with MCPSDataAcquire, which will
+* not be sent.
+*
+************************************************************************************/
+void MCPSDataRelease
+(
+txPacket_t *psTxPacket        //IN:Pointer to the packet returned by MCPSDataAcquire
+)
+{
+  void *pMsgs[2];
+  
+  if(NULL != psTxPacket)
   {
-    MEM_BufferFree(maSmacAttributes[mSmacActivePan].gSmacDataMessage);
-    maSmacAttributes[mSmacActivePan].gSmacDataMessage = NULL;
-    
-    OSA_InterruptDisable();
-    maSmacAttributes[mSmacActivePan].smacState = mSmacStateIdle_c; 
-    OSA_InterruptEnable();
-    return gErrorNoResourcesAvailable_c;
+    pMsgs[0] = (uint8_t*)psTxPacket - mSmacTxPacketOffset_c;
+    pMsgs[1] = mSmacTxCnfMessage(pMsgs[0]);
+    (void)MEM_BufferFreeBatch(pMsgs, 2);
   }
 }
 
-
 /************************************************************************************
 * MLMESetActivePan
 * 
@@ -378,10 +432,6 @@ rxPacket_t *gsRxPacket, //OUT: Pointer to the structure where the reception resu
 smacTime_t stTimeout     //IN:  64-bit timeout value, absolute value in symbols
 )
 {
-  
-  uint8_t u8PhyRes = 0; 
-  macToPlmeMessage_t lMsg;
-  
 #if(TRUE == smacParametersValidation_d)
 #if gSmacUseSecurity_c
   if((NULL == gsRxPacket) || (gMaxSmacSDULength_c + 16 < gsRxPacket->u8MaxDataLength))
@@ -393,6 +443,60 @@ smacTime_t stTimeout     //IN:  64-bit timeout value, absolute value in symbols
   }
 #endif     /* TRUE == smacParametersValidation_d */
   
+  return SMACRxEnable(gsRxPacket, stTimeout, FALSE);
+}
+
+#if !gMpmIncluded_d
+/************************************************************************************
+* MLMERXEnableZeroCopyRequest
+* 
+* Function used to place the radio into receive mode. The received packet is
+* delivered in the PHY buffer, without being copied.
+*
+************************************************************************************/
+smacErrors_t MLMERXEnableZeroCopyRequest
+(
+smacTime_t stTimeout     //IN:  64-bit timeout value, absolute value in symbols
+)
+{
+  return SMACRxEnable(NULL, stTimeout, FALSE);
+}
+#endif
+
+/************************************************************************************
+* MLMERXEnableContinuousRequest
+* 
+* Function used to place the radio into receive mode until MLMERXDisableRequest is
+* called. The received packets are stored in a ring of buffers.
+*
+************************************************************************************/
+smacErrors_t MLMERXEnableContinuousRequest
+(
+rxPacket_t **ppRxPackets, //IN: Buffers where the received packets will be stored,
+//     in turn.
+uint8_t u8NumPackets      //IN: Number of buffers
+)
+{
+  uint8_t i;
+  
+#if(TRUE == smacParametersValidation_d)
+  if((NULL == ppRxPackets) || (0 == u8NumPackets))
+  {
+    return gErrorOutOfRange_c;
+  }
+  for(i = 0; i < u8NumPackets; i++)
+  {
+#if gSmacUseSecurity_c
+    if((NULL == ppRxPackets[i]) || (gMaxSmacSDULength_c + 16 < ppRxPackets[i]->u8MaxDataLength))
+#else
+    if((NULL == ppRxPackets[i]) || (gMaxSmacSDULength_c < ppRxPackets[i]->u8MaxDataLength))
+#endif
+    {
+      return gErrorOutOfRange_c;
+    }
+  }
+#endif     /* TRUE == smacParametersValidation_d */
+  
 #if(TRUE == smacInitializationValidation_d)
   if(FALSE == mSmacInitialized)
   {
@@ -400,48 +504,53 @@ smacTime_t stTimeout     //IN:  64-bit timeout value, absolute value in symbols
   }
 #endif     /* TRUE == smacInitializationValidation_d */
   
+  //the ring of a running reception must not be replaced
   if(mSmacStateIdle_c != maSmacAttributes[mSmacActivePan].smacState)
   {
     return gErrorBusy_c;
   }
-  lMsg.macInstance = mSmacActivePan;
-  if(stTimeout)
-  {
-    lMsg.msgType = gPlmeSetTRxStateReq_c;
-    lMsg.msgData.setTRxStateReq.startTime = gPhySeqStartAsap_c;
-    lMsg.macInstance = mSmacActivePan;
-    lMsg.msgData.setTRxStateReq.state = gPhySetRxOn_c;
-    lMsg.msgData.setTRxStateReq.rxDuration = stTimeout;
-  }
-  else
+  
+  for(i = 0; i < u8NumPackets; i++)
   {
-    lMsg.msgType = gPlmeSetReq_c;
-    lMsg.msgData.setReq.PibAttribute = gPhyPibRxOnWhenIdle;
-    lMsg.msgData.setReq.PibAttributeValue = (uint64_t)1;
+    ppRxPackets[i]->rxStatus = rxProcessingReceptionStatus_c;
   }
-  maSmacAttributes[mSmacActivePan].mSmacTimeoutAsked = (stTimeout > 0);
-  
-  gsRxPacket->rxStatus = rxProcessingReceptionStatus_c;
-  maSmacAttributes[mSmacActivePan].smacProccesPacketPtr.smacRxPacketPointer  
-    = gsRxPacket;
-    
-  OSA_InterruptDisable();
-  maSmacAttributes[mSmacActivePan].smacState = mSmacStateReceiving_c; 
-  OSA_InterruptEnable();
-  u8PhyRes = MAC_PLME_SapHandler(&lMsg, 0);
+  maSmacAttributes[mSmacActivePan].ppRxRing = ppRxPackets;
+  maSmacAttributes[mSmacActivePan].u8RxRingSize = u8NumPackets;
+  maSmacAttributes[mSmacActivePan].u8RxRingNext = 0;
+  maSmacAttributes[mSmacActivePan].u32RxDropCount = 0;
   
-  if(u8PhyRes == gPhySuccess_c)
-  { 
-    return gErrorNoError_c;
-  }
-  else
+  return SMACRxEnable(ppRxPackets[0], 0, TRUE);
+}
+
+/************************************************************************************
+* MLMERXContinuousRelease
+* 
+* Gives a buffer of the continuous reception back to SMAC, once the application is
+* done with the received packet.
+*
+************************************************************************************/
+void MLMERXContinuousRelease
+(
+rxPacket_t *pRxPacket     //IN: Buffer received in a data indication
+)
+{
+  if(NULL != pRxPacket)
   {
-    OSA_InterruptDisable();
-    maSmacAttributes[mSmacActivePan].smacState = mSmacStateIdle_c; 
-    OSA_InterruptEnable();
-    return gErrorNoResourcesAvailable_c;
+    pRxPacket->rxStatus = rxProcessingReceptionStatus_c;
   }
 }
+
+/************************************************************************************
+* MLMERXContinuousDropCount
+* 
+* Returns the number of packets dropped by the continuous reception because no
+* buffer of the ring was free.
+*
+************************************************************************************/
+uint32_t MLMERXContinuousDropCount(void)
+{
+  return maSmacAttributes[mSmacActivePan].u32RxDropCount;
+}
 #if defined (gPHY_802_15_4g_d)
 /************************************************************************************
 * MLMESetPreambleLength
@@ -949,7 +1058,7 @@ smacErrors_t MLMERXDisableRequest(void)
     maSmacAttributes[mSmacActivePan].mSmacTimeoutAsked = FALSE;
     (void)MAC_PLME_SapHandler(&lMsg, 0);
   }
-
+  maSmacAttributes[mSmacActivePan].mSmacRxContinuous = FALSE;
   
   return gErrorNoError_c;
   
@@ -965,18 +1074,42 @@ smacErrors_t MLMERXDisableRequest(void)
 void MLMETXDisableRequest(void)
 {
   macToPlmeMessage_t lMsg;
+#if gSmacTxQueueSize_c
+  smacTxQueueEntry_t aDropped[gSmacTxQueueSize_c];
+  uint8_t u8Dropped = 0;
+  uint8_t i;
+#endif
   lMsg.macInstance = mSmacActivePan;
   lMsg.msgType     = gPlmeSetTRxStateReq_c;
   lMsg.msgData.setTRxStateReq.state = gPhyForceTRxOff_c;
   (void)MAC_PLME_SapHandler(&lMsg, 0);
   if(maSmacAttributes[mSmacActivePan].gSmacDataMessage != NULL)
   {
-    (void)MEM_BufferFree(maSmacAttributes[mSmacActivePan].gSmacDataMessage);
-    maSmacAttributes[mSmacActivePan].gSmacDataMessage = NULL;
+    SMACFreeDataMessages(mSmacActivePan, NULL);
   }
   OSA_InterruptDisable();
+#if gSmacTxQueueSize_c
+  //the queued packets are dropped, and confirmed once SMAC is idle
+  while(maSmacAttributes[mSmacActivePan].u8TxQueueCount)
+  {
+    aDropped[u8Dropped++] = 
+      maSmacAttributes[mSmacActivePan].smacTxQueue[maSmacAttributes[mSmacActivePan].u8TxQueueHead];
+    maSmacAttributes[mSmacActivePan].u8TxQueueHead = 
+      (maSmacAttributes[mSmacActivePan].u8TxQueueHead + 1) % gSmacTxQueueSize_c;
+    maSmacAttributes[mSmacActivePan].u8TxQueueCount--;
+  }
+#endif
   maSmacAttributes[mSmacActivePan].smacState = mSmacStateIdle_c;
   OSA_InterruptEnable();
+#if gSmacTxQueueSize_c
+  for(i = 0; i < u8Dropped; i++)
+  {
+    (void)MEM_BufferFree(aDropped[i].pDataMessage);
+    aDropped[i].pDataCnfMessage->msgType = gMcpsDataCnf_c;
+    aDropped[i].pDataCnfMessage->msgData.dataCnf.status = gErrorNoResourcesAvailable_c;
+    maSmacAttributes[mSmacActivePan].gSMAC_APP_MCPS_SapHandler(aDropped[i].pDataCnfMessage, mSmacActivePan);
+  }
+#endif
 }
 
 /************************************************************************************
@@ -1178,17 +1311,8 @@ void
   maSmacAttributes[mSmacActivePan].smacState= mSmacStateIdle_c; 
   OSA_InterruptEnable();
   
-  if(maSmacAttributes[mSmacActivePan].gSmacDataMessage != NULL)
-  {
-    MEM_BufferFree(maSmacAttributes[mSmacActivePan].gSmacDataMessage);
-    maSmacAttributes[mSmacActivePan].gSmacDataMessage = NULL;
-  }
-  
-  if(maSmacAttributes[mSmacActivePan].gSmacMlmeMessage != NULL)
-  {
-    MEM_BufferFree(maSmacAttributes[mSmacActivePan].gSmacMlmeMessage);
-    maSmacAttributes[mSmacActivePan].gSmacMlmeMessage = NULL;
-  }
+  SMACFreeDataMessages(mSmacActivePan, maSmacAttributes[mSmacActivePan].gSmacMlmeMessage);
+  maSmacAttributes[mSmacActivePan].gSmacMlmeMessage = NULL;
   
   return gErrorNoError_c;
 }
@@ -1216,83 +1340,122 @@ phyStatus_t PD_SMAC_SapHandler(void* pMsg, instanceId_t instance)
     }
     else
     {
-      //phy finished work with the data request packet so it can be freed
-      MEM_BufferFree(maSmacAttributes[instance].gSmacDataMessage);
-      maSmacAttributes[instance].gSmacDataMessage = NULL;
-      
-      pSmacMsg = MEM_BufferAlloc(sizeof(smacToAppDataMessage_t));
-      if(pSmacMsg == NULL)
-      {
-        status = gPhySuccess_c;
-      }
-      else
-      {
-        pSmacMsg->msgType = gMcpsDataCnf_c;
-        pSmacMsg->msgData.dataCnf.status = gErrorNoError_c;
-        // call App Sap
-        maSmacAttributes[instance].gSMAC_APP_MCPS_SapHandler(pSmacMsg, instance); 
-      }
-      OSA_InterruptDisable();
-      maSmacAttributes[instance].smacState = mSmacStateIdle_c;
-      OSA_InterruptEnable();
+      //phy finished work with the data request packet so it can be freed, 
+      //together with the phy confirm message
+      SMACDataConfirm(instance, gErrorNoError_c, pMsg);
+      SMACTxQueueNext(instance);
+      return gPhySuccess_c;
     }
     break;
   case gPdDataInd_c:
+    if(maSmacAttributes[instance].mSmacRxContinuous)
+    {
+      //the packet is stored in the next buffer of the ring, if the application
+      //released it
+      maSmacAttributes[instance].smacProccesPacketPtr.smacRxPacketPointer = 
+        maSmacAttributes[instance].ppRxRing[maSmacAttributes[instance].u8RxRingNext];
+    }
     if(FALSE == SMACPacketCheck(pDataMsg, (smacMultiPanInstances_t)instance))
     {
-      MEM_BufferFree(pDataMsg);
+      //the phy message is freed below, when leaving the SAP handler
       //if timeout is asked and packet fails the check, send message with abort status
       if(maSmacAttributes[instance].mSmacTimeoutAsked)
       {
-        pSmacMsg = MEM_BufferAlloc(sizeof(smacToAppDataMessage_t));
-        pSmacMsg->msgType = gMcpsDataInd_c;
-        pSmacMsg->msgData.dataInd.pRxPacket = 
-          maSmacAttributes[instance].smacProccesPacketPtr.smacRxPacketPointer;
-        pSmacMsg->msgData.dataInd.pRxPacket->rxStatus = rxAbortedStatus_c;
-        maSmacAttributes[instance].gSMAC_APP_MCPS_SapHandler(pSmacMsg, instance);
-        
-        OSA_InterruptDisable();
-        maSmacAttributes[instance].smacState = mSmacStateIdle_c;
+#if !gMpmIncluded_d
+        if(maSmacAttributes[instance].mSmacRxZeroCopy)
+        {
+          //the phy message is handed over to the application
+          SMACRxIndicationInPlace(pDataMsg, instance, rxAbortedStatus_c);
+          return gPhySuccess_c;
+        }
+#endif
+        pSmacMsg = MEM_BufferAllocCritical(sizeof(smacToAppDataMessage_t));
+        if(pSmacMsg == NULL)
+        {
+          //no indication can be sent, the reception ends silently
+          maSmacAttributes[instance].u32RxDropCount++;
+        }
+        else
+        {
+          pSmacMsg->msgType = gMcpsDataInd_c;
+          pSmacMsg->msgData.dataInd.pRxPacket = 
+            maSmacAttributes[instance].smacProccesPacketPtr.smacRxPacketPointer;
+          pSmacMsg->msgData.dataInd.pRxPacket->rxStatus = rxAbortedStatus_c;
+          maSmacAttributes[instance].gSMAC_APP_MCPS_SapHandler(pSmacMsg, instance);
+        }
+        
+        OSA_InterruptDisable();
+        maSmacAttributes[instance].smacState = mSmacStateIdle_c;
         OSA_InterruptEnable();
       }
       status = gPhySuccess_c;
     }
+    else if((maSmacAttributes[instance].mSmacRxContinuous) &&
+            (rxProcessingReceptionStatus_c != 
+             maSmacAttributes[instance].smacProccesPacketPtr.smacRxPacketPointer->rxStatus))
+    {
+      //only SMAC packets are dropped for lack of a free buffer
+      maSmacAttributes[instance].u32RxDropCount++;
+      status = gPhySuccess_c;
+    }
     else
     {
       maSmacAttributes[instance].smacLastDataRxParams.linkQuality = 
         ((pdDataToMacMessage_t*)pMsg)->msgData.dataInd.ppduLinkQuality;
       maSmacAttributes[instance].smacLastDataRxParams.timeStamp = 
         (phyTime_t)((pdDataToMacMessage_t*)pMsg)->msgData.dataInd.timeStamp;
-      maSmacAttributes[instance].smacProccesPacketPtr.smacRxPacketPointer->rxStatus = 
-        rxSuccessStatus_c;
-#if gSmacUseSecurity_c
-      uint8_t len = pDataMsg->msgData.dataInd.psduLength - gSmacHeaderBytes_c;
-      SMAC_Decrypt(pDataMsg->msgData.dataInd.pPsdu + gSmacHeaderBytes_c, pDataMsg->msgData.dataInd.pPsdu + gSmacHeaderBytes_c,
-                   &len,
-                   (smacMultiPanInstances_t)instance);
-      pDataMsg->msgData.dataInd.psduLength = len + gSmacHeaderBytes_c;
-#endif
-      // in case no timeout was asked we need to unset RXOnWhenIdle Pib.
-      if(!maSmacAttributes[instance].mSmacTimeoutAsked) 
+      // in case no timeout was asked we need to unset RXOnWhenIdle Pib,
+      // unless the reception is continuous.
+      if((!maSmacAttributes[instance].mSmacTimeoutAsked) &&
+         (!maSmacAttributes[instance].mSmacRxContinuous))
       {
         lSmacInstanceBackup = mSmacActivePan;
         MLMESetActivePan((smacMultiPanInstances_t)instance);
         (void)MLMERXDisableRequest();
         MLMESetActivePan(lSmacInstanceBackup);
       }
-      maSmacAttributes[instance].smacProccesPacketPtr.smacRxPacketPointer->u8DataLength 
-        = pDataMsg->msgData.dataInd.psduLength - gSmacHeaderBytes_c;
+#if !gMpmIncluded_d
+      if(maSmacAttributes[instance].mSmacRxZeroCopy)
+      {
+        //the phy message is handed over to the application
+        SMACRxIndicationInPlace(pDataMsg, instance, rxSuccessStatus_c);
+        return gPhySuccess_c;
+      }
+#endif
+      maSmacAttributes[instance].smacProccesPacketPtr.smacRxPacketPointer->rxStatus = 
+        rxSuccessStatus_c;
+      // the phy message may be shared with other PANs, so it is not modified here.
       FLib_MemCpy(&maSmacAttributes[instance].smacProccesPacketPtr.smacRxPacketPointer->smacHeader, 
                   ((smacHeader_t*)pDataMsg->msgData.dataInd.pPsdu), 
                   gSmacHeaderBytes_c);
+#if gSmacUseSecurity_c
+      uint8_t len = pDataMsg->msgData.dataInd.psduLength - gSmacHeaderBytes_c;
+      SMAC_Decrypt(pDataMsg->msgData.dataInd.pPsdu + gSmacHeaderBytes_c, 
+                   (uint8_t*)&maSmacAttributes[instance].smacProccesPacketPtr.smacRxPacketPointer->smacPdu,
+                   &len,
+                   (smacMultiPanInstances_t)instance);
+      maSmacAttributes[instance].smacProccesPacketPtr.smacRxPacketPointer->u8DataLength = len;
+#else
+      maSmacAttributes[instance].smacProccesPacketPtr.smacRxPacketPointer->u8DataLength 
+        = pDataMsg->msgData.dataInd.psduLength - gSmacHeaderBytes_c;
       FLib_MemCpy(&maSmacAttributes[instance].smacProccesPacketPtr.smacRxPacketPointer->smacPdu, 
                   ((smacPdu_t*)(pDataMsg->msgData.dataInd.pPsdu + gSmacHeaderBytes_c)), 
                   maSmacAttributes[instance].smacProccesPacketPtr.smacRxPacketPointer->u8DataLength);
+#endif
       
-      pSmacMsg = MEM_BufferAlloc(sizeof(smacToAppDataMessage_t));
+      //the indication may use the blocks reserved for critical allocations
+      pSmacMsg = MEM_BufferAllocCritical(sizeof(smacToAppDataMessage_t));
       if(pSmacMsg == NULL)
       {
         status = gPhySuccess_c;
+        if(maSmacAttributes[instance].mSmacRxContinuous)
+        {
+          //the buffer stays free for the next packet
+          maSmacAttributes[instance].smacProccesPacketPtr.smacRxPacketPointer->rxStatus = 
+            rxProcessingReceptionStatus_c;
+          maSmacAttributes[instance].u32RxDropCount++;
+          break;
+        }
       }
       else
       {
@@ -1306,6 +1469,15 @@ phyStatus_t PD_SMAC_SapHandler(void* pMsg, instanceId_t instance)
           (smacMultiPanInstances_t)0;
 #endif
         pSmacMsg->msgData.dataInd.u8LastRxRssi = PhyGetLastRxRssiValue();
+        if(maSmacAttributes[instance].mSmacRxContinuous)
+        {
+          maSmacAttributes[instance].u8RxRingNext = 
+            (maSmacAttributes[instance].u8RxRingNext + 1) % maSmacAttributes[instance].u8RxRingSize;
+          //the radio stays in receive mode
+          maSmacAttributes[instance].gSMAC_APP_MCPS_SapHandler(pSmacMsg, instance); 
+          status = gPhySuccess_c;
+          break;
+        }
         maSmacAttributes[instance].gSMAC_APP_MCPS_SapHandler(pSmacMsg, instance); 
       }
       OSA_InterruptDisable();
@@ -1332,7 +1504,6 @@ phyStatus_t PLME_SMAC_SapHandler(void* pMsg, instanceId_t instance)
   uint32_t backOffTime = 0;
   smacMultiPanInstances_t lSmacInstanceBackup;
   smacToAppMlmeMessage_t* pSmacToApp;
-  smacToAppDataMessage_t* pSmacMsg;
   plmeToMacMessage_t* pPlmeMsg = (plmeToMacMessage_t*)pMsg;
   
   MEM_BufferFree(maSmacAttributes[instance].gSmacMlmeMessage);
@@ -1360,23 +1531,11 @@ phyStatus_t PLME_SMAC_SapHandler(void* pMsg, instanceId_t instance)
           }
           else
           {
-            MEM_BufferFree(maSmacAttributes[instance].gSmacDataMessage);
-            maSmacAttributes[instance].gSmacDataMessage = NULL;
-            
-            //retries failed so create message for the application
-            pSmacMsg = MEM_BufferAlloc(sizeof(smacToAppDataMessage_t));
-            if(pSmacMsg != NULL)
-            {
-              //error type : Channel Busy
-              pSmacMsg->msgData.dataCnf.status = gErrorChannelBusy_c;
-              //type is Data Confirm
-              pSmacMsg->msgType = gMcpsDataCnf_c;
-              maSmacAttributes[instance].gSMAC_APP_MCPS_SapHandler(pSmacMsg, instance);
-            }
-            //place SMAC into idle state
-            OSA_InterruptDisable();
-            maSmacAttributes[instance].smacState = mSmacStateIdle_c;
-            OSA_InterruptEnable();
+            //retries failed so send the data confirm to the application
+            SMACDataConfirm(instance, gErrorChannelBusy_c, pMsg);
+            //send the next queued packet or place SMAC into idle state
+            SMACTxQueueNext(instance);
+            return gPhySuccess_c;
           }
       }
       MEM_BufferFree(pMsg);
@@ -1384,7 +1543,7 @@ phyStatus_t PLME_SMAC_SapHandler(void* pMsg, instanceId_t instance)
     }
     //if SMAC isn't in TX then definitely it is a CCA confirm
     //allocate a message for the application
-    pSmacToApp = MEM_BufferAlloc(sizeof(smacToAppMlmeMessage_t));
+    pSmacToApp = MEM_BufferAllocCritical(sizeof(smacToAppMlmeMessage_t));
     if(pSmacToApp != NULL)
     {
       //type is CCA Confirm
@@ -1402,7 +1561,7 @@ phyStatus_t PLME_SMAC_SapHandler(void* pMsg, instanceId_t instance)
     break;
   case gPlmeEdCnf_c:
     //allocate a message for the application
-    pSmacToApp = MEM_BufferAlloc(sizeof(smacToAppMlmeMessage_t));
+    pSmacToApp = MEM_BufferAllocCritical(sizeof(smacToAppMlmeMessage_t));
     if(pSmacToApp != NULL)
     {
       //message type is ED Confirm
@@ -1445,34 +1604,22 @@ phyStatus_t PLME_SMAC_SapHandler(void* pMsg, instanceId_t instance)
         }
         else
         {
-          (void)MEM_BufferFree(maSmacAttributes[instance].gSmacDataMessage);
-          maSmacAttributes[instance].gSmacDataMessage = NULL;
-          
-          //retries failed so create message for the application
-          pSmacMsg = MEM_BufferAlloc(sizeof(smacToAppDataMessage_t));
-          if(pSmacMsg != NULL)
-          {
-            //set error code: No Ack
-            pSmacMsg->msgData.dataCnf.status = gErrorNoAck_c;
-            //type is Data Confirm
-            pSmacMsg->msgType = gMcpsDataCnf_c;
-            
-            maSmacAttributes[instance].gSMAC_APP_MCPS_SapHandler(pSmacMsg, instance);
-          }
-          //place SMAC into idle state
-          OSA_InterruptDisable();
-          maSmacAttributes[instance].smacState = mSmacStateIdle_c;
-          OSA_InterruptEnable();
+          //retries failed so send the data confirm to the application
+          SMACDataConfirm(instance, gErrorNoAck_c, pMsg);
+          //send the next queued packet or place SMAC into idle state
+          SMACTxQueueNext(instance);
+          return gPhySuccess_c;
         }
       }
       MEM_BufferFree(pMsg);
       return gPhySuccess_c;
     }
     //if no ack timeout was received then it is definitely a RX timeout
-    pSmacToApp = MEM_BufferAlloc(sizeof(smacToAppMlmeMessage_t));
+    pSmacToApp = MEM_BufferAllocCritical(sizeof(smacToAppMlmeMessage_t));
     if(pSmacToApp != NULL)
     {
-      if(maSmacAttributes[instance].smacState == mSmacStateReceiving_c)
+      if((maSmacAttributes[instance].smacState == mSmacStateReceiving_c) &&
+         (NULL != maSmacAttributes[instance].smacProccesPacketPtr.smacRxPacketPointer))
       {
         maSmacAttributes[instance].smacProccesPacketPtr.smacRxPacketPointer->rxStatus 
           = rxTimeOutStatus_c;
@@ -1587,6 +1734,11 @@ void InitSmac(void)
     
     RNG_GetRandomNo(&u32RandomNo);
     maSmacAttributes[mSmacActivePan].u8SmacSeqNo = (uint8_t)u32RandomNo;
+#if gSmacUseSecurity_c
+    /* Load the default key so a PAN is usable before SMAC_SetIVKey is called */
+    AES_128_SetKey(&maSmacAttributes[mSmacActivePan].secKeyCtx, 
+                   maSmacAttributes[mSmacActivePan].secInit.KEY);
+#endif
     mSmacActivePan = (smacMultiPanInstances_t)(mSmacActivePan + 1);
   }
   mSmacActivePan = gSmacPan0_c;
@@ -1669,13 +1821,361 @@ void BackoffTimeElapsed(void* param)
   lsmacInstance = (uint32_t)param;
   uint8_t u8PhyRes = MAC_PD_SapHandler(maSmacAttributes[lsmacInstance].gSmacDataMessage, 0);
   if(u8PhyRes != gPhySuccess_c)
+  {
+    //the packet could not be sent, so it is confirmed with an error
+    SMACDataConfirm(lsmacInstance, gErrorNoResourcesAvailable_c, NULL);
+    SMACTxQueueNext(lsmacInstance);
+  }
+}
+
+/************************************************************************************
+* SMACFreeDataMessages
+* 
+* Frees the data request and the pre-allocated data confirm of a SMAC instance, 
+* together with an optional extra message, using a single MemManager call.
+* 
+************************************************************************************/
+static void SMACFreeDataMessages(instanceId_t instance, void* pExtraMsg)
+{
+  void* pMsgs[3];
+  
+  pMsgs[0] = maSmacAttributes[instance].gSmacDataMessage;
+  pMsgs[1] = maSmacAttributes[instance].gSmacDataCnfMessage;
+  pMsgs[2] = pExtraMsg;
+  maSmacAttributes[instance].gSmacDataMessage = NULL;
+  maSmacAttributes[instance].gSmacDataCnfMessage = NULL;
+  
+  (void)MEM_BufferFreeBatch(pMsgs, 3);
+}
+
+/************************************************************************************
+* SMACDataRequestSend
+* 
+* Fill the PHY related fields of a data request, whose PSDU holds the SMAC header
+* and payload, and send it to the PHY. 
+*
+************************************************************************************/
+static smacErrors_t SMACDataRequestSend
+(
+macToPdDataMessage_t *pMsg,
+smacToAppDataMessage_t *pCnfMsg,
+uint8_t u8DataLength
+)
+{
+#if !gUseSMACLegacy_c
+  smacHeader_t *pHeader = (smacHeader_t*)pMsg->msgData.dataReq.pPsdu;
+#endif
+#if gSmacTxQueueSize_c
+  smacTxQueueEntry_t* pEntry;
+  void *pMsgs[2];
+#endif
+  
+  maSmacAttributes[mSmacActivePan].u8SmacSeqNo++;
+  
+  /* Fill with Phy related data */
+  pMsg->macInstance = mSmacActivePan;
+  pMsg->msgType = gPdDataReq_c;
+  //SMAC doesn't use slotted mode
+  pMsg->msgData.dataReq.slottedTx = gPhyUnslottedMode_c;
+  //start transmission immediately
+  pMsg->msgData.dataReq.startTime = gPhySeqStartAsap_c;
+#ifdef gPHY_802_15_4g_d
+  //for sub-Gig phy handles duration in case of ACK
+  pMsg->msgData.dataReq.txDuration = 0xFFFFFFFF;
+#else
+  
+#if !gUseSMACLegacy_c
+  if(maSmacAttributes[mSmacActivePan].txConfigurator.autoAck && 
+     pHeader->destAddr != 0xFFFF &&
+       pHeader->panId != 0xFFFF)
+  {
+                                    //Turn@       +       phy payload(symbols)+ Turn@ + ACK
+    pMsg->msgData.dataReq.txDuration = 12 + (6 + u8DataLength + 2)*2 + 12 + 42; 
+    if(maSmacAttributes[mSmacActivePan].txConfigurator.ccaBeforeTx)
+    {
+      pMsg->msgData.dataReq.txDuration += 0x08; //CCA Duration: 8 symbols
+    }
+#if gSmacUseSecurity_c
+	/*if security is used take padding into account for tx duration*/
+    pMsg->msgData.dataReq.txDuration += ( ENC_BLOCK_SIZE - ((u8DataLength - gSmacHeaderBytes_c
+                                                            +ENC_BLOCK_SIZE)&(ENC_BLOCK_SIZE-1))
+                                         )*2;
+#endif
+  }
+  else
+#endif  
+  {
+    pMsg->msgData.dataReq.txDuration = 0xFFFFFFFF;
+  }
+#endif
+  pMsg->msgData.dataReq.psduLength = u8DataLength + gSmacHeaderBytes_c;
+  if(maSmacAttributes[mSmacActivePan].txConfigurator.ccaBeforeTx)
+  {
+    //tell phy to perform CCA before transmission
+    pMsg->msgData.dataReq.CCABeforeTx = gPhyCCAMode1_c;
+  }
+  else
+  {
+    pMsg->msgData.dataReq.CCABeforeTx = gPhyNoCCABeforeTx_c;
+  }
+#if !gUseSMACLegacy_c  
+  if(maSmacAttributes[mSmacActivePan].txConfigurator.autoAck && 
+     pHeader->destAddr != 0xFFFF &&
+       pHeader->panId != 0xFFFF)
+  {
+    //set frame control option: ACK.
+    pMsg->msgData.dataReq.pPsdu[0] |=   gFrameCtrlAckReqMsk_c;
+    pMsg->msgData.dataReq.ackRequired = gPhyRxAckRqd_c;
+  }
+  else
+#endif
+  {
+    pMsg->msgData.dataReq.ackRequired = gPhyNoAckRqd_c;
+  }
+#if gSmacUseSecurity_c
+  uint8_t inputLen = pMsg->msgData.dataReq.psduLength - gSmacHeaderBytes_c;
+  SMAC_Encrypt(pMsg->msgData.dataReq.pPsdu + gSmacHeaderBytes_c, pMsg->msgData.dataReq.pPsdu + gSmacHeaderBytes_c, 
+               &(inputLen),
+               mSmacActivePan);
+  pMsg->msgData.dataReq.psduLength = inputLen + gSmacHeaderBytes_c;
+#endif
+  //set sequence number;
+#if !gUseSMACLegacy_c
+  pMsg->msgData.dataReq.pPsdu[2] = maSmacAttributes[mSmacActivePan].u8SmacSeqNo;
+#endif
+  
+  OSA_InterruptDisable();
+#if gSmacTxQueueSize_c
+  if(mSmacStateIdle_c != maSmacAttributes[mSmacActivePan].smacState)
+  {
+    //the packet is sent after the packets queued before it are confirmed
+    if((mSmacStateTransmitting_c == maSmacAttributes[mSmacActivePan].smacState) &&
+       (maSmacAttributes[mSmacActivePan].u8TxQueueCount < gSmacTxQueueSize_c))
+    {
+      pEntry = &maSmacAttributes[mSmacActivePan].smacTxQueue[
+        (maSmacAttributes[mSmacActivePan].u8TxQueueHead + 
+         maSmacAttributes[mSmacActivePan].u8TxQueueCount) % gSmacTxQueueSize_c];
+      pEntry->pDataMessage = pMsg;
+      pEntry->pDataCnfMessage = pCnfMsg;
+      maSmacAttributes[mSmacActivePan].u8TxQueueCount++;
+      OSA_InterruptEnable();
+      return gErrorNoError_c;
+    }
+    //the queue was filled from another context since the caller checked it
+    OSA_InterruptEnable();
+    pMsgs[0] = pMsg;
+    pMsgs[1] = pCnfMsg;
+    (void)MEM_BufferFreeBatch(pMsgs, 2);
+    return gErrorNoResourcesAvailable_c;
+  }
+#endif
+  maSmacAttributes[mSmacActivePan].smacState = mSmacStateTransmitting_c; 
+  OSA_InterruptEnable();
+
+  if(gPhySuccess_c == SMACDataRequestStart(mSmacActivePan, pMsg, pCnfMsg))
+  {
+    return gErrorNoError_c;
+  }
+  else
+  {
+    SMACFreeDataMessages(mSmacActivePan, NULL);
+    //packets may have been queued since SMAC left the idle state
+    SMACTxQueueNext(mSmacActivePan);
+    return gErrorNoResourcesAvailable_c;
+  }
+}
+
+/************************************************************************************
+* SMACDataRequestStart
+* 
+* Make a data request the packet under transmission of a SMAC instance and send it
+* to the PHY.
+*
+************************************************************************************/
+static phyStatus_t SMACDataRequestStart
+(
+instanceId_t instance, 
+macToPdDataMessage_t *pMsg, 
+smacToAppDataMessage_t *pCnfMsg
+)
+{
+  //Store pointers for freeing later 
+  maSmacAttributes[instance].gSmacDataMessage = pMsg;
+  maSmacAttributes[instance].gSmacDataCnfMessage = pCnfMsg;
+  maSmacAttributes[instance].u8AckRetryCounter = 0;
+  maSmacAttributes[instance].u8CCARetryCounter = 0;
+  
+  return MAC_PD_SapHandler(pMsg, 0);
+}
+
+/************************************************************************************
+* SMACDataRequestAccepted
+* 
+* Check if a SMAC instance can take a new data request, either to send it at once
+* or to queue it behind the packet under transmission.
+*
+************************************************************************************/
+static bool_t SMACDataRequestAccepted
+(
+instanceId_t instance
+)
+{
+#if gSmacTxQueueSize_c
+  if((mSmacStateTransmitting_c == maSmacAttributes[instance].smacState) &&
+     (maSmacAttributes[instance].u8TxQueueCount < gSmacTxQueueSize_c))
+  {
+    return TRUE;
+  }
+#endif
+  return (mSmacStateIdle_c == maSmacAttributes[instance].smacState);
+}
+
+/************************************************************************************
+* SMACDataConfirm
+* 
+* Send the data confirm of the packet under transmission to the application. The 
+* data request is freed, together with an optional extra message.
+*
+************************************************************************************/
+static void SMACDataConfirm
+(
+instanceId_t instance, 
+smacErrors_t status, 
+void* pExtraMsg
+)
+{
+  smacToAppDataMessage_t* pSmacMsg = maSmacAttributes[instance].gSmacDataCnfMessage;
+  
+  maSmacAttributes[instance].gSmacDataCnfMessage = NULL;
+  SMACFreeDataMessages(instance, pExtraMsg);
+  
+  //the packet was already dropped, together with its confirm, by MLMETXDisableRequest
+  if(NULL == pSmacMsg)
+  {
+    return;
+  }
+  pSmacMsg->msgType = gMcpsDataCnf_c;
+  pSmacMsg->msgData.dataCnf.status = status;
+  // call App Sap
+  maSmacAttributes[instance].gSMAC_APP_MCPS_SapHandler(pSmacMsg, instance); 
+}
+
+/************************************************************************************
+* SMACTxQueueNext
+* 
+* Called when the packet under transmission is done. The next queued packet is sent
+* to the PHY at once. If there is none, SMAC is placed into idle state.
+*
+************************************************************************************/
+static void SMACTxQueueNext
+(
+instanceId_t instance
+)
+{
+#if gSmacTxQueueSize_c
+  smacTxQueueEntry_t entry;
+  
+  for(;;)
   {
     OSA_InterruptDisable();
-    maSmacAttributes[lsmacInstance].smacState = mSmacStateIdle_c;
+    if(0 == maSmacAttributes[instance].u8TxQueueCount)
+    {
+      maSmacAttributes[instance].smacState = mSmacStateIdle_c;
+      OSA_InterruptEnable();
+      return;
+    }
+    entry = maSmacAttributes[instance].smacTxQueue[maSmacAttributes[instance].u8TxQueueHead];
+    maSmacAttributes[instance].u8TxQueueHead = 
+      (maSmacAttributes[instance].u8TxQueueHead + 1) % gSmacTxQueueSize_c;
+    maSmacAttributes[instance].u8TxQueueCount--;
     OSA_InterruptEnable();
     
-    MEM_BufferFree(maSmacAttributes[lsmacInstance].gSmacDataMessage);
-    maSmacAttributes[lsmacInstance].gSmacDataMessage = NULL;
+    if(gPhySuccess_c == SMACDataRequestStart(instance, entry.pDataMessage, entry.pDataCnfMessage))
+    {
+      return;
+    }
+    //the packet could not be sent, so it is confirmed with an error
+    SMACDataConfirm(instance, gErrorNoResourcesAvailable_c, NULL);
+  }
+#else
+  OSA_InterruptDisable();
+  maSmacAttributes[instance].smacState = mSmacStateIdle_c;
+  OSA_InterruptEnable();
+#endif
+}
+
+
+/************************************************************************************
+* SMACRxEnable
+* 
+* Place the radio into receive mode. If gsRxPacket is NULL, the received packets
+* are delivered in place, in the PHY buffer. In continuous mode, gsRxPacket is the 
+* first buffer of the ring.
+*
+************************************************************************************/
+static smacErrors_t SMACRxEnable
+(
+rxPacket_t *gsRxPacket,
+smacTime_t stTimeout,
+bool_t bContinuous
+)
+{
+  uint8_t u8PhyRes = 0; 
+  macToPlmeMessage_t lMsg;
+  
+#if(TRUE == smacInitializationValidation_d)
+  if(FALSE == mSmacInitialized)
+  {
+    return gErrorNoValidCondition_c;
+  }
+#endif     /* TRUE == smacInitializationValidation_d */
+  
+  if(mSmacStateIdle_c != maSmacAttributes[mSmacActivePan].smacState)
+  {
+    return gErrorBusy_c;
+  }
+  lMsg.macInstance = mSmacActivePan;
+  if(stTimeout)
+  {
+    lMsg.msgType = gPlmeSetTRxStateReq_c;
+    lMsg.msgData.setTRxStateReq.startTime = gPhySeqStartAsap_c;
+    lMsg.macInstance = mSmacActivePan;
+    lMsg.msgData.setTRxStateReq.state = gPhySetRxOn_c;
+    lMsg.msgData.setTRxStateReq.rxDuration = stTimeout;
+  }
+  else
+  {
+    lMsg.msgType = gPlmeSetReq_c;
+    lMsg.msgData.setReq.PibAttribute = gPhyPibRxOnWhenIdle;
+    lMsg.msgData.setReq.PibAttributeValue = (uint64_t)1;
+  }
+  maSmacAttributes[mSmacActivePan].mSmacTimeoutAsked = (stTimeout > 0);
+  
+  maSmacAttributes[mSmacActivePan].mSmacRxZeroCopy = (NULL == gsRxPacket);
+  maSmacAttributes[mSmacActivePan].mSmacRxContinuous = bContinuous;
+  if(NULL != gsRxPacket)
+  {
+    gsRxPacket->rxStatus = rxProcessingReceptionStatus_c;
+  }
+  maSmacAttributes[mSmacActivePan].smacProccesPacketPtr.smacRxPacketPointer  
+    = gsRxPacket;
+    
+  OSA_InterruptDisable();
+  maSmacAttributes[mSmacActivePan].smacState = mSmacStateReceiving_c; 
+  OSA_InterruptEnable();
+  u8PhyRes = MAC_PLME_SapHandler(&lMsg, 0);
+  
+  if(u8PhyRes == gPhySuccess_c)
+  { 
+    return gErrorNoError_c;
+  }
+  else
+  {
+    OSA_InterruptDisable();
+    maSmacAttributes[mSmacActivePan].smacState = mSmacStateIdle_c; 
+    OSA_InterruptEnable();
+    maSmacAttributes[mSmacActivePan].mSmacRxContinuous = FALSE;
+    return gErrorNoResourcesAvailable_c;
   }
 }
 
@@ -1709,43 +2209,103 @@ smacMultiPanInstances_t instance
   if( (pMsgFromPhy->msgData.dataInd.psduLength < gSmacHeaderBytes_c) )
     return FALSE;
   //check if PSDU length is greater than the maximum configured SMAC packet size.
-  if( pMsgFromPhy->msgData.dataInd.psduLength > 
-       (maSmacAttributes[instance].smacProccesPacketPtr.smacRxPacketPointer->u8MaxDataLength + gSmacHeaderBytes_c))
+  //packets delivered in place are only bounded by the PHY buffer.
+  if( (!maSmacAttributes[instance].mSmacRxZeroCopy) &&
+      (pMsgFromPhy->msgData.dataInd.psduLength > 
+       (maSmacAttributes[instance].smacProccesPacketPtr.smacRxPacketPointer->u8MaxDataLength + gSmacHeaderBytes_c)) )
     return FALSE;
   
   return TRUE;
 }
 
+#if !gMpmIncluded_d
+/* The indication and the rxPacket_t header must fit in front of the PSDU in the
+   PHY buffer, and the rxPacket_t must be aligned */
+#define mSmacRxPsduOffset_c    (offsetof(pdDataToMacMessage_t, msgData.dataInd.pPsdu) + \
+                                sizeof(uint8_t*) + gPhyRxBufferHeadroom_c)
+#define mSmacRxPacketOffset_c  (mSmacRxPsduOffset_c - offsetof(rxPacket_t, smacHeader))
+typedef uint8_t mSmacRxHeadroomCheck_t[((mSmacRxPsduOffset_c >= offsetof(rxPacket_t, smacHeader)) &&
+                                        (mSmacRxPacketOffset_c >= sizeof(smacToAppDataMessage_t)) &&
+                                        ((mSmacRxPacketOffset_c & 0x03) == 0)) ? 1 : -1];
+
+/************************************************************************************
+* SMACRxIndicationInPlace
+* 
+* Turn the data indication from the PHY into the data indication for the application,
+* in the same buffer. The rxPacket_t is built around the received PSDU, so that its
+* header and payload are the received ones. The application frees the buffer.
+*
+************************************************************************************/
+static void SMACRxIndicationInPlace
+(
+pdDataToMacMessage_t* pDataMsg, 
+instanceId_t instance, 
+rxStatus_t rxStatus
+)
+{
+  smacToAppDataMessage_t* pSmacMsg = (smacToAppDataMessage_t*)pDataMsg;
+  rxPacket_t* pRxPacket = (rxPacket_t*)(pDataMsg->msgData.dataInd.pPsdu - offsetof(rxPacket_t, smacHeader));
+  uint8_t len = 0;
+  
+  if(rxSuccessStatus_c == rxStatus)
+  {
+    len = pDataMsg->msgData.dataInd.psduLength - gSmacHeaderBytes_c;
+#if gSmacUseSecurity_c
+    SMAC_Decrypt(pRxPacket->smacPdu.smacPdu, 
+                 pRxPacket->smacPdu.smacPdu,
+                 &len,
+                 (smacMultiPanInstances_t)instance);
+#endif
+  }
+  
+  //the fields of the phy message are no longer needed
+  pRxPacket->u8MaxDataLength = len;
+  pRxPacket->u8DataLength = len;
+  pRxPacket->rxStatus = rxStatus;
+  pRxPacket->instanceId = (smacMultiPanInstances_t)0;
+  
+  pSmacMsg->msgType = gMcpsDataInd_c;
+  pSmacMsg->msgData.dataInd.pRxPacket = pRxPacket;
+  pSmacMsg->msgData.dataInd.u8LastRxRssi = PhyGetLastRxRssiValue();
+  maSmacAttributes[instance].gSMAC_APP_MCPS_SapHandler(pSmacMsg, instance); 
+  
+  OSA_InterruptDisable();
+  maSmacAttributes[instance].smacState = mSmacStateIdle_c;
+  OSA_InterruptEnable();
+}
+#endif
+
 #if gSmacUseSecurity_c
 /************************************************************************************
 * SMAC Security primitives
 * 
 * These primitives allow to:
 * - Set IV and KEY parameters;
-* - Pad and Encrypt message using AES_128_CBC
+* - Pad and Encrypt message using AES_128_CBC with the per-PAN key context
 * - Decrypt using AES_128_CBC and Depad
 ************************************************************************************/
 void SMAC_SetIVKey(uint8_t* KEY, uint8_t* IV)
 {
   FLib_MemCpy(maSmacAttributes[mSmacActivePan].secInit.KEY, KEY, ENC_BLOCK_SIZE);
   FLib_MemCpy(maSmacAttributes[mSmacActivePan].secInit.IV, IV, ENC_BLOCK_SIZE);
+  AES_128_SetKey(&maSmacAttributes[mSmacActivePan].secKeyCtx, KEY);
 }
 /************************************************************************************/
 static void SMAC_Encrypt(uint8_t* pIn, uint8_t* pOut, uint8_t *len, smacMultiPanInstances_t panID)
 {
-  *len = AES_128_CBC_Encrypt_And_Pad(pIn, 
-                                     (uint32_t)(*len), 
-                                     maSmacAttributes[panID].secInit.IV, 
-                                     maSmacAttributes[panID].secInit.KEY, 
-                                     pOut);  
+  *len = AES_128_Keyed_CBC_Encrypt_And_Pad(pIn, 
+                                           (uint32_t)(*len), 
+                                           maSmacAttributes[panID].secInit.IV, 
+                                           &maSmacAttributes[panID].secKeyCtx, 
+                                           pOut);  
 }
 /************************************************************************************/
 static void SMAC_Decrypt(uint8_t* pIn, uint8_t* pOut, uint8_t *len, smacMultiPanInstances_t panID)
 {
-  *len = AES_128_CBC_Decrypt_And_Depad(pIn, 
-                                       (uint32_t)(*len), 
-                                       maSmacAttributes[panID].secInit.IV, 
-                                       maSmacAttributes[panID].secInit.KEY, 
-                                       pOut);
+  *len = AES_128_Keyed_CBC_Decrypt_And_Depad(pIn, 
+                                             (uint32_t)(*len), 
+                                             maSmacAttributes[panID].secInit.IV, 
+                                             &maSmacAttributes[panID].secKeyCtx, 
+                                             pOut);
 }
 #endif
\ No newline at end of file
@@ -113,6 +113,15 @@ typedef phyStatus_t ( * PD_SMAC_SapHandler_t)(pdDataToMacMessage_t * pMsg, insta
 
 typedef phyStatus_t ( * PLME_SMAC_SapHandler_t)(plmeToMacMessage_t * pMsg, instanceId_t instanceId);
 
+/***********************************************************************************
+* SMAC data request waiting in the TX queue, with its pre-allocated data confirm
+************************************************************************************/
+typedef struct smacTxQueueEntry_tag
+{
+  macToPdDataMessage_t *   pDataMessage;
+  smacToAppDataMessage_t * pDataCnfMessage;
+} smacTxQueueEntry_t;
+
 /***********************************************************************************
 * SMAC internal attributes
 ************************************************************************************/
@@ -126,7 +135,13 @@ typedef struct smacInternalAttrib_tag
   uint8_t u8SyncWordSize;
 #endif
   macToPdDataMessage_t * gSmacDataMessage;
+  smacToAppDataMessage_t * gSmacDataCnfMessage;
   macToPlmeMessage_t *   gSmacMlmeMessage;
+#if gSmacTxQueueSize_c
+  smacTxQueueEntry_t smacTxQueue[gSmacTxQueueSize_c];
+  uint8_t u8TxQueueHead;
+  uint8_t u8TxQueueCount;
+#endif
   SMAC_APP_MCPS_SapHandler_t gSMAC_APP_MCPS_SapHandler;
   SMAC_APP_MLME_SapHandler_t gSMAC_APP_MLME_SapHandler;
   
@@ -136,11 +151,19 @@ typedef struct smacInternalAttrib_tag
   uint8_t u8AckRetryCounter;
   uint8_t u8CCARetryCounter;
   uint8_t mSmacTimeoutAsked;
+  uint8_t mSmacRxZeroCopy;
+  uint8_t mSmacRxContinuous;
+  
+  rxPacket_t ** ppRxRing;
+  uint32_t u32RxDropCount;
+  uint8_t u8RxRingSize;
+  uint8_t u8RxRingNext;
   
   uint8_t u8BackoffTimerId;
   uint8_t u8SmacSeqNo;
 #if (gSmacUseSecurity_c)
   smacEncryptionKeyIV_t secInit;
+  aes128Context_t secKeyCtx;
 #endif
 } smacInternalAttrib_t;
 /************************************************************************************
@@ -55,6 +55,9 @@
 /* Default DCDC Mode used by the application */           
 #define APP_DCDC_MODE                   gDCDC_Mode_Buck_c
 #define gEepromType_d gEepromDevice_InternalFlash_c
-#define PoolsDetails_c                  _block_size_ 64 _number_of_blocks_ 10 _eol_ _block_size_ 128 _number_of_blocks_ 2 _eol_ _block_size_ 256 _number_of_blocks_ 10 _eol_
+/* One 256 byte block is reserved for the PHY RX buffer and two 64 byte blocks for the SMAC indications and confirms */
+#define PoolsDetails_c                  _block_size_ 64 _number_of_blocks_ 10 _reserved_blocks_(2) _eol_ _block_size_ 128 _number_of_blocks_ 2 _eol_ _block_size_ 256 _number_of_blocks_ 10 _reserved_blocks_(1) _eol_
+/* Split idle 256 byte blocks when the smaller pools are exhausted */
+#define MEM_POOL_SPLITTING              1
 
 #endif /* __APP_PREINCLUDE_H__ */
\ No newline at end of file
@@ -31,6 +31,7 @@
 */
 
 #include "connectivity_test_menus.h"
+#include "TimersManager.h"
 
 /************************************************************************************
 *************************************************************************************
@@ -72,6 +73,12 @@ char * const cu8MainMenu[]={
   "\r -Press [m] to decrease the Payload\n",
   "\r -Press [k] to increase CCA Threshold in Carrier Sense Test\n",
   "\r -Press [l] to decrease CCA Threshold in Carrier Sense Test\n",
+#ifdef MEM_STATISTICS
+  "\r -Press [b] to print the memory pools report\n",
+#endif
+#if gTMR_EnableProfiling_d
+  "\r -Press [j] to print the timer callbacks profile\n",
+#endif
   "\r These keys can be used all over the application to change \n",
   "\r the test parameters\n",
   "\r  ________________________________\n",
@@ -252,6 +252,18 @@ void ShortCutsParser(uint8_t u8UartData)
     }
 #endif
     break;
+#ifdef MEM_STATISTICS
+  case 'b':
+    MEM_PoolsReport(mAppSer);
+    evTestParameters = FALSE;
+    break;
+#endif
+#if gTMR_EnableProfiling_d
+  case 'j':
+    TMR_ProfilingReport(mAppSer);
+    evTestParameters = FALSE;
+    break;
+#endif
   default:
     evDataFromUART = TRUE;
     evTestParameters = FALSE;
@@ -0,0 +1,283 @@
+/*!
+* Copyright 2016-2017 NXP
+*
+* \file
+*
+* Host benchmarks of the Memory Manager: the size class table against the walk of
+* the pool list that it replaced, and compact pools against list pools.
+*
+* Redistribution and use in source and binary forms, with or without modification,
+* are permitted provided that the following conditions are met:
+*
+* o Redistributions of source code must retain the above copyright notice, this list
+*   of conditions and the following disclaimer.
+*
+* o Redistributions in binary form must reproduce the above copyright notice, this
+*   list of conditions and the following disclaimer in the documentation and/or
+*   other materials provided with the distribution.
+*
+* o Neither the name of Freescale Semiconductor, Inc. nor the names of its
+*   contributors may be used to endorse or promote products derived from this
+*   software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+* ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+* ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/*! *********************************************************************************
+*************************************************************************************
+* Include
+*************************************************************************************
+********************************************************************************** */
+#include "HostTest.h"
+#include "MemManager.c"
+
+/*! *********************************************************************************
+*************************************************************************************
+* Private macros
+*************************************************************************************
+********************************************************************************** */
+#define mBenchIterations_c      200
+
+/*! *********************************************************************************
+*************************************************************************************
+* Private memory declarations
+*************************************************************************************
+********************************************************************************** */
+static volatile uintptr_t mBenchSink;
+
+/*! *********************************************************************************
+*************************************************************************************
+* Private functions
+*************************************************************************************
+********************************************************************************** */
+/* Pool lookup of MEM_BufferAllocWithId() before the size class table */
+static pools_t* MemBench_LinearFirstPool(uint32_t numBytes, uint8_t poolId)
+{
+    pools_t *pPools = memPools;
+
+    poolId &= ~MEM_CriticalAllocFlag_c;
+
+    for(;;)
+    {
+        if( (numBytes <= pPools->blockSize) && (poolId == pPools->poolId) )
+        {
+            return pPools;
+        }
+
+        if( 0 == pPools->nextBlockSize )
+        {
+            return NULL;
+        }
+
+        pPools++;
+    }
+}
+
+/* Pool lookup of MEM_BufferAllocWithId() with the size class table */
+static pools_t* MemBench_TableFirstPool(uint32_t numBytes, uint8_t poolId)
+{
+    pools_t *pPools = MEM_GetFirstPool(numBytes, poolId);
+
+    poolId &= ~MEM_CriticalAllocFlag_c;
+
+    while( pPools )
+    {
+        if( (numBytes <= pPools->blockSize) && (poolId == pPools->poolId) )
+        {
+            return pPools;
+        }
+
+        pPools = pPools->nextBlockSize ? pPools + 1 : NULL;
+    }
+
+    return NULL;
+}
+
+static double MemBench_Lookup(pools_t* (*pLookup)(uint32_t, uint8_t), uint8_t poolId)
+{
+    uint64_t start = HostTest_GetTimeNs();
+    uint32_t count = 0;
+    uint32_t i, numBytes;
+
+    for( i = 0; i < mBenchIterations_c; i++ )
+    {
+        for( numBytes = 1; numBytes <= memMaxBlockSize; numBytes++ )
+        {
+            mBenchSink += (uintptr_t)pLookup(numBytes, poolId);
+            count++;
+        }
+    }
+
+    return (double)(HostTest_GetTimeNs() - start) / count;
+}
+
+/* MEM_BufferAllocWithId() before the size class table */
+static void* MemBench_LinearAlloc(uint32_t numBytes, uint8_t poolId, void *pCaller)
+{
+    void *pBlock;
+
+    (void)pCaller;
+    OSA_InterruptDisable();
+    pBlock = MEM_BufferAllocFromPools(MemBench_LinearFirstPool(numBytes, poolId), numBytes, poolId);
+    OSA_InterruptEnable();
+
+    return pBlock;
+}
+
+static double MemBench_AllocFree(void* (*pAlloc)(uint32_t, uint8_t, void*), uint8_t poolId)
+{
+    uint64_t start = HostTest_GetTimeNs();
+    uint32_t count = 0;
+    uint32_t i, numBytes;
+    void *pBuffer;
+
+    for( i = 0; i < mBenchIterations_c; i++ )
+    {
+        for( numBytes = 1; numBytes <= memMaxBlockSize; numBytes++ )
+        {
+            pBuffer = pAlloc(numBytes, poolId, NULL);
+            if( pBuffer )
+            {
+                (void)MEM_BufferFree(pBuffer);
+            }
+            count++;
+        }
+    }
+
+    return (double)(HostTest_GetTimeNs() - start) / count;
+}
+
+/* Allocates all the blocks of a pool, then frees them */
+static double MemBench_PoolFill(pools_t *pPool)
+{
+    static void *pBuffers[256];
+    uint64_t start = HostTest_GetTimeNs();
+    uint32_t count = 0;
+    uint32_t i, j;
+
+    for( i = 0; i < mBenchIterations_c; i++ )
+    {
+        for( j = 0; j < pPool->numBlocks; j++ )
+        {
+            pBuffers[j] = MEM_BufferAllocWithId(pPool->blockSize, pPool->poolId, NULL);
+        }
+        for( j = 0; j < pPool->numBlocks; j++ )
+        {
+            (void)MEM_BufferFree(pBuffers[j]);
+        }
+        count += pPool->numBlocks;
+    }
+
+    return (double)(HostTest_GetTimeNs() - start) / count;
+}
+
+/* Frees all the blocks of a pool. Only the frees are timed. */
+static double MemBench_PoolFree(pools_t *pPool)
+{
+    static void *pBuffers[256];
+    uint64_t elapsed = 0;
+    uint64_t start;
+    uint32_t count = 0;
+    uint32_t i, j;
+
+    for( i = 0; i < mBenchIterations_c; i++ )
+    {
+        for( j = 0; j < pPool->numBlocks; j++ )
+        {
+            pBuffers[j] = MEM_BufferAllocWithId(pPool->blockSize, pPool->poolId, NULL);
+        }
+        start = HostTest_GetTimeNs();
+        for( j = 0; j < pPool->numBlocks; j++ )
+        {
+            (void)MEM_BufferFree(pBuffers[j]);
+        }
+        elapsed += HostTest_GetTimeNs() - start;
+        count += pPool->numBlocks;
+    }
+
+    return (double)elapsed / count;
+}
+
+/* Compact pool lookup done by MEM_BufferFree() for a block of the pool */
+static double MemBench_CompactLookup(pools_t *pPool)
+{
+    uint8_t *pBlock = pPool->pHeapEnd - pPool->blockSize;
+    uint64_t start = HostTest_GetTimeNs();
+    uint32_t count = 0;
+    uint32_t i, j;
+
+    for( i = 0; i < mBenchIterations_c; i++ )
+    {
+        for( j = 0; j < pPool->numBlocks; j++ )
+        {
+            mBenchSink += (uintptr_t)MEM_GetCompactPool(pBlock);
+        }
+        count += pPool->numBlocks;
+    }
+
+    return (double)(HostTest_GetTimeNs() - start) / count;
+}
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public functions
+*************************************************************************************
+********************************************************************************** */
+int main(void)
+{
+    pools_t *pPool;
+    uint8_t poolId;
+    uint32_t i;
+
+    if( MEM_SUCCESS_c != MEM_Init() )
+    {
+        printf("MEM_Init failed\n");
+        return 1;
+    }
+
+    printf("MemManager pool lookup, %u pools, sizes 1..%u, ns per call\n",
+           (unsigned)NumberOfElements(memPools), (unsigned)memMaxBlockSize);
+    printf("              lookup        alloc+free\n");
+    printf("poolId  linear  table  linear  table\n");
+
+    for( poolId = 0; poolId < 2; poolId++ )
+    {
+        printf("%6u %7.1f %6.1f %7.1f %6.1f\n", poolId,
+               MemBench_Lookup(MemBench_LinearFirstPool, poolId),
+               MemBench_Lookup(MemBench_TableFirstPool, poolId),
+               MemBench_AllocFree(MemBench_LinearAlloc, poolId),
+               MemBench_AllocFree(MEM_BufferAllocWithId, poolId));
+    }
+
+    /* The list header is 16 bytes on the target, but bigger on a 64 bit host */
+    printf("\nPools of 64 blocks of 64 bytes, alloc+free ns per block\n");
+    printf("poolId  pool           heap bytes/block  alloc+free  free  lookup\n");
+
+    for( i = 0; i < NumberOfElements(memPools); i++ )
+    {
+        pPool = &memPools[i];
+
+        if( (64 != pPool->blockSize) || (64 != pPool->numBlocks) )
+        {
+            continue;
+        }
+
+        printf("%6u  %-13s %17u %11.1f %5.1f %7.1f\n", pPool->poolId,
+               !pPool->compact ? "list" : (pPool->headerSize ? "compact(4)" : "compact(0)"),
+               (unsigned)((pPool->pHeapEnd - pPool->pHeapStart) / pPool->numBlocks),
+               MemBench_PoolFill(pPool), MemBench_PoolFree(pPool),
+               MemBench_CompactLookup(pPool));
+    }
+
+    return 0;
+}
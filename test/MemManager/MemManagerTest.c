@@ -0,0 +1,715 @@
+/*!
+* Copyright 2016-2017 NXP
+*
+* \file
+*
+* Host tests of the Memory Manager. MemManager.c is included, so that the tests
+* can check the private state of the pools.
+*
+* Redistribution and use in source and binary forms, with or without modification,
+* are permitted provided that the following conditions are met:
+*
+* o Redistributions of source code must retain the above copyright notice, this list
+*   of conditions and the following disclaimer.
+*
+* o Redistributions in binary form must reproduce the above copyright notice, this
+*   list of conditions and the following disclaimer in the documentation and/or
+*   other materials provided with the distribution.
+*
+* o Neither the name of Freescale Semiconductor, Inc. nor the names of its
+*   contributors may be used to endorse or promote products derived from this
+*   software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+* ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+* ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/*! *********************************************************************************
+*************************************************************************************
+* Include
+*************************************************************************************
+********************************************************************************** */
+#include "HostTest.h"
+#include "MemManager.c"
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public memory declarations
+*************************************************************************************
+********************************************************************************** */
+/* Time stamp of the trace records. See MemManagerTestHooks.c */
+extern uint32_t gMemTestTimeStamp;
+
+/*! *********************************************************************************
+*************************************************************************************
+* Private functions
+*************************************************************************************
+********************************************************************************** */
+#ifdef MEM_TRACE
+/* Dumps the trace ring, and returns the records that follow the header */
+static const memTraceRecord_t* MemTest_TraceDump(memTraceHeader_t *pHeader)
+{
+    const uint8_t *pData;
+    uint32_t length;
+
+    HostTest_SerialReset();
+    if( MEM_SUCCESS_c != MEM_TraceDump(0) )
+    {
+        return NULL;
+    }
+
+    pData = HostTest_SerialData(&length);
+    FLib_MemCpy(pHeader, (void*)pData, sizeof(memTraceHeader_t));
+    if( length != sizeof(memTraceHeader_t) + pHeader->recordCount * sizeof(memTraceRecord_t) )
+    {
+        return NULL;
+    }
+
+    return (const memTraceRecord_t*)(pData + sizeof(memTraceHeader_t));
+}
+#endif /*MEM_TRACE*/
+
+/* First pool that can hold the buffer, found by walking all the pools */
+static pools_t* MemTest_LinearFirstPool(uint32_t numBytes, uint8_t poolId)
+{
+    uint32_t i;
+
+    for( i = 0; i < NumberOfElements(memPools); i++ )
+    {
+        if( (numBytes <= memPools[i].blockSize) && (poolId == memPools[i].poolId) )
+        {
+            return &memPools[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* First pool that MEM_BufferAllocFromPools() tries, starting from MEM_GetFirstPool() */
+static pools_t* MemTest_TableFirstPool(uint32_t numBytes, uint8_t poolId)
+{
+    pools_t *pPools = MEM_GetFirstPool(numBytes, poolId);
+
+    poolId &= ~MEM_CriticalAllocFlag_c;
+
+    while( pPools )
+    {
+        if( (numBytes <= pPools->blockSize) && (poolId == pPools->poolId) )
+        {
+            return pPools;
+        }
+
+        pPools = pPools->nextBlockSize ? pPools + 1 : NULL;
+    }
+
+    return NULL;
+}
+
+static uint32_t MemTest_MaxBlockSize(void)
+{
+    uint32_t i, size = 0;
+
+    for( i = 0; i < NumberOfElements(memPools); i++ )
+    {
+        if( memPools[i].blockSize > size )
+        {
+            size = memPools[i].blockSize;
+        }
+    }
+
+    return size;
+}
+
+/*! *********************************************************************************
+*************************************************************************************
+* Test cases
+*************************************************************************************
+********************************************************************************** */
+/* The size class table selects the same pool as a walk of all the pools */
+static void MemTest_SizeClassLookup(void)
+{
+    uint32_t maxSize;
+    uint32_t i, numBytes;
+    uint8_t poolId;
+
+    TEST_ASSERT(MEM_SUCCESS_c == MEM_Init());
+    maxSize = MemTest_MaxBlockSize();
+    TEST_ASSERT(memMaxBlockSize == maxSize);
+
+    for( i = 0; i < NumberOfElements(memPools); i++ )
+    {
+        poolId = memPools[i].poolId;
+
+        for( numBytes = 0; numBytes <= maxSize + 8; numBytes++ )
+        {
+            if( 0 == numBytes )
+            {
+                TEST_ASSERT(NULL == MemTest_TableFirstPool(numBytes, poolId));
+                continue;
+            }
+
+            TEST_ASSERT(MemTest_LinearFirstPool(numBytes, poolId) == MemTest_TableFirstPool(numBytes, poolId));
+            TEST_ASSERT(MemTest_LinearFirstPool(numBytes, poolId) ==
+                        MemTest_TableFirstPool(numBytes, poolId | MEM_CriticalAllocFlag_c));
+        }
+    }
+}
+
+/* Every size is served from the smallest pool that can hold it */
+static void MemTest_SizeClassAlloc(void)
+{
+    uint32_t maxSize;
+    uint32_t i, numBytes;
+    pools_t *pPool;
+    void *pBuffer;
+
+    TEST_ASSERT(MEM_SUCCESS_c == MEM_Init());
+    TEST_ASSERT(MEM_SUCCESS_c == MEM_WriteReadTest());
+    maxSize = MemTest_MaxBlockSize();
+
+    for( i = 0; i < NumberOfElements(memPools); i++ )
+    {
+        for( numBytes = 0; numBytes <= maxSize + 8; numBytes++ )
+        {
+            pPool = MemTest_LinearFirstPool(numBytes, memPools[i].poolId);
+            pBuffer = MEM_BufferAllocWithId(numBytes, memPools[i].poolId, NULL);
+
+            if( (0 == numBytes) || (NULL == pPool) )
+            {
+                TEST_ASSERT(NULL == pBuffer);
+                continue;
+            }
+
+            TEST_ASSERT(NULL != pBuffer);
+            TEST_ASSERT(MEM_BufferGetSize(pBuffer) == pPool->blockSize);
+            TEST_ASSERT(MEM_SUCCESS_c == MEM_BufferFree(pBuffer));
+        }
+    }
+
+    TEST_ASSERT(gFreeMessagesCount == MEM_GetAvailableBlocks(0));
+}
+
+/* A batch allocation that fails releases the buffers allocated so far, and sets
+   every entry to NULL */
+static void MemTest_AllocBatchFailure(void)
+{
+    uint32_t numBytes[4] = {10, 100, 0, 10};
+    void *pBuffers[4];
+    uint32_t freeBlocks, i;
+
+    TEST_ASSERT(MEM_SUCCESS_c == MEM_Init());
+    freeBlocks = MEM_GetAvailableBlocks(0);
+    numBytes[2] = memMaxBlockSize + 1;
+
+    for( i = 0; i < 4; i++ )
+    {
+        pBuffers[i] = (void*)&numBytes[i];
+    }
+
+    TEST_ASSERT(MEM_ALLOC_ERROR_c == MEM_BufferAllocBatch(pBuffers, numBytes, 4));
+    TEST_ASSERT(freeBlocks == MEM_GetAvailableBlocks(0));
+    for( i = 0; i < 4; i++ )
+    {
+        TEST_ASSERT(NULL == pBuffers[i]);
+    }
+
+    numBytes[2] = memMaxBlockSize;
+    TEST_ASSERT(MEM_SUCCESS_c == MEM_BufferAllocBatch(pBuffers, numBytes, 4));
+    TEST_ASSERT(freeBlocks == MEM_GetAvailableBlocks(0) + 4);
+    TEST_ASSERT(MEM_SUCCESS_c == MEM_BufferFreeBatch(pBuffers, 4));
+    TEST_ASSERT(freeBlocks == MEM_GetAvailableBlocks(0));
+}
+
+/* Pointers that were not returned by the allocator, and blocks that are already
+   free, are rejected without changing the pools */
+static void MemTest_InvalidFree(void)
+{
+    uint32_t local = 0;
+    uint32_t freeBlocks;
+    uint8_t *pBuffer;
+
+    TEST_ASSERT(MEM_SUCCESS_c == MEM_Init());
+    freeBlocks = MEM_GetAvailableBlocks(0);
+
+    TEST_ASSERT(MEM_FREE_ERROR_c == MEM_BufferFree(NULL));
+    TEST_ASSERT(MEM_FREE_ERROR_c == MEM_BufferFree(&local));
+    TEST_ASSERT(MEM_FREE_ERROR_c == MEM_BufferRetain(&local));
+    TEST_ASSERT(MEM_FREE_ERROR_c == MEM_BufferFree((uint8_t*)memHeap + sizeof(memHeap)));
+
+    pBuffer = MEM_BufferAlloc(memMaxBlockSize);
+    TEST_ASSERT(NULL != pBuffer);
+    TEST_ASSERT(MEM_FREE_ERROR_c == MEM_BufferFree(pBuffer + 4));
+    TEST_ASSERT(MEM_FREE_ERROR_c == MEM_BufferRetain(pBuffer + 4));
+    TEST_ASSERT(freeBlocks == MEM_GetAvailableBlocks(0) + 1);
+
+    TEST_ASSERT(MEM_SUCCESS_c == MEM_BufferFree(pBuffer));
+    TEST_ASSERT(MEM_FREE_ERROR_c == MEM_BufferFree(pBuffer));
+    TEST_ASSERT(MEM_FREE_ERROR_c == MEM_BufferRetain(pBuffer));
+    TEST_ASSERT(freeBlocks == MEM_GetAvailableBlocks(0));
+    TEST_ASSERT(0 == gHostTestIntDisableCount);
+}
+
+/* A block returns to its pool with the last of its references, and cannot be
+   referenced or freed again once free. See MemTest_SplitAlloc() for the blocks
+   carved out of a bigger block, which cannot be referenced at all. */
+static void MemTest_RefCount(void)
+{
+    void *pBuffers[2];
+    uint32_t freeBlocks, i;
+
+    TEST_ASSERT(MEM_SUCCESS_c == MEM_Init());
+    freeBlocks = MEM_GetAvailableBlocks(0);
+
+    pBuffers[0] = MEM_BufferAlloc(1);
+    TEST_ASSERT(NULL != pBuffers[0]);
+    for( i = 0; i < 0xFF; i++ )
+    {
+        TEST_ASSERT(MEM_SUCCESS_c == MEM_BufferRetain(pBuffers[0]));
+    }
+    TEST_ASSERT(MEM_FREE_ERROR_c == MEM_BufferRetain(pBuffers[0]));
+
+    for( i = 0; i < 0xFF; i++ )
+    {
+        TEST_ASSERT(MEM_SUCCESS_c == MEM_BufferFree(pBuffers[0]));
+        TEST_ASSERT(freeBlocks == MEM_GetAvailableBlocks(0) + 1);
+    }
+    TEST_ASSERT(MEM_SUCCESS_c == MEM_BufferFree(pBuffers[0]));
+    TEST_ASSERT(freeBlocks == MEM_GetAvailableBlocks(0));
+    TEST_ASSERT(MEM_FREE_ERROR_c == MEM_BufferFree(pBuffers[0]));
+    TEST_ASSERT(MEM_FREE_ERROR_c == MEM_BufferRetain(pBuffers[0]));
+
+    /* A batch drops one reference per entry */
+    pBuffers[0] = MEM_BufferAlloc(1);
+    TEST_ASSERT(MEM_SUCCESS_c == MEM_BufferRetain(pBuffers[0]));
+    pBuffers[1] = pBuffers[0];
+    TEST_ASSERT(MEM_SUCCESS_c == MEM_BufferFreeBatch(pBuffers, 2));
+    TEST_ASSERT(freeBlocks == MEM_GetAvailableBlocks(0));
+    TEST_ASSERT(MEM_FREE_ERROR_c == MEM_BufferFree(pBuffers[0]));
+
+    /* The counter is cleared when the block is allocated again */
+    pBuffers[0] = MEM_BufferAlloc(1);
+    TEST_ASSERT(MEM_SUCCESS_c == MEM_BufferFree(pBuffers[0]));
+    TEST_ASSERT(freeBlocks == MEM_GetAvailableBlocks(0));
+}
+
+#ifdef MEM_POOL_SPLITTING
+/* An allocation that splits a block gets one of the new blocks, and the reserved
+   blocks of the exhausted pool stay free. The new block cannot be referenced, and
+   cannot be freed again once its donor block was coalesced. */
+static void MemTest_SplitAlloc(void)
+{
+    void *pBuffers[10];
+    void *pCarved;
+    uint32_t i;
+
+    TEST_ASSERT(MEM_SUCCESS_c == MEM_Init());
+
+    /* Drain the 128 byte pool, then the unreserved blocks of the 64 byte pool */
+    pBuffers[0] = MEM_BufferAlloc(128);
+    pBuffers[1] = MEM_BufferAlloc(128);
+    for( i = 2; i < 10; i++ )
+    {
+        pBuffers[i] = MEM_BufferAlloc(64);
+        TEST_ASSERT(NULL != pBuffers[i]);
+    }
+    TEST_ASSERT(memPools[0].reservedBlocks == ListGetSize((listHandle_t)&memPools[0].anchor));
+
+    /* The next allocation splits a 256 byte block into 3 blocks */
+    pCarved = MEM_BufferAlloc(64);
+    TEST_ASSERT(NULL != pCarved);
+    TEST_ASSERT(1 == memPools[2].poolStatistics.splitCount);
+    TEST_ASSERT((uint8_t*)pCarved >= memPools[2].pHeapStart);
+    TEST_ASSERT((uint8_t*)pCarved < memPools[2].pHeapEnd);
+    TEST_ASSERT(memPools[0].reservedBlocks + 2 == ListGetSize((listHandle_t)&memPools[0].anchor));
+    TEST_ASSERT(MEM_BufferGetSize(pCarved) == 64);
+    TEST_ASSERT(MEM_FREE_ERROR_c == MEM_BufferRetain(pCarved));
+
+    TEST_ASSERT(MEM_SUCCESS_c == MEM_BufferFree(pCarved));
+    TEST_ASSERT(1 == memPools[2].poolStatistics.coalesceCount);
+    TEST_ASSERT(memPools[0].reservedBlocks == ListGetSize((listHandle_t)&memPools[0].anchor));
+    TEST_ASSERT(MEM_FREE_ERROR_c == MEM_BufferFree(pCarved));
+    TEST_ASSERT(MEM_FREE_ERROR_c == MEM_BufferRetain(pCarved));
+
+    TEST_ASSERT(MEM_SUCCESS_c == MEM_BufferFreeBatch(pBuffers, 10));
+    TEST_ASSERT(gFreeMessagesCount == MEM_GetAvailableBlocks(0));
+    TEST_ASSERT(22 == gFreeMessagesCount);
+}
+#endif /*MEM_POOL_SPLITTING*/
+
+#if defined(MEM_STATISTICS) && !defined(MEM_TEST_COMPACT)
+/* Once the other blocks are allocated, the reserved blocks are only served to
+   critical allocations, and the critical allocations that find none are counted */
+static void MemTest_ReservedBlocks(void)
+{
+    static void *pBuffers[64];
+    void *pCritical[5];
+    uint32_t count = 0;
+    uint32_t i;
+
+    TEST_ASSERT(MEM_SUCCESS_c == MEM_Init());
+
+    /* Drain the pools, including the blocks carved out of bigger blocks */
+    while( NULL != (pBuffers[count] = MEM_BufferAlloc(1)) )
+    {
+        count++;
+        TEST_ASSERT(count < NumberOfElements(pBuffers));
+    }
+
+    for( i = 1; i <= memMaxBlockSize; i++ )
+    {
+        TEST_ASSERT(NULL == MEM_BufferAlloc(i));
+    }
+    TEST_ASSERT(memPools[0].reservedBlocks == ListGetSize((listHandle_t)&memPools[0].anchor));
+    TEST_ASSERT(0 == ListGetSize((listHandle_t)&memPools[1].anchor));
+    TEST_ASSERT(memPools[2].reservedBlocks == ListGetSize((listHandle_t)&memPools[2].anchor));
+    TEST_ASSERT(0 == memPools[0].poolStatistics.reserveHits);
+    TEST_ASSERT(0 == memPools[0].poolStatistics.reserveMisses);
+
+    /* The reserved 64 byte blocks, then the reserved 256 byte block, which is
+       split into 64 byte blocks. Normal allocations get none of them. */
+    for( i = 0; i < 5; i++ )
+    {
+        pCritical[i] = MEM_BufferAllocCritical(1);
+        TEST_ASSERT(NULL != pCritical[i]);
+        TEST_ASSERT(MEM_BufferGetSize(pCritical[i]) == 64);
+        TEST_ASSERT(NULL == MEM_BufferAlloc(1));
+    }
+    TEST_ASSERT(4 == memPools[0].poolStatistics.reserveHits);
+    TEST_ASSERT(1 == memPools[0].poolStatistics.reserveMisses);
+    TEST_ASSERT(1 == memPools[2].poolStatistics.reserveHits);
+    TEST_ASSERT(0 == memPools[2].poolStatistics.reserveMisses);
+
+    TEST_ASSERT(NULL == MEM_BufferAllocCritical(1));
+    TEST_ASSERT(2 == memPools[0].poolStatistics.reserveMisses);
+    TEST_ASSERT(1 == memPools[2].poolStatistics.reserveMisses);
+
+    /* A freed reserved block is not served to normal allocations either */
+    TEST_ASSERT(MEM_SUCCESS_c == MEM_BufferFree(pCritical[0]));
+    TEST_ASSERT(NULL == MEM_BufferAlloc(1));
+    TEST_ASSERT(pCritical[0] == MEM_BufferAllocCritical(1));
+    TEST_ASSERT(5 == memPools[0].poolStatistics.reserveHits);
+
+    TEST_ASSERT(MEM_SUCCESS_c == MEM_BufferFreeBatch(pCritical, 5));
+    TEST_ASSERT(MEM_SUCCESS_c == MEM_BufferFreeBatch(pBuffers, count));
+    TEST_ASSERT(22 == MEM_GetAvailableBlocks(0));
+
+    /* The test of the pools takes the reserved blocks too, and resets the
+       statistics. It expects the block lists in their initial order. */
+    TEST_ASSERT(MEM_SUCCESS_c == MEM_Init());
+    memPools[0].poolStatistics.reserveMisses = 2;
+    memPools[2].poolStatistics.reserveMisses = 1;
+    TEST_ASSERT(MEM_SUCCESS_c == MEM_WriteReadTest());
+    TEST_ASSERT(0 == memPools[2].poolStatistics.reserveHits);
+    TEST_ASSERT(0 == memPools[0].poolStatistics.reserveHits);
+    TEST_ASSERT(0 == memPools[0].poolStatistics.reserveMisses);
+    TEST_ASSERT(0 == memPools[2].poolStatistics.reserveMisses);
+}
+
+/* The report lists the statistics of every pool, and a PoolsDetails_c definition
+   sized from the peaks */
+static void MemTest_PoolsReport(void)
+{
+    static const char report[] =
+        "\r\nSize Blocks Used Peak Fail Rec\r\n"
+        "64 10 1 5 0 7\r\n"
+        "128 2 0 1 0 2\r\n"
+        "256 10 0 0 0 2\r\n"
+        "Min free 16\r\n"
+        "#define PoolsDetails_c"
+        " _block_size_ 64 _number_of_blocks_ 7 _reserved_blocks_(2) _eol_"
+        " _block_size_ 128 _number_of_blocks_ 2 _eol_"
+        " _block_size_ 256 _number_of_blocks_ 2 _reserved_blocks_(1) _eol_\r\n";
+    void *pBuffers[6];
+    const uint8_t *pData;
+    uint32_t length, i;
+
+    TEST_ASSERT(MEM_SUCCESS_c == MEM_Init());
+
+    for( i = 0; i < 5; i++ )
+    {
+        pBuffers[i] = MEM_BufferAlloc(64);
+    }
+    pBuffers[5] = MEM_BufferAlloc(128);
+    TEST_ASSERT(MEM_SUCCESS_c == MEM_BufferFreeBatch(&pBuffers[1], 5));
+
+    HostTest_SerialReset();
+    MEM_PoolsReport(0);
+    pData = HostTest_SerialData(&length);
+    TEST_ASSERT((length == sizeof(report) - 1) && FLib_MemCmp((void*)pData, (void*)report, length));
+
+    TEST_ASSERT(MEM_SUCCESS_c == MEM_BufferFree(pBuffers[0]));
+}
+#endif
+
+#ifdef MEM_TRACE
+/* Every operation is recorded in order, with its result */
+static void MemTest_TraceRecords(void)
+{
+    memTraceHeader_t header;
+    const memTraceRecord_t *pRecords;
+    void *pBuffer;
+
+    TEST_ASSERT(MEM_SUCCESS_c == MEM_Init());
+    gMemTestTimeStamp = 0;
+
+    pBuffer = MEM_BufferAllocWithId(20, 0, (void*)0x1234);
+    TEST_ASSERT(NULL != pBuffer);
+    TEST_ASSERT(MEM_SUCCESS_c == MEM_BufferRetain(pBuffer));
+    TEST_ASSERT(MEM_SUCCESS_c == MEM_BufferFree(pBuffer));
+    TEST_ASSERT(MEM_SUCCESS_c == MEM_BufferFree(pBuffer));
+    TEST_ASSERT(MEM_FREE_ERROR_c == MEM_BufferFree(pBuffer));
+    TEST_ASSERT(NULL == MEM_BufferAllocWithId(memMaxBlockSize + 1, 0, (void*)0x5678));
+
+    pRecords = MemTest_TraceDump(&header);
+    TEST_ASSERT(NULL != pRecords);
+    TEST_ASSERT(mMemTraceMagic_c == header.magic);
+    TEST_ASSERT(6 == header.sequence);
+    TEST_ASSERT(6 == header.recordCount);
+    TEST_ASSERT(sizeof(memTraceRecord_t) == header.recordSize);
+    TEST_ASSERT((uint32_t)(uintptr_t)memHeap == header.heapStart);
+
+    TEST_ASSERT(MEM_TRACE_ALLOC_c == pRecords[0].op);
+    TEST_ASSERT((uint32_t)(uintptr_t)pBuffer == pRecords[0].block);
+    TEST_ASSERT(0x1234 == pRecords[0].caller);
+    TEST_ASSERT(20 == pRecords[0].size);
+    TEST_ASSERT(21 == pRecords[0].freeBlocks);
+    TEST_ASSERT(MEM_TRACE_RETAIN_c == pRecords[1].op);
+    TEST_ASSERT(MEM_TRACE_FREE_c == pRecords[2].op);
+    TEST_ASSERT(21 == pRecords[2].freeBlocks);
+    TEST_ASSERT(MEM_TRACE_FREE_c == pRecords[3].op);
+    TEST_ASSERT(22 == pRecords[3].freeBlocks);
+    TEST_ASSERT(MEM_TRACE_FREE_ERROR_c == pRecords[4].op);
+    TEST_ASSERT((uint32_t)(uintptr_t)pBuffer == pRecords[4].block);
+    TEST_ASSERT(MEM_TRACE_ALLOC_c == pRecords[5].op);
+    TEST_ASSERT(0 == pRecords[5].block);
+    TEST_ASSERT(0x5678 == pRecords[5].caller);
+    TEST_ASSERT(pRecords[0].timeStamp < pRecords[5].timeStamp);
+}
+
+/* Once the ring wrapped, the dump holds the newest records, oldest first */
+static void MemTest_TraceWrap(void)
+{
+    memTraceHeader_t header;
+    const memTraceRecord_t *pRecords;
+    void *pBuffer;
+    uint32_t i, count = MEM_TraceRingSize_c + MEM_TraceRingSize_c / 2 + 3;
+
+    TEST_ASSERT(MEM_SUCCESS_c == MEM_Init());
+    gMemTestTimeStamp = 0;
+
+    for( i = 0; i < count; i++ )
+    {
+        pBuffer = MEM_BufferAllocWithId(i % memMaxBlockSize + 1, 0, (void*)(uintptr_t)i);
+        TEST_ASSERT(MEM_SUCCESS_c == MEM_BufferFree(pBuffer));
+    }
+
+    pRecords = MemTest_TraceDump(&header);
+    TEST_ASSERT(NULL != pRecords);
+    TEST_ASSERT(2 * count == header.sequence);
+    TEST_ASSERT(MEM_TraceRingSize_c == header.recordCount);
+
+    for( i = 0; i < MEM_TraceRingSize_c; i++ )
+    {
+        TEST_ASSERT(pRecords[i].timeStamp == 2 * count - MEM_TraceRingSize_c + i + 1);
+        TEST_ASSERT(pRecords[i].op == ((i & 1) ? MEM_TRACE_FREE_c : MEM_TRACE_ALLOC_c));
+    }
+    TEST_ASSERT((count - 1) % memMaxBlockSize + 1 == pRecords[MEM_TraceRingSize_c - 2].size);
+
+    /* Recording resumes after the dump */
+    pBuffer = MEM_BufferAlloc(1);
+    TEST_ASSERT(MEM_SUCCESS_c == MEM_BufferFree(pBuffer));
+    TEST_ASSERT(2 * count + 2 == memTraceSequence);
+}
+#endif /*MEM_TRACE*/
+
+#ifdef MEM_TEST_COMPACT
+/* The blocks of a compact pool are packed with the size of their header as only
+   overhead, are all allocated once, and are not served to other pool Ids */
+static void MemTest_CompactDensity(void)
+{
+    void *pBuffers[40];
+    pools_t *pPool;
+    uint32_t stride, offset, i, j;
+
+    TEST_ASSERT(MEM_SUCCESS_c == MEM_Init());
+
+    for( i = 0; i < NumberOfElements(memPools); i++ )
+    {
+        pPool = &memPools[i];
+        if( !pPool->compact )
+        {
+            continue;
+        }
+
+        stride = pPool->blockSize + pPool->headerSize;
+        TEST_ASSERT(pPool->numBlocks == NumberOfElements(pBuffers));
+        TEST_ASSERT((uint32_t)(pPool->pHeapEnd - pPool->pHeapStart) == pPool->numBlocks * stride);
+        /* The default allocator is served from the other pools */
+        pBuffers[0] = MEM_BufferAlloc(pPool->blockSize);
+        TEST_ASSERT(NULL == MEM_GetCompactPool(pBuffers[0]));
+        TEST_ASSERT(MEM_SUCCESS_c == MEM_BufferFree(pBuffers[0]));
+
+        for( j = 0; j < pPool->numBlocks; j++ )
+        {
+            pBuffers[j] = MEM_BufferAllocWithId(pPool->blockSize, pPool->poolId, NULL);
+            TEST_ASSERT(NULL != pBuffers[j]);
+            offset = (uint8_t*)pBuffers[j] - pPool->pHeapStart;
+            TEST_ASSERT(offset == j * stride + pPool->headerSize);
+            TEST_ASSERT(MEM_BufferGetSize(pBuffers[j]) == pPool->blockSize);
+        }
+
+        TEST_ASSERT(NULL == MEM_BufferAllocWithId(1, pPool->poolId, NULL));
+        TEST_ASSERT(NULL == MEM_BufferAllocWithId(1, pPool->poolId | MEM_CriticalAllocFlag_c, NULL));
+        TEST_ASSERT(MEM_FREE_ERROR_c == MEM_BufferFree((uint8_t*)pBuffers[1] + 4));
+
+        TEST_ASSERT(MEM_SUCCESS_c == MEM_BufferFree(pBuffers[5]));
+        TEST_ASSERT(MEM_FREE_ERROR_c == MEM_BufferFree(pBuffers[5]));
+        TEST_ASSERT(MEM_FREE_ERROR_c == MEM_BufferRetain(pBuffers[5]));
+        TEST_ASSERT(pBuffers[5] == MEM_BufferAllocWithId(1, pPool->poolId, NULL));
+
+        TEST_ASSERT(MEM_SUCCESS_c == MEM_BufferRetain(pBuffers[7]));
+        TEST_ASSERT(MEM_SUCCESS_c == MEM_BufferFreeBatch(pBuffers, pPool->numBlocks));
+        TEST_ASSERT(pPool->numBlocks - 1 == pPool->numBlocks - pPool->allocatedBlocks);
+        TEST_ASSERT(MEM_SUCCESS_c == MEM_BufferFree(pBuffers[7]));
+        TEST_ASSERT(0 == pPool->allocatedBlocks);
+    }
+
+    TEST_ASSERT(gFreeMessagesCount == MEM_GetAvailableBlocks(0));
+}
+
+/* The 4 byte header detects an overflow of the previous block */
+static void MemTest_CompactOverflow(void)
+{
+    uint8_t *pFirst, *pSecond;
+
+    TEST_ASSERT(MEM_SUCCESS_c == MEM_Init());
+
+    pFirst = MEM_BufferAllocWithId(60, 2, NULL);
+    pSecond = MEM_BufferAllocWithId(60, 2, NULL);
+    TEST_ASSERT((NULL != pFirst) && (pSecond == pFirst + 60 + sizeof(compactHeader_t)));
+
+    pFirst[60] = ~pFirst[60];
+    TEST_ASSERT(MEM_FREE_ERROR_c == MEM_BufferFree(pSecond));
+    pFirst[60] = ~pFirst[60];
+    TEST_ASSERT(MEM_SUCCESS_c == MEM_BufferFree(pSecond));
+    TEST_ASSERT(MEM_SUCCESS_c == MEM_BufferFree(pFirst));
+}
+#endif /*MEM_TEST_COMPACT*/
+
+#ifdef MEM_TRACKING
+/* A block allocated for longer than the threshold is reported once by the check
+   that finds it, which takes several calls */
+static void MemTest_LeakCheck(void)
+{
+    uint32_t steps = (mTotalNoOfMsgs_c + MEM_CheckMemBufferBlocksPerCall_c - 1) /
+                     MEM_CheckMemBufferBlocksPerCall_c;
+    void *pLeak, *pBuffer;
+    uint32_t leakStep, i;
+
+    TEST_ASSERT(MEM_SUCCESS_c == MEM_Init());
+    TEST_ASSERT(steps > 1);
+    gHostTestPanicReturns = TRUE;
+    gHostTestPanicCount = 0;
+
+    /* The leak is in the last pool, the buffer freed in time in the first one.
+       The caller address of the host may look like the one of an allocation
+       that is never freed, so none is given. */
+    gMemTestTimeStamp = MEM_CheckMemBufferInterval_c;
+    pLeak = MEM_BufferAllocWithId(200, 0, NULL);
+    TEST_ASSERT(NULL != pLeak);
+    gMemTestTimeStamp += MEM_CheckMemBufferThreshold_c;
+    pBuffer = MEM_BufferAllocWithId(1, 0, NULL);
+    TEST_ASSERT(NULL != pBuffer);
+
+    for( i = 0; memTrack[i].blockAddr != pLeak; i++ )
+    {
+    }
+    leakStep = i / MEM_CheckMemBufferBlocksPerCall_c;
+    TEST_ASSERT((leakStep > 0) && (leakStep < steps - 1));
+
+    /* Each call reads the time stamp once, so no new check starts in the loop */
+    for( i = 0; i < 3 * steps; i++ )
+    {
+        MEM_CheckIfMemBuffersAreFreed();
+        TEST_ASSERT(0 == gHostTestIntDisableCount);
+        TEST_ASSERT((i < leakStep ? 0 : 1) == gHostTestPanicCount);
+    }
+
+    /* The next check reports it again, unlike the freed one */
+    gMemTestTimeStamp += MEM_CheckMemBufferInterval_c + MEM_CheckMemBufferThreshold_c;
+    TEST_ASSERT(MEM_SUCCESS_c == MEM_BufferFree(pBuffer));
+    for( i = 0; i < steps; i++ )
+    {
+        MEM_CheckIfMemBuffersAreFreed();
+    }
+    TEST_ASSERT(2 == gHostTestPanicCount);
+
+    gMemTestTimeStamp += MEM_CheckMemBufferInterval_c + MEM_CheckMemBufferThreshold_c;
+    TEST_ASSERT(MEM_SUCCESS_c == MEM_BufferFree(pLeak));
+    for( i = 0; i < steps; i++ )
+    {
+        MEM_CheckIfMemBuffersAreFreed();
+    }
+    TEST_ASSERT(2 == gHostTestPanicCount);
+    gHostTestPanicReturns = FALSE;
+}
+#endif /*MEM_TRACKING*/
+
+#ifdef MEM_TEST_COMPACT_ID0
+/* A compact pool with the default pool Id is rejected, and nothing is allocated */
+static void MemTest_CompactDefaultId(void)
+{
+    TEST_ASSERT(MEM_INIT_ERROR_c == MEM_Init());
+    TEST_ASSERT(NULL == MEM_BufferAlloc(1));
+    TEST_ASSERT(NULL == MEM_BufferAlloc(64));
+    TEST_ASSERT(NULL == MEM_BufferAllocCritical(1));
+    TEST_ASSERT(0 == MEM_GetAvailableBlocks(0));
+}
+#endif /*MEM_TEST_COMPACT_ID0*/
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public functions
+*************************************************************************************
+********************************************************************************** */
+int main(void)
+{
+#ifdef MEM_TEST_COMPACT_ID0
+    TEST_RUN(MemTest_CompactDefaultId);
+#else
+    TEST_RUN(MemTest_SizeClassLookup);
+    TEST_RUN(MemTest_SizeClassAlloc);
+    TEST_RUN(MemTest_AllocBatchFailure);
+    TEST_RUN(MemTest_InvalidFree);
+    TEST_RUN(MemTest_RefCount);
+#ifdef MEM_POOL_SPLITTING
+    TEST_RUN(MemTest_SplitAlloc);
+#endif
+#if defined(MEM_STATISTICS) && !defined(MEM_TEST_COMPACT)
+    TEST_RUN(MemTest_ReservedBlocks);
+    TEST_RUN(MemTest_PoolsReport);
+#endif
+#ifdef MEM_TRACE
+    TEST_RUN(MemTest_TraceRecords);
+    TEST_RUN(MemTest_TraceWrap);
+#endif
+#ifdef MEM_TEST_COMPACT
+    TEST_RUN(MemTest_CompactDensity);
+    TEST_RUN(MemTest_CompactOverflow);
+#endif
+#ifdef MEM_TRACKING
+    TEST_RUN(MemTest_LeakCheck);
+#endif
+#endif /*MEM_TEST_COMPACT_ID0*/
+
+    return HostTest_Result();
+}
@@ -0,0 +1,100 @@
+/*!
+* Copyright 2016-2017 NXP
+*
+* \file
+*
+* Memory pool layouts used by the MemManager host tests. The layout is selected
+* with one of the MEM_TEST_* defines and this file is included before any other.
+*
+* Redistribution and use in source and binary forms, with or without modification,
+* are permitted provided that the following conditions are met:
+*
+* o Redistributions of source code must retain the above copyright notice, this list
+*   of conditions and the following disclaimer.
+*
+* o Redistributions in binary form must reproduce the above copyright notice, this
+*   list of conditions and the following disclaimer in the documentation and/or
+*   other materials provided with the distribution.
+*
+* o Neither the name of Freescale Semiconductor, Inc. nor the names of its
+*   contributors may be used to endorse or promote products derived from this
+*   software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+* ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+* ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef _MEM_MANAGER_TEST_CONFIG_H_
+#define _MEM_MANAGER_TEST_CONFIG_H_
+
+#if defined(MEM_TEST_BENCH)
+/* Many pools, to measure the cost of the pool lookup */
+#define PoolsDetails_c \
+         _block_size_  16  _number_of_blocks_    4 _eol_  \
+         _block_size_  24  _number_of_blocks_    4 _eol_  \
+         _block_size_  32  _number_of_blocks_    4 _eol_  \
+         _block_size_  48  _number_of_blocks_    4 _eol_  \
+         _block_size_  64  _number_of_blocks_    4 _eol_  \
+         _block_size_  80  _number_of_blocks_    4 _eol_  \
+         _block_size_  96  _number_of_blocks_    4 _eol_  \
+         _block_size_ 128  _number_of_blocks_    4 _eol_  \
+         _block_size_ 160  _number_of_blocks_    4 _eol_  \
+         _block_size_ 192  _number_of_blocks_    4 _eol_  \
+         _block_size_ 256  _number_of_blocks_    4 _eol_  \
+         _block_size_ 320  _number_of_blocks_    4 _eol_  \
+         _block_size_ 384  _number_of_blocks_    4 _eol_  \
+         _block_size_ 512  _number_of_blocks_    4 _eol_  \
+         _block_size_  64  _number_of_blocks_    4 _pool_id_(1) _eol_  \
+         _block_size_ 256  _number_of_blocks_    4 _pool_id_(1) _eol_  \
+         _block_size_  64  _number_of_blocks_   64 _pool_id_(2) _eol_  \
+         _compact_block_size_(0) 64 _number_of_blocks_ 64 _pool_id_(3) _eol_  \
+         _compact_block_size_(4) 64 _number_of_blocks_ 64 _pool_id_(4) _eol_
+
+#elif defined(MEM_TEST_COMPACT)
+/* Compact pools with and without a block header, next to the default pools. The
+   second compact pool does not start at a bitmap word boundary. */
+#define PoolsDetails_c \
+         _block_size_  64  _number_of_blocks_    8 _eol_  \
+         _block_size_ 256  _number_of_blocks_    4 _eol_  \
+         _compact_block_size_(0) 32 _number_of_blocks_ 40 _pool_id_(1) _eol_  \
+         _compact_block_size_(4) 60 _number_of_blocks_ 40 _pool_id_(2) _eol_
+
+#define MEM_STATISTICS
+
+#elif defined(MEM_TEST_COMPACT_ID0)
+/* Invalid layout: a compact pool used by the default allocator */
+#define PoolsDetails_c \
+         _compact_block_size_(0) 32 _number_of_blocks_ 8 _eol_  \
+         _block_size_  64  _number_of_blocks_    8 _eol_
+
+#elif defined(MEM_TEST_TRACKING)
+/* Layout of the connectivity test application, with the leak check */
+#define PoolsDetails_c \
+         _block_size_  64  _number_of_blocks_   10 _reserved_blocks_(2) _eol_  \
+         _block_size_ 128  _number_of_blocks_    2 _eol_  \
+         _block_size_ 256  _number_of_blocks_   10 _reserved_blocks_(1) _eol_
+
+#define MEM_TRACKING
+
+#else
+/* Same layout as the connectivity test application */
+#define PoolsDetails_c \
+         _block_size_  64  _number_of_blocks_   10 _reserved_blocks_(2) _eol_  \
+         _block_size_ 128  _number_of_blocks_    2 _eol_  \
+         _block_size_ 256  _number_of_blocks_   10 _reserved_blocks_(1) _eol_
+
+#define MEM_POOL_SPLITTING 1
+#define MEM_STATISTICS
+#define MEM_TRACE
+#endif
+
+#endif /* _MEM_MANAGER_TEST_CONFIG_H_ */
@@ -0,0 +1,324 @@
+/*!
+* Copyright 2016-2017 NXP
+*
+* \file
+*
+* Host tests of the PHY timer, run on the virtual event timer of its host backend.
+*
+* Redistribution and use in source and binary forms, with or without modification,
+* are permitted provided that the following conditions are met:
+*
+* o Redistributions of source code must retain the above copyright notice, this list
+*   of conditions and the following disclaimer.
+*
+* o Redistributions in binary form must reproduce the above copyright notice, this
+*   list of conditions and the following disclaimer in the documentation and/or
+*   other materials provided with the distribution.
+*
+* o Neither the name of Freescale Semiconductor, Inc. nor the names of its
+*   contributors may be used to endorse or promote products derived from this
+*   software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+* ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+* ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+
+/*! *********************************************************************************
+*************************************************************************************
+* Include
+*************************************************************************************
+********************************************************************************** */
+#include <stdlib.h>
+
+#include "HostTest.h"
+#include "PhyTime.c"
+
+/*! *********************************************************************************
+*************************************************************************************
+* Private macros
+*************************************************************************************
+********************************************************************************** */
+/* Long enough for the 24 bit event timer to wrap twice */
+#define mPhyTestIterations_c    4000000
+#define mPhyTestMaxStep_c       20   /* symbols */
+#define mPhyTestEvents_c        3
+#define mPhyTestUsPeriod_c      1000 /* microseconds */
+
+#if gPhyTimeDeferredQueueSize_c
+/* One more event than the free timer slots, so the ring of deferred events overflows */
+#define mPhyTestDeferredEvents_c    (gMaxPhyTimers_c - 1)
+#define mPhyTestDeferredSpacing_c   100  /* symbols */
+#endif
+
+/*! *********************************************************************************
+*************************************************************************************
+* Private type definitions
+*************************************************************************************
+********************************************************************************** */
+typedef struct phyTestEvent_tag
+{
+    phyTimeTimerId_t  timerId;
+    bool_t            active;
+    phyTime_t         deadline;  /* symbols for the events, microseconds for the us timers */
+}phyTestEvent_t;
+
+/*! *********************************************************************************
+*************************************************************************************
+* Private memory declarations
+*************************************************************************************
+********************************************************************************** */
+static phyTestEvent_t maPhyTestEvents[mPhyTestEvents_c];
+static phyTestEvent_t mPhyTestUsTimer;
+static uint32_t mPhyTestFired;
+static uint32_t mPhyTestEarly;
+static uint32_t mPhyTestLate;
+static uint32_t mPhyTestStopped;
+
+#if gPhyTimeDeferredQueueSize_c
+/* Parameters of the deferred callbacks, in the order they ran */
+static uint32_t maPhyTestRunOrder[mPhyTestDeferredEvents_c];
+static uint32_t mPhyTestRunCount;
+extern uint32_t gPhyTestEventsPending;
+#endif
+
+/*! *********************************************************************************
+*************************************************************************************
+* Private functions
+*************************************************************************************
+********************************************************************************** */
+/* Events closer than the setup time of the event timer are run at once, so an
+   event may run up to gPhyTimeMinSetupTime_c symbols early, but never late */
+static void PhyTest_EventCallback(uint32_t param)
+{
+    phyTestEvent_t *pEvent = &maPhyTestEvents[param];
+    phyTime_t now = PhyTime_GetTimestamp();
+
+    mPhyTestFired++;
+
+    if( !pEvent->active )
+    {
+        mPhyTestStopped++;
+        return;
+    }
+
+    if( now + gPhyTimeMinSetupTime_c < pEvent->deadline )
+    {
+        mPhyTestEarly++;
+    }
+    else if( now > pEvent->deadline )
+    {
+        mPhyTestLate++;
+    }
+
+    pEvent->active = FALSE;
+}
+
+/* The us timers never expire early, and are late by less than one symbol */
+static void PhyTest_UsTimerCallback(uint32_t param)
+{
+    phyTime_t now = PhyTime_GetTimestamp() * gPhyTimeUsPerSymbol_c;
+
+    (void)param;
+    mPhyTestFired++;
+
+    if( now < mPhyTestUsTimer.deadline )
+    {
+        mPhyTestEarly++;
+    }
+    else if( now - mPhyTestUsTimer.deadline >= gPhyTimeUsPerSymbol_c )
+    {
+        mPhyTestLate++;
+    }
+
+    mPhyTestUsTimer.deadline += mPhyTestUsPeriod_c;
+}
+
+#if gPhyTimeDeferredQueueSize_c
+static void PhyTest_DeferredCallback(uint32_t param)
+{
+    if( mPhyTestRunCount < mPhyTestDeferredEvents_c )
+    {
+        maPhyTestRunOrder[mPhyTestRunCount] = param;
+    }
+
+    mPhyTestRunCount++;
+}
+
+static phyTimeTimerId_t PhyTest_ScheduleDeferred(phyTime_t timestamp, uint32_t param, bool_t deferred)
+{
+    phyTimeEvent_t event;
+
+    event.timestamp = timestamp;
+    event.callback = PhyTest_DeferredCallback;
+    event.parameter = param;
+    event.deferred = deferred;
+
+    return PhyTime_ScheduleEvent(&event);
+}
+#endif
+
+/*! *********************************************************************************
+*************************************************************************************
+* Test cases
+*************************************************************************************
+********************************************************************************** */
+/* Random events are scheduled and cancelled, next to a periodic us timer, while
+   the event timer wraps. The time stamp never goes back, and no callback runs
+   early or late. */
+static void PhyTest_EventsAcrossWrap(void)
+{
+    phyTimeEvent_t event;
+    phyTime_t start, previous, now;
+    uint32_t i, iteration;
+
+    srand(3);
+    TEST_ASSERT(gPhyTimeOk_c == PhyTime_TimerInit(NULL));
+
+    start = previous = PhyTime_GetTimestamp();
+
+    /* The deadline is counted from the next symbol boundary */
+    mPhyTestUsTimer.deadline = (start + 1) * gPhyTimeUsPerSymbol_c + mPhyTestUsPeriod_c;
+    mPhyTestUsTimer.timerId = PhyTime_StartUsTimer(mPhyTestUsPeriod_c, mPhyTestUsPeriod_c,
+                                                   PhyTest_UsTimerCallback, 0);
+    TEST_ASSERT(gInvalidTimerId_c != mPhyTestUsTimer.timerId);
+
+    for( iteration = 0; iteration < mPhyTestIterations_c; iteration++ )
+    {
+        now = PhyTime_GetTimestamp();
+        TEST_ASSERT(now >= previous);
+        previous = now;
+
+        for( i = 0; i < mPhyTestEvents_c; i++ )
+        {
+            if( !maPhyTestEvents[i].active && (0 == rand() % 20) )
+            {
+                event.timestamp = now + 1 + rand() % 3000;
+                event.callback = PhyTest_EventCallback;
+                event.parameter = i;
+                event.deferred = FALSE;
+                maPhyTestEvents[i].deadline = event.timestamp;
+                maPhyTestEvents[i].active = TRUE;
+                maPhyTestEvents[i].timerId = PhyTime_ScheduleEvent(&event);
+                TEST_ASSERT(gInvalidTimerId_c != maPhyTestEvents[i].timerId);
+            }
+        }
+
+        /* Cancel a pending event from time to time */
+        i = rand() % mPhyTestEvents_c;
+        if( maPhyTestEvents[i].active && (0 == rand() % 100) )
+        {
+            (void)PhyTime_CancelEvent(maPhyTestEvents[i].timerId);
+            maPhyTestEvents[i].active = FALSE;
+        }
+
+        PhyTime_HostAdvance(1 + rand() % mPhyTestMaxStep_c);
+    }
+
+    TEST_ASSERT(gPhyTimeOk_c == PhyTime_StopUsTimer(mPhyTestUsTimer.timerId));
+
+    for( i = 0; i < mPhyTestEvents_c; i++ )
+    {
+        if( maPhyTestEvents[i].active )
+        {
+            (void)PhyTime_CancelEvent(maPhyTestEvents[i].timerId);
+            maPhyTestEvents[i].active = FALSE;
+        }
+    }
+
+    TEST_ASSERT(previous - start > 2 * ((phyTime_t)1 << gPhyTimeShift_c));
+    TEST_ASSERT(mPhyTestFired > 100000);
+    TEST_ASSERT(0 == mPhyTestStopped);
+    TEST_ASSERT(0 == mPhyTestEarly);
+    TEST_ASSERT(0 == mPhyTestLate);
+}
+
+#if gPhyTimeDeferredQueueSize_c
+/* A deferred event is queued by the ISR and run by the PHY task. When the ring is
+   full, the callback is run from the ISR. The ring wraps over several rounds. */
+static void PhyTest_DeferredEvents(void)
+{
+    phyTime_t now;
+    uint32_t i, round;
+
+    TEST_ASSERT(gPhyTimeOk_c == PhyTime_TimerInit(NULL));
+    TEST_ASSERT(NULL != mPhyTaskEventId);
+
+    /* A single deferred event does not run from the ISR */
+    mPhyTestRunCount = 0;
+    gPhyTestEventsPending = 0;
+    TEST_ASSERT(gInvalidTimerId_c != PhyTest_ScheduleDeferred(PhyTime_GetTimestamp() + mPhyTestDeferredSpacing_c, 0, TRUE));
+    PhyTime_HostAdvance(2 * mPhyTestDeferredSpacing_c);
+    TEST_ASSERT(0 == mPhyTestRunCount);
+    TEST_ASSERT(1 == gPhyTestEventsPending);
+
+    PhyTime_Task(NULL);
+    TEST_ASSERT(1 == mPhyTestRunCount);
+    TEST_ASSERT(mPhyDeferredHead == mPhyDeferredTail);
+
+    /* An event which is not deferred still runs from the ISR */
+    mPhyTestRunCount = 0;
+    gPhyTestEventsPending = 0;
+    TEST_ASSERT(gInvalidTimerId_c != PhyTest_ScheduleDeferred(PhyTime_GetTimestamp() + mPhyTestDeferredSpacing_c, 0, FALSE));
+    PhyTime_HostAdvance(2 * mPhyTestDeferredSpacing_c);
+    TEST_ASSERT(1 == mPhyTestRunCount);
+    TEST_ASSERT(0 == gPhyTestEventsPending);
+
+    for( round = 0; round < 3; round++ )
+    {
+        mPhyTestRunCount = 0;
+        gPhyTestEventsPending = 0;
+        now = PhyTime_GetTimestamp();
+
+        for( i = 0; i < mPhyTestDeferredEvents_c; i++ )
+        {
+            TEST_ASSERT(gInvalidTimerId_c != PhyTest_ScheduleDeferred(now + (i + 1) * mPhyTestDeferredSpacing_c, i, TRUE));
+        }
+
+        PhyTime_HostAdvance((mPhyTestDeferredEvents_c + 1) * mPhyTestDeferredSpacing_c);
+
+        /* The events past the ring size ran from the ISR */
+        TEST_ASSERT(mPhyTestDeferredEvents_c - gPhyTimeDeferredQueueSize_c == mPhyTestRunCount);
+        TEST_ASSERT(gPhyTimeDeferredQueueSize_c == gPhyTestEventsPending);
+
+        for( i = 0; i < mPhyTestRunCount; i++ )
+        {
+            TEST_ASSERT(gPhyTimeDeferredQueueSize_c + i == maPhyTestRunOrder[i]);
+        }
+
+        /* The queued ones run from the task, in expiry order */
+        PhyTime_Task(NULL);
+        TEST_ASSERT(mPhyTestDeferredEvents_c == mPhyTestRunCount);
+        TEST_ASSERT(mPhyDeferredHead == mPhyDeferredTail);
+
+        for( i = 0; i < gPhyTimeDeferredQueueSize_c; i++ )
+        {
+            TEST_ASSERT(i == maPhyTestRunOrder[mPhyTestDeferredEvents_c - gPhyTimeDeferredQueueSize_c + i]);
+        }
+    }
+}
+#endif
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public functions
+*************************************************************************************
+********************************************************************************** */
+int main(void)
+{
+    TEST_RUN(PhyTest_EventsAcrossWrap);
+#if gPhyTimeDeferredQueueSize_c
+    TEST_RUN(PhyTest_DeferredEvents);
+#endif
+
+    return HostTest_Result();
+}
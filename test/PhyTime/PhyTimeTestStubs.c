@@ -0,0 +1,98 @@
+/*!
+* Copyright 2016-2017 NXP
+*
+* \file
+*
+* Stubs of the power manager and OS abstraction for the host builds of the PHY timer.
+*
+* Redistribution and use in source and binary forms, with or without modification,
+* are permitted provided that the following conditions are met:
+*
+* o Redistributions of source code must retain the above copyright notice, this list
+*   of conditions and the following disclaimer.
+*
+* o Redistributions in binary form must reproduce the above copyright notice, this
+*   list of conditions and the following disclaimer in the documentation and/or
+*   other materials provided with the distribution.
+*
+* o Neither the name of Freescale Semiconductor, Inc. nor the names of its
+*   contributors may be used to endorse or promote products derived from this
+*   software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+* ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+* ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+
+/*! *********************************************************************************
+*************************************************************************************
+* Include
+*************************************************************************************
+********************************************************************************** */
+#include "EmbeddedTypes.h"
+#include "fsl_os_abstraction.h"
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public memory declarations
+*************************************************************************************
+********************************************************************************** */
+/* The PHY task runs once per call, as on bare metal */
+const uint8_t gUseRtos_c = 0;
+
+/* Number of OSA_EventSet() calls not yet handled by the test */
+uint32_t gPhyTestEventsPending;
+
+/*! *********************************************************************************
+*************************************************************************************
+* Stubs
+*************************************************************************************
+********************************************************************************** */
+osaEventId_t OSA_EventCreate(bool_t autoClear)
+{
+    (void)autoClear;
+    return (osaEventId_t)1;
+}
+
+osaStatus_t OSA_EventSet(osaEventId_t eventId, osaEventFlags_t flagsToSet)
+{
+    (void)eventId;
+    (void)flagsToSet;
+    gPhyTestEventsPending++;
+    return osaStatus_Success;
+}
+
+osaStatus_t OSA_EventWait(osaEventId_t eventId, osaEventFlags_t flagsToWait, bool_t waitAll,
+                          uint32_t millisec, osaEventFlags_t *pSetFlags)
+{
+    (void)eventId;
+    (void)waitAll;
+    (void)millisec;
+    *pSetFlags = flagsToWait;
+    return osaStatus_Success;
+}
+
+/* The test runs the task itself */
+osaTaskId_t OSA_TaskCreate(osaThreadDef_t *thread_def, osaTaskParam_t task_param)
+{
+    (void)thread_def;
+    (void)task_param;
+    return (osaTaskId_t)1;
+}
+
+void PWR_DisallowXcvrToSleep(void)
+{
+}
+
+void PWR_AllowXcvrToSleep(void)
+{
+}
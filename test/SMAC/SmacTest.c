@@ -0,0 +1,599 @@
+/*!
+* Copyright 2016-2017 NXP
+*
+* \file
+*
+* Host tests of SMAC, on top of a stub PHY. The tests drive SMAC like the PHY does,
+* by calling its SAP handlers, and play the application.
+*
+* Redistribution and use in source and binary forms, with or without modification,
+* are permitted provided that the following conditions are met:
+*
+* o Redistributions of source code must retain the above copyright notice, this list
+*   of conditions and the following disclaimer.
+*
+* o Redistributions in binary form must reproduce the above copyright notice, this
+*   list of conditions and the following disclaimer in the documentation and/or
+*   other materials provided with the distribution.
+*
+* o Neither the name of Freescale Semiconductor, Inc. nor the names of its
+*   contributors may be used to endorse or promote products derived from this
+*   software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+* ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+* ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+
+
+/*! *********************************************************************************
+*************************************************************************************
+* Include
+*************************************************************************************
+********************************************************************************** */
+#include "HostTest.h"
+#include "SMAC.c"
+
+/*! *********************************************************************************
+*************************************************************************************
+* Private macros
+*************************************************************************************
+********************************************************************************** */
+#define mSmacTestMaxMsgs_c      16
+#define mSmacTestPayload_c      10  /* bytes */
+#define mSmacTestRxRingSize_c   3
+#define mSmacTestMaxBlocks_c    128
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public memory declarations
+*************************************************************************************
+********************************************************************************** */
+extern uint8_t gSmacTestPdIds[];
+extern uint32_t gSmacTestPdCount;
+extern uint32_t gSmacTestPdRefusals;
+extern uint32_t gSmacTestPlmeCount;
+
+/*! *********************************************************************************
+*************************************************************************************
+* Private memory declarations
+*************************************************************************************
+********************************************************************************** */
+/* Data confirms received by the application, in order */
+static smacErrors_t maSmacTestCnfStatus[mSmacTestMaxMsgs_c];
+static uint32_t mSmacTestCnfCount;
+
+/* Buffers of the continuous reception, and the packets indicated to the application */
+static uint8_t maSmacTestRxBuffers[mSmacTestRxRingSize_c][sizeof(rxPacket_t) + mSmacTestPayload_c];
+static rxPacket_t *maSmacTestRxRing[mSmacTestRxRingSize_c];
+static rxPacket_t *maSmacTestIndPackets[mSmacTestMaxMsgs_c];
+static smacToAppDataMessage_t *maSmacTestIndMsgs[mSmacTestMaxMsgs_c];
+static uint32_t mSmacTestIndCount;
+
+/* If set, the application keeps the data indications instead of freeing them */
+static bool_t mSmacTestKeepInd;
+
+/* The PHY message of the last indication */
+static pdDataToMacMessage_t *mpSmacTestPdInd;
+
+/* Free MemManager blocks after the reset of a test case */
+static uint32_t mSmacTestFreeBlocks;
+
+/*! *********************************************************************************
+*************************************************************************************
+* Private functions
+*************************************************************************************
+********************************************************************************** */
+/* The application frees every message it gets, unless it keeps the indications */
+static smacErrors_t SmacTest_McpsHandler(smacToAppDataMessage_t *pMsg, instanceId_t instance)
+{
+    (void)instance;
+
+    if( (gMcpsDataCnf_c == pMsg->msgType) && (mSmacTestCnfCount < mSmacTestMaxMsgs_c) )
+    {
+        maSmacTestCnfStatus[mSmacTestCnfCount++] = pMsg->msgData.dataCnf.status;
+    }
+    else if( (gMcpsDataInd_c == pMsg->msgType) && (mSmacTestIndCount < mSmacTestMaxMsgs_c) )
+    {
+        maSmacTestIndMsgs[mSmacTestIndCount] = pMsg;
+        maSmacTestIndPackets[mSmacTestIndCount++] = pMsg->msgData.dataInd.pRxPacket;
+
+        if( mSmacTestKeepInd )
+        {
+            return gErrorNoError_c;
+        }
+    }
+
+    (void)MEM_BufferFree(pMsg);
+    return gErrorNoError_c;
+}
+
+static smacErrors_t SmacTest_MlmeHandler(smacToAppMlmeMessage_t *pMsg, instanceId_t instance)
+{
+    (void)instance;
+    (void)MEM_BufferFree(pMsg);
+    return gErrorNoError_c;
+}
+
+static void SmacTest_Reset(void)
+{
+    (void)MEM_Init();
+    FLib_MemSet(maSmacAttributes, 0, sizeof(maSmacAttributes));
+    InitSmac();
+    Smac_RegisterSapHandlers(SmacTest_McpsHandler, SmacTest_MlmeHandler, 0);
+
+    gSmacTestPdCount = 0;
+    gSmacTestPdRefusals = 0;
+    gSmacTestPlmeCount = 0;
+    mSmacTestCnfCount = 0;
+    mSmacTestIndCount = 0;
+    mSmacTestKeepInd = FALSE;
+    mSmacTestFreeBlocks = MEM_GetAvailableBlocks(0);
+}
+
+/* Sends a packet whose first payload byte is its Id */
+static smacErrors_t SmacTest_Send(uint8_t id)
+{
+    uint8_t buffer[sizeof(txPacket_t) + mSmacTestPayload_c];
+    txPacket_t *pPacket = (txPacket_t*)buffer;
+
+    SMACFillHeader(&pPacket->smacHeader, 0x1234);
+    pPacket->u8DataLength = mSmacTestPayload_c;
+    FLib_MemSet(pPacket->smacPdu.smacPdu, id, mSmacTestPayload_c);
+
+    return MCPSDataRequest(pPacket);
+}
+
+/* The PHY confirms the packet under transmission */
+static void SmacTest_PdConfirm(void)
+{
+    pdDataToMacMessage_t *pMsg = MEM_BufferAlloc(sizeof(pdDataToMacMessage_t));
+
+    pMsg->msgType = gPdDataCnf_c;
+    pMsg->msgData.dataCnf.status = gPhySuccess_c;
+    (void)PD_SMAC_SapHandler(pMsg, 0);
+}
+
+/* The PHY indicates a packet whose payload bytes are its Id. A packet which is not
+   a SMAC data frame fails the packet check. The buffer is laid out like the PHY does. */
+static void SmacTest_PdIndication(uint8_t id, bool_t smacFrame)
+{
+    uint8_t len = gSmacHeaderBytes_c + mSmacTestPayload_c;
+    pdDataToMacMessage_t *pMsg = MEM_BufferAlloc(sizeof(pdDataToMacMessage_t) + gPhyRxBufferHeadroom_c + len);
+    smacHeader_t header;
+
+    pMsg->msgType = gPdDataInd_c;
+    pMsg->msgData.dataInd.timeStamp = 0;
+    pMsg->msgData.dataInd.ppduLinkQuality = 0;
+    pMsg->msgData.dataInd.psduLength = len;
+    pMsg->msgData.dataInd.pPsdu = (uint8_t*)&pMsg->msgData.dataInd.pPsdu +
+                                  sizeof(pMsg->msgData.dataInd.pPsdu) + gPhyRxBufferHeadroom_c;
+
+    SMACFillHeader(&header, 0x1234);
+    FLib_MemCpy(pMsg->msgData.dataInd.pPsdu, &header, gSmacHeaderBytes_c);
+    FLib_MemSet(pMsg->msgData.dataInd.pPsdu + gSmacHeaderBytes_c, id, mSmacTestPayload_c);
+
+    if( !smacFrame )
+    {
+        /* Not a data frame */
+        pMsg->msgData.dataInd.pPsdu[0] = 0x02;
+    }
+
+    mpSmacTestPdInd = pMsg;
+    (void)PD_SMAC_SapHandler(pMsg, 0);
+}
+
+/* Acquires a packet and builds it in place, with its Id as payload */
+static txPacket_t* SmacTest_Acquire(uint8_t id)
+{
+    txPacket_t *pPacket = MCPSDataAcquire(mSmacTestPayload_c);
+
+    if( NULL != pPacket )
+    {
+        SMACFillHeader(&pPacket->smacHeader, 0x1234);
+        pPacket->u8DataLength = mSmacTestPayload_c;
+        FLib_MemSet(pPacket->smacPdu.smacPdu, id, mSmacTestPayload_c);
+    }
+
+    return pPacket;
+}
+
+static smacErrors_t SmacTest_StartContinuousRx(void)
+{
+    uint8_t i;
+
+    for( i = 0; i < mSmacTestRxRingSize_c; i++ )
+    {
+        maSmacTestRxRing[i] = (rxPacket_t*)maSmacTestRxBuffers[i];
+        maSmacTestRxRing[i]->u8MaxDataLength = mSmacTestPayload_c;
+    }
+
+    return MLMERXEnableContinuousRequest(maSmacTestRxRing, mSmacTestRxRingSize_c);
+}
+
+/*! *********************************************************************************
+*************************************************************************************
+* Test cases
+*************************************************************************************
+********************************************************************************** */
+/* gSmacTxQueueSize_c packets are queued behind the one under transmission. The
+   next one is rejected with gErrorBusy_c, and is not confirmed. */
+static void SmacTest_TxQueueFull(void)
+{
+    uint8_t i;
+
+    SmacTest_Reset();
+
+    for( i = 0; i <= gSmacTxQueueSize_c; i++ )
+    {
+        TEST_ASSERT(gErrorNoError_c == SmacTest_Send(i));
+    }
+
+    TEST_ASSERT(1 == gSmacTestPdCount);
+    TEST_ASSERT(gSmacTxQueueSize_c == maSmacAttributes[0].u8TxQueueCount);
+    TEST_ASSERT(gErrorBusy_c == SmacTest_Send(i));
+
+    for( i = 0; i <= gSmacTxQueueSize_c; i++ )
+    {
+        SmacTest_PdConfirm();
+    }
+
+    TEST_ASSERT(gSmacTxQueueSize_c + 1 == mSmacTestCnfCount);
+    TEST_ASSERT(mSmacStateIdle_c == maSmacAttributes[0].smacState);
+    TEST_ASSERT(mSmacTestFreeBlocks == MEM_GetAvailableBlocks(0));
+}
+
+/* The queued packets go to the PHY one at a time, in the order of the requests,
+   and each one gets its own confirm */
+static void SmacTest_TxQueueOrder(void)
+{
+    uint8_t i;
+
+    SmacTest_Reset();
+
+    for( i = 0; i <= gSmacTxQueueSize_c; i++ )
+    {
+        TEST_ASSERT(gErrorNoError_c == SmacTest_Send(i));
+    }
+
+    for( i = 0; i <= gSmacTxQueueSize_c; i++ )
+    {
+        TEST_ASSERT(i + 1 == gSmacTestPdCount);
+        TEST_ASSERT(i == gSmacTestPdIds[i]);
+        TEST_ASSERT(i == mSmacTestCnfCount);
+        SmacTest_PdConfirm();
+        TEST_ASSERT(gErrorNoError_c == maSmacTestCnfStatus[i]);
+    }
+
+    /* A packet sent from idle goes to the PHY at once */
+    TEST_ASSERT(gErrorNoError_c == SmacTest_Send(0x55));
+    TEST_ASSERT(0x55 == gSmacTestPdIds[gSmacTestPdCount - 1]);
+    SmacTest_PdConfirm();
+    TEST_ASSERT(mSmacStateIdle_c == maSmacAttributes[0].smacState);
+    TEST_ASSERT(mSmacTestFreeBlocks == MEM_GetAvailableBlocks(0));
+}
+
+/* A packet refused by the PHY is rejected if it was sent at once. If it was
+   queued, it is confirmed with gErrorNoResourcesAvailable_c and the next queued
+   packet is sent. */
+static void SmacTest_TxPhyRefusal(void)
+{
+    SmacTest_Reset();
+
+    gSmacTestPdRefusals = 1;
+    TEST_ASSERT(gErrorNoResourcesAvailable_c == SmacTest_Send(0));
+    TEST_ASSERT(0 == mSmacTestCnfCount);
+    TEST_ASSERT(mSmacStateIdle_c == maSmacAttributes[0].smacState);
+    TEST_ASSERT(mSmacTestFreeBlocks == MEM_GetAvailableBlocks(0));
+
+    gSmacTestPdCount = 0;
+    TEST_ASSERT(gErrorNoError_c == SmacTest_Send(1));
+    TEST_ASSERT(gErrorNoError_c == SmacTest_Send(2));
+    TEST_ASSERT(gErrorNoError_c == SmacTest_Send(3));
+
+    /* Packet 2 is refused when packet 1 is done */
+    gSmacTestPdRefusals = 1;
+    SmacTest_PdConfirm();
+    TEST_ASSERT(3 == gSmacTestPdCount);
+    TEST_ASSERT(3 == gSmacTestPdIds[2]);
+    TEST_ASSERT(2 == mSmacTestCnfCount);
+    TEST_ASSERT(gErrorNoError_c == maSmacTestCnfStatus[0]);
+    TEST_ASSERT(gErrorNoResourcesAvailable_c == maSmacTestCnfStatus[1]);
+
+    SmacTest_PdConfirm();
+    TEST_ASSERT(3 == mSmacTestCnfCount);
+    TEST_ASSERT(gErrorNoError_c == maSmacTestCnfStatus[2]);
+    TEST_ASSERT(mSmacStateIdle_c == maSmacAttributes[0].smacState);
+    TEST_ASSERT(mSmacTestFreeBlocks == MEM_GetAvailableBlocks(0));
+}
+
+/* Once MLMETXDisableRequest has dropped the packet under transmission, a late
+   attempt to send it ends without a second confirm */
+static void SmacTest_TxDisable(void)
+{
+    SmacTest_Reset();
+
+    TEST_ASSERT(gErrorNoError_c == SmacTest_Send(0));
+    TEST_ASSERT(gErrorNoError_c == SmacTest_Send(1));
+    MLMETXDisableRequest();
+    TEST_ASSERT(1 == mSmacTestCnfCount);
+    TEST_ASSERT(gErrorNoResourcesAvailable_c == maSmacTestCnfStatus[0]);
+
+    /* The CCA backoff of the dropped packet expires */
+    BackoffTimeElapsed((void*)0);
+    TEST_ASSERT(1 == mSmacTestCnfCount);
+    TEST_ASSERT(mSmacStateIdle_c == maSmacAttributes[0].smacState);
+    TEST_ASSERT(mSmacTestFreeBlocks == MEM_GetAvailableBlocks(0));
+}
+
+/* The packets are stored in the buffers of the ring in turn, and the ring wraps
+   over the buffers released by the application */
+static void SmacTest_RxRingWrap(void)
+{
+    uint8_t i;
+
+    SmacTest_Reset();
+    TEST_ASSERT(gErrorNoError_c == SmacTest_StartContinuousRx());
+
+    for( i = 0; i < 2 * mSmacTestRxRingSize_c + 1; i++ )
+    {
+        SmacTest_PdIndication(i, TRUE);
+        TEST_ASSERT(i + 1 == mSmacTestIndCount);
+        TEST_ASSERT(maSmacTestRxRing[i % mSmacTestRxRingSize_c] == maSmacTestIndPackets[i]);
+        TEST_ASSERT(rxSuccessStatus_c == maSmacTestIndPackets[i]->rxStatus);
+        TEST_ASSERT(mSmacTestPayload_c == maSmacTestIndPackets[i]->u8DataLength);
+        TEST_ASSERT(i == maSmacTestIndPackets[i]->smacPdu.smacPdu[0]);
+        MLMERXContinuousRelease(maSmacTestIndPackets[i]);
+    }
+
+    TEST_ASSERT(0 == MLMERXContinuousDropCount());
+    TEST_ASSERT(mSmacStateReceiving_c == maSmacAttributes[0].smacState);
+    TEST_ASSERT(gErrorNoError_c == MLMERXDisableRequest());
+    TEST_ASSERT(mSmacTestFreeBlocks == MEM_GetAvailableBlocks(0));
+}
+
+/* While no buffer is free, the SMAC packets are dropped and counted. The other
+   frames are not counted. A released buffer takes the next packet. */
+static void SmacTest_RxRingDrops(void)
+{
+    uint8_t i;
+
+    SmacTest_Reset();
+    TEST_ASSERT(gErrorNoError_c == SmacTest_StartContinuousRx());
+
+    for( i = 0; i < mSmacTestRxRingSize_c; i++ )
+    {
+        SmacTest_PdIndication(i, TRUE);
+    }
+
+    TEST_ASSERT(mSmacTestRxRingSize_c == mSmacTestIndCount);
+
+    SmacTest_PdIndication(0x10, TRUE);
+    SmacTest_PdIndication(0x11, FALSE);
+    SmacTest_PdIndication(0x12, TRUE);
+    TEST_ASSERT(mSmacTestRxRingSize_c == mSmacTestIndCount);
+    TEST_ASSERT(2 == MLMERXContinuousDropCount());
+
+    /* The packets are not written to the buffers held by the application */
+    for( i = 0; i < mSmacTestRxRingSize_c; i++ )
+    {
+        TEST_ASSERT(i == maSmacTestRxRing[i]->smacPdu.smacPdu[0]);
+    }
+
+    /* The buffers are used in ring order: a released buffer which is not the next
+       one does not take the packet */
+    MLMERXContinuousRelease(maSmacTestRxRing[1]);
+    SmacTest_PdIndication(0x13, TRUE);
+    TEST_ASSERT(3 == MLMERXContinuousDropCount());
+
+    MLMERXContinuousRelease(maSmacTestRxRing[0]);
+    SmacTest_PdIndication(0x14, TRUE);
+    TEST_ASSERT(mSmacTestRxRingSize_c + 1 == mSmacTestIndCount);
+    TEST_ASSERT(maSmacTestRxRing[0] == maSmacTestIndPackets[mSmacTestRxRingSize_c]);
+    TEST_ASSERT(0x14 == maSmacTestRxRing[0]->smacPdu.smacPdu[0]);
+    TEST_ASSERT(3 == MLMERXContinuousDropCount());
+
+    /* A new reception clears the count */
+    TEST_ASSERT(gErrorNoError_c == MLMERXDisableRequest());
+    TEST_ASSERT(gErrorNoError_c == SmacTest_StartContinuousRx());
+    TEST_ASSERT(0 == MLMERXContinuousDropCount());
+    TEST_ASSERT(gErrorNoError_c == MLMERXDisableRequest());
+    TEST_ASSERT(mSmacTestFreeBlocks == MEM_GetAvailableBlocks(0));
+}
+
+/* A packet received with the zero-copy reception is indicated in the PHY message,
+   which the application frees. SMAC does not free it. */
+static void SmacTest_RxZeroCopySuccess(void)
+{
+    rxPacket_t *pPacket;
+    smacHeader_t header;
+
+    SmacTest_Reset();
+    mSmacTestKeepInd = TRUE;
+    TEST_ASSERT(gErrorNoError_c == MLMERXEnableZeroCopyRequest(0));
+
+    SmacTest_PdIndication(0x21, TRUE);
+    TEST_ASSERT(1 == mSmacTestIndCount);
+    TEST_ASSERT((void*)mpSmacTestPdInd == (void*)maSmacTestIndMsgs[0]);
+    TEST_ASSERT(mSmacStateIdle_c == maSmacAttributes[0].smacState);
+
+    pPacket = maSmacTestIndPackets[0];
+    SMACFillHeader(&header, 0x1234);
+    TEST_ASSERT(rxSuccessStatus_c == pPacket->rxStatus);
+    TEST_ASSERT(mSmacTestPayload_c == pPacket->u8DataLength);
+    TEST_ASSERT(FLib_MemCmp(&pPacket->smacHeader, &header, gSmacHeaderBytes_c));
+    TEST_ASSERT(0x21 == pPacket->smacPdu.smacPdu[0]);
+    TEST_ASSERT(0x21 == pPacket->smacPdu.smacPdu[mSmacTestPayload_c - 1]);
+
+    /* The buffer is still held by the application */
+    TEST_ASSERT(mSmacTestFreeBlocks == MEM_GetAvailableBlocks(0) + 1);
+    TEST_ASSERT(MEM_SUCCESS_c == MEM_BufferFree(maSmacTestIndMsgs[0]));
+    TEST_ASSERT(mSmacTestFreeBlocks == MEM_GetAvailableBlocks(0));
+}
+
+/* When the reception times out on a frame which fails the packet check, the PHY
+   message carries the aborted indication to the application, which frees it. Without
+   a timeout, the frame is freed by SMAC and the reception goes on. */
+static void SmacTest_RxZeroCopyAbort(void)
+{
+    SmacTest_Reset();
+    mSmacTestKeepInd = TRUE;
+    TEST_ASSERT(gErrorNoError_c == MLMERXEnableZeroCopyRequest(1000));
+
+    SmacTest_PdIndication(0x22, FALSE);
+    TEST_ASSERT(1 == mSmacTestIndCount);
+    TEST_ASSERT((void*)mpSmacTestPdInd == (void*)maSmacTestIndMsgs[0]);
+    TEST_ASSERT(rxAbortedStatus_c == maSmacTestIndPackets[0]->rxStatus);
+    TEST_ASSERT(0 == maSmacTestIndPackets[0]->u8DataLength);
+    TEST_ASSERT(mSmacStateIdle_c == maSmacAttributes[0].smacState);
+
+    TEST_ASSERT(mSmacTestFreeBlocks == MEM_GetAvailableBlocks(0) + 1);
+    TEST_ASSERT(MEM_SUCCESS_c == MEM_BufferFree(maSmacTestIndMsgs[0]));
+    TEST_ASSERT(mSmacTestFreeBlocks == MEM_GetAvailableBlocks(0));
+
+    TEST_ASSERT(gErrorNoError_c == MLMERXEnableZeroCopyRequest(0));
+    SmacTest_PdIndication(0x23, FALSE);
+    TEST_ASSERT(1 == mSmacTestIndCount);
+    TEST_ASSERT(mSmacStateReceiving_c == maSmacAttributes[0].smacState);
+    TEST_ASSERT(mSmacTestFreeBlocks == MEM_GetAvailableBlocks(0));
+    TEST_ASSERT(gErrorNoError_c == MLMERXDisableRequest());
+}
+
+/* An acquired packet holds its message and its data confirm. It is sent by the
+   commit, and confirmed like any other packet. */
+static void SmacTest_TxAcquireCommit(void)
+{
+    txPacket_t *pPacket;
+
+    SmacTest_Reset();
+
+    pPacket = SmacTest_Acquire(0x31);
+    TEST_ASSERT(NULL != pPacket);
+    TEST_ASSERT(mSmacTestFreeBlocks == MEM_GetAvailableBlocks(0) + 2);
+    TEST_ASSERT(gErrorNoError_c == MCPSDataCommit(pPacket));
+    TEST_ASSERT(1 == gSmacTestPdCount);
+    TEST_ASSERT(0x31 == gSmacTestPdIds[0]);
+
+    /* Queued behind the first one */
+    pPacket = SmacTest_Acquire(0x32);
+    TEST_ASSERT(NULL != pPacket);
+    TEST_ASSERT(gErrorNoError_c == MCPSDataCommit(pPacket));
+
+    SmacTest_PdConfirm();
+    TEST_ASSERT(2 == gSmacTestPdCount);
+    TEST_ASSERT(0x32 == gSmacTestPdIds[1]);
+    SmacTest_PdConfirm();
+    TEST_ASSERT(2 == mSmacTestCnfCount);
+    TEST_ASSERT(gErrorNoError_c == maSmacTestCnfStatus[0]);
+    TEST_ASSERT(gErrorNoError_c == maSmacTestCnfStatus[1]);
+    TEST_ASSERT(mSmacStateIdle_c == maSmacAttributes[0].smacState);
+    TEST_ASSERT(mSmacTestFreeBlocks == MEM_GetAvailableBlocks(0));
+}
+
+/* The commit does not allocate memory, so it succeeds while the pools are empty */
+static void SmacTest_TxCommitNoMemory(void)
+{
+    void *pBlocks[mSmacTestMaxBlocks_c];
+    txPacket_t *pPacket;
+    uint32_t count = 0;
+    uint32_t i;
+
+    SmacTest_Reset();
+
+    pPacket = SmacTest_Acquire(0x33);
+    TEST_ASSERT(NULL != pPacket);
+
+    while( (count < mSmacTestMaxBlocks_c) && (NULL != (pBlocks[count] = MEM_BufferAlloc(1))) )
+    {
+        count++;
+    }
+
+    TEST_ASSERT(count < mSmacTestMaxBlocks_c);
+    TEST_ASSERT(NULL == MCPSDataAcquire(mSmacTestPayload_c));
+    TEST_ASSERT(gErrorNoError_c == MCPSDataCommit(pPacket));
+    TEST_ASSERT(1 == gSmacTestPdCount);
+
+    for( i = 0; i < count; i++ )
+    {
+        (void)MEM_BufferFree(pBlocks[i]);
+    }
+
+    SmacTest_PdConfirm();
+    TEST_ASSERT(1 == mSmacTestCnfCount);
+    TEST_ASSERT(gErrorNoError_c == maSmacTestCnfStatus[0]);
+    TEST_ASSERT(mSmacTestFreeBlocks == MEM_GetAvailableBlocks(0));
+}
+
+/* A packet which is rejected with gErrorBusy_c still belongs to the application,
+   which can release it. A released packet frees its data confirm too. */
+static void SmacTest_TxAcquireRelease(void)
+{
+    txPacket_t *pPacket;
+    uint8_t i;
+
+    SmacTest_Reset();
+
+    pPacket = SmacTest_Acquire(0x34);
+    TEST_ASSERT(NULL != pPacket);
+    MCPSDataRelease(pPacket);
+    TEST_ASSERT(mSmacTestFreeBlocks == MEM_GetAvailableBlocks(0));
+
+    for( i = 0; i <= gSmacTxQueueSize_c; i++ )
+    {
+        TEST_ASSERT(gErrorNoError_c == SmacTest_Send(i));
+    }
+
+    pPacket = SmacTest_Acquire(0x35);
+    TEST_ASSERT(NULL != pPacket);
+    TEST_ASSERT(gErrorBusy_c == MCPSDataCommit(pPacket));
+
+    /* Committed again once there is room in the queue */
+    SmacTest_PdConfirm();
+    TEST_ASSERT(gErrorNoError_c == MCPSDataCommit(pPacket));
+
+    pPacket = SmacTest_Acquire(0x36);
+    TEST_ASSERT(NULL != pPacket);
+    TEST_ASSERT(gErrorBusy_c == MCPSDataCommit(pPacket));
+    MCPSDataRelease(pPacket);
+
+    for( i = 0; i <= gSmacTxQueueSize_c; i++ )
+    {
+        SmacTest_PdConfirm();
+    }
+
+    TEST_ASSERT(0x35 == gSmacTestPdIds[gSmacTestPdCount - 1]);
+    TEST_ASSERT(gSmacTxQueueSize_c + 2 == mSmacTestCnfCount);
+    TEST_ASSERT(mSmacStateIdle_c == maSmacAttributes[0].smacState);
+    TEST_ASSERT(mSmacTestFreeBlocks == MEM_GetAvailableBlocks(0));
+}
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public functions
+*************************************************************************************
+********************************************************************************** */
+int main(void)
+{
+    TEST_RUN(SmacTest_TxQueueFull);
+    TEST_RUN(SmacTest_TxQueueOrder);
+    TEST_RUN(SmacTest_TxPhyRefusal);
+    TEST_RUN(SmacTest_TxDisable);
+    TEST_RUN(SmacTest_RxRingWrap);
+    TEST_RUN(SmacTest_RxRingDrops);
+    TEST_RUN(SmacTest_RxZeroCopySuccess);
+    TEST_RUN(SmacTest_RxZeroCopyAbort);
+    TEST_RUN(SmacTest_TxAcquireCommit);
+    TEST_RUN(SmacTest_TxCommitNoMemory);
+    TEST_RUN(SmacTest_TxAcquireRelease);
+
+    return HostTest_Result();
+}
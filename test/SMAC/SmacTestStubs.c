@@ -0,0 +1,146 @@
+/*!
+* Copyright 2016-2017 NXP
+*
+* \file
+*
+* Stubs of the PHY and of the framework services used by SMAC, for the host builds
+* of SMAC. The data requests given to the PHY are recorded for the test.
+*
+* Redistribution and use in source and binary forms, with or without modification,
+* are permitted provided that the following conditions are met:
+*
+* o Redistributions of source code must retain the above copyright notice, this list
+*   of conditions and the following disclaimer.
+*
+* o Redistributions in binary form must reproduce the above copyright notice, this
+*   list of conditions and the following disclaimer in the documentation and/or
+*   other materials provided with the distribution.
+*
+* o Neither the name of Freescale Semiconductor, Inc. nor the names of its
+*   contributors may be used to endorse or promote products derived from this
+*   software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+* ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+* ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+
+
+/*! *********************************************************************************
+*************************************************************************************
+* Include
+*************************************************************************************
+********************************************************************************** */
+#include "EmbeddedTypes.h"
+#include "PhyInterface.h"
+#include "SMAC_Interface.h"
+#include "TimersManager.h"
+
+/*! *********************************************************************************
+*************************************************************************************
+* Private macros
+*************************************************************************************
+********************************************************************************** */
+#define mSmacTestMaxPdRequests_c    32
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public memory declarations
+*************************************************************************************
+********************************************************************************** */
+/* First payload byte of each data request given to the PHY, and their number */
+uint8_t gSmacTestPdIds[mSmacTestMaxPdRequests_c];
+uint32_t gSmacTestPdCount;
+
+/* Number of next data requests the PHY refuses */
+uint32_t gSmacTestPdRefusals;
+
+/* Number of management requests given to the PHY */
+uint32_t gSmacTestPlmeCount;
+
+/*! *********************************************************************************
+*************************************************************************************
+* Stubs
+*************************************************************************************
+********************************************************************************** */
+phyStatus_t MAC_PD_SapHandler(macToPdDataMessage_t *pMsg, instanceId_t phyInstance)
+{
+    (void)phyInstance;
+
+    /* Same as the PHY */
+    if( NULL == pMsg )
+    {
+        return gPhyInvalidParameter_c;
+    }
+
+    if( gSmacTestPdCount < mSmacTestMaxPdRequests_c )
+    {
+        gSmacTestPdIds[gSmacTestPdCount] = pMsg->msgData.dataReq.pPsdu[gSmacHeaderBytes_c];
+    }
+
+    gSmacTestPdCount++;
+
+    if( gSmacTestPdRefusals )
+    {
+        gSmacTestPdRefusals--;
+        return gPhyBusy_c;
+    }
+
+    return gPhySuccess_c;
+}
+
+phyStatus_t MAC_PLME_SapHandler(macToPlmeMessage_t *pMsg, instanceId_t phyInstance)
+{
+    (void)pMsg;
+    (void)phyInstance;
+    gSmacTestPlmeCount++;
+    return gPhySuccess_c;
+}
+
+void Phy_RegisterSapHandlers(PD_MAC_SapHandler_t pPD_MAC_SapHandler,
+                             PLME_MAC_SapHandler_t pPLME_MAC_SapHandler,
+                             instanceId_t instanceId)
+{
+    (void)pPD_MAC_SapHandler;
+    (void)pPLME_MAC_SapHandler;
+    (void)instanceId;
+}
+
+uint8_t PhyGetLastRxRssiValue(void)
+{
+    return 0;
+}
+
+uint8_t RNG_Init(void)
+{
+    return 0;
+}
+
+void RNG_GetRandomNo(uint32_t *pRandomNo)
+{
+    *pRandomNo = 0;
+}
+
+tmrTimerID_t TMR_AllocateTimer(void)
+{
+    return 0;
+}
+
+tmrErrCode_t TMR_StartSingleShotTimer(tmrTimerID_t timerID, tmrTimeInMilliseconds_t timeInMilliseconds,
+                                      pfTmrCallBack_t callback, void *param)
+{
+    (void)timerID;
+    (void)timeInMilliseconds;
+    (void)callback;
+    (void)param;
+    return gTmrSuccess_c;
+}
@@ -0,0 +1,229 @@
+/*!
+* Copyright 2016-2017 NXP
+*
+* \file
+*
+* Cost of the timer scheduling: the expiry heap of the Timers Manager against the
+* walk of the whole timer table that TMR_Task() did before it.
+*
+* Redistribution and use in source and binary forms, with or without modification,
+* are permitted provided that the following conditions are met:
+*
+* o Redistributions of source code must retain the above copyright notice, this list
+*   of conditions and the following disclaimer.
+*
+* o Redistributions in binary form must reproduce the above copyright notice, this
+*   list of conditions and the following disclaimer in the documentation and/or
+*   other materials provided with the distribution.
+*
+* o Neither the name of Freescale Semiconductor, Inc. nor the names of its
+*   contributors may be used to endorse or promote products derived from this
+*   software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+* ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+* ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+
+/*! *********************************************************************************
+*************************************************************************************
+* Include
+*************************************************************************************
+********************************************************************************** */
+#include <stdlib.h>
+
+#include "HostTest.h"
+#include "TimersManager.c"
+
+/*! *********************************************************************************
+*************************************************************************************
+* Private macros
+*************************************************************************************
+********************************************************************************** */
+#define mBenchRuns_c            20000
+#define mBenchMaxIntervalMs_c   300
+
+/*! *********************************************************************************
+*************************************************************************************
+* Private memory declarations
+*************************************************************************************
+********************************************************************************** */
+static const uint32_t maBenchTimerCounts[] = { 8, 32, 64, 128, gTmrTotalTimers_c };
+
+/* Timer table of the linear scan: one countdown per timer, as before the heap */
+static bool_t   maBenchActive[gTmrTotalTimers_c];
+static uint32_t maBenchRemainingTicks[gTmrTotalTimers_c];
+static uint32_t maBenchIntervalTicks[gTmrTotalTimers_c];
+
+/*! *********************************************************************************
+*************************************************************************************
+* Private functions
+*************************************************************************************
+********************************************************************************** */
+/* Gives the same intervals to the timers of both schedulers */
+static void TmrBench_Setup(uint32_t timers)
+{
+    uint32_t timerID;
+
+    srand(1);
+    mTmrHeapCount = 0;
+
+    for( timerID = 0; timerID < gTmrTotalTimers_c; timerID++ )
+    {
+        maBenchActive[timerID] = (timerID < timers);
+        maBenchIntervalTicks[timerID] = (1 + rand() % mBenchMaxIntervalMs_c) * (gStackTimer_HostFrequency_c / 1000);
+        maBenchRemainingTicks[timerID] = maBenchIntervalTicks[timerID];
+
+        maTmrTimerTable[timerID].intervalInTicks = maBenchIntervalTicks[timerID];
+        maTmrTimerTable[timerID].expireTicks = maBenchIntervalTicks[timerID];
+
+        if( maBenchActive[timerID] )
+        {
+            TMR_HeapInsert(timerID);
+        }
+    }
+}
+
+/* Run of TMR_Task() before the heap: every slot of the table is visited, the
+   countdown of the active timers is decremented and the shortest one is kept.
+   The expired interval timers are reloaded. */
+static uint32_t TmrBench_LinearRun(uint32_t *pTicksToNextRun)
+{
+    uint32_t ticksSinceLastHere = *pTicksToNextRun;
+    uint32_t nextInterruptTime = 0xFFFFFFFF;
+    uint32_t expired = 0;
+    uint32_t timerID;
+
+    for( timerID = 0; timerID < gTmrTotalTimers_c; timerID++ )
+    {
+        if( !maBenchActive[timerID] )
+        {
+            continue;
+        }
+
+        if( maBenchRemainingTicks[timerID] > ticksSinceLastHere )
+        {
+            maBenchRemainingTicks[timerID] -= ticksSinceLastHere;
+        }
+        else
+        {
+            maBenchRemainingTicks[timerID] = maBenchIntervalTicks[timerID];
+            expired++;
+        }
+
+        if( nextInterruptTime > maBenchRemainingTicks[timerID] )
+        {
+            nextInterruptTime = maBenchRemainingTicks[timerID];
+        }
+    }
+
+    *pTicksToNextRun = nextInterruptTime;
+    return expired;
+}
+
+/* Run of TMR_Task() with the heap: only the expired timers are visited */
+static uint32_t TmrBench_HeapRun(tmrTimerTicks64_t currentTicks)
+{
+    tmrTimerTableEntry_t *pTimer;
+    uint32_t expired = 0;
+
+    for(;;)
+    {
+        pTimer = &maTmrTimerTable[maTmrHeap[0]];
+
+        if( pTimer->expireTicks > currentTicks )
+        {
+            break;
+        }
+
+        pTimer->expireTicks += pTimer->intervalInTicks;
+        TMR_HeapSiftDown(0);
+        expired++;
+    }
+
+    return expired;
+}
+
+/* Both runs at the next expiry, mBenchRuns_c times. Returns the ns per run. */
+static double TmrBench_Linear(uint32_t timers, uint32_t *pExpired)
+{
+    uint64_t start;
+    uint32_t ticksToNextRun;
+    uint32_t run;
+
+    TmrBench_Setup(timers);
+    ticksToNextRun = 0;
+    (void)TmrBench_LinearRun(&ticksToNextRun);
+    *pExpired = 0;
+
+    start = HostTest_GetTimeNs();
+
+    for( run = 0; run < mBenchRuns_c; run++ )
+    {
+        *pExpired += TmrBench_LinearRun(&ticksToNextRun);
+    }
+
+    return (double)(HostTest_GetTimeNs() - start) / mBenchRuns_c;
+}
+
+static double TmrBench_Heap(uint32_t timers, uint32_t *pExpired)
+{
+    uint64_t start;
+    uint32_t run;
+
+    TmrBench_Setup(timers);
+    *pExpired = 0;
+
+    start = HostTest_GetTimeNs();
+
+    for( run = 0; run < mBenchRuns_c; run++ )
+    {
+        *pExpired += TmrBench_HeapRun(maTmrTimerTable[maTmrHeap[0]].expireTicks);
+    }
+
+    return (double)(HostTest_GetTimeNs() - start) / mBenchRuns_c;
+}
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public functions
+*************************************************************************************
+********************************************************************************** */
+int main(void)
+{
+    uint32_t linearExpired, heapExpired;
+    double linearNs, heapNs;
+    uint32_t i;
+
+    printf("Timer scheduling, %u timer slots, interval timers of 1..%u ms, ns per run\n",
+           (unsigned)gTmrTotalTimers_c, (unsigned)mBenchMaxIntervalMs_c);
+    printf("timers  linear    heap  expiries/run\n");
+
+    for( i = 0; i < NumberOfElements(maBenchTimerCounts); i++ )
+    {
+        linearNs = TmrBench_Linear(maBenchTimerCounts[i], &linearExpired);
+        heapNs = TmrBench_Heap(maBenchTimerCounts[i], &heapExpired);
+
+        /* Both schedulers must have expired the same timers */
+        if( linearExpired != heapExpired )
+        {
+            printf("%6u: %u expiries with the linear scan, %u with the heap\n",
+                   (unsigned)maBenchTimerCounts[i], (unsigned)linearExpired, (unsigned)heapExpired);
+            return 1;
+        }
+
+        printf("%6u %7.1f %7.1f %13.2f\n", (unsigned)maBenchTimerCounts[i],
+               linearNs, heapNs, (double)heapExpired / mBenchRuns_c);
+    }
+
+    return 0;
+}
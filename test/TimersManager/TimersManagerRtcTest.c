@@ -0,0 +1,262 @@
+/*!
+* Copyright 2016-2017 NXP
+*
+* \file
+*
+* Host tests of the RTC alarm queue of the Timers Manager. The RTC registers and
+* the RTC interrupt are replaced by a fake RTC, advanced by TmrRtcTest_Advance().
+*
+* Redistribution and use in source and binary forms, with or without modification,
+* are permitted provided that the following conditions are met:
+*
+* o Redistributions of source code must retain the above copyright notice, this list
+*   of conditions and the following disclaimer.
+*
+* o Redistributions in binary form must reproduce the above copyright notice, this
+*   list of conditions and the following disclaimer in the documentation and/or
+*   other materials provided with the distribution.
+*
+* o Neither the name of Freescale Semiconductor, Inc. nor the names of its
+*   contributors may be used to endorse or promote products derived from this
+*   software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+* ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+* ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+
+/*! *********************************************************************************
+*************************************************************************************
+* Include
+*************************************************************************************
+********************************************************************************** */
+#include "HostTest.h"
+#include "EmbeddedTypes.h"
+#include "fsl_device_registers.h"
+#include "fsl_clock.h"
+
+/*! *********************************************************************************
+*************************************************************************************
+* Private macros
+*************************************************************************************
+********************************************************************************** */
+/* The registers and the interrupt of the RTC used by TimersManager.c */
+#undef RTC
+#define RTC                         (&mTmrRtcTestRegs)
+#define NVIC_SetPendingIRQ(irq)     (mTmrRtcTestIrqPending = TRUE)
+#define NVIC_SetPriority(irq, prio)
+#define NVIC_EnableIRQ(irq)
+#define CLOCK_EnableClock(name)
+
+/* RTC ticks per second */
+#define mTmrRtcTestSecond_c         (0x8000)
+#define mTmrRtcTestUsPerSecond_c    (1000000ULL)
+
+/*! *********************************************************************************
+*************************************************************************************
+* Private memory declarations
+*************************************************************************************
+********************************************************************************** */
+static RTC_Type mTmrRtcTestRegs;
+static volatile bool_t mTmrRtcTestIrqPending;
+
+/* Parameters of the alarm callbacks, in the order they were called */
+static uintptr_t maTmrRtcTestExpired[16];
+static uint64_t maTmrRtcTestExpiredTime[16];
+static uint32_t mTmrRtcTestExpiredCount;
+
+#include "TimersManager.c"
+
+/*! *********************************************************************************
+*************************************************************************************
+* Private functions
+*************************************************************************************
+********************************************************************************** */
+/* Runs the RTC interrupt, if it is pending */
+static void TmrRtcTest_RunIrq(void)
+{
+    while( mTmrRtcTestIrqPending )
+    {
+        mTmrRtcTestIrqPending = FALSE;
+        TMR_RTCAlarmNotify();
+    }
+}
+
+/* Advances the RTC, one tick at a time. The alarm flag is set when the seconds
+   increment from the value of TAR. */
+static void TmrRtcTest_Advance(uint32_t ticks)
+{
+    while( ticks-- )
+    {
+        if( ++mTmrRtcTestRegs.TPR == mTmrRtcTestSecond_c )
+        {
+            mTmrRtcTestRegs.TPR = 0;
+            if( mTmrRtcTestRegs.TSR++ == mTmrRtcTestRegs.TAR )
+            {
+                mTmrRtcTestRegs.SR |= RTC_SR_TAF_MASK;
+                if( mTmrRtcTestRegs.IER & RTC_IER_TAIE_MASK )
+                {
+                    mTmrRtcTestIrqPending = TRUE;
+                }
+            }
+        }
+        TmrRtcTest_RunIrq();
+    }
+}
+
+static void TmrRtcTest_Callback(void *param)
+{
+    TEST_ASSERT(mTmrRtcTestExpiredCount < NumberOfElements(maTmrRtcTestExpired));
+    maTmrRtcTestExpired[mTmrRtcTestExpiredCount] = (uintptr_t)param;
+    maTmrRtcTestExpiredTime[mTmrRtcTestExpiredCount] = TMR_RTCGetTimestamp();
+    mTmrRtcTestExpiredCount++;
+}
+
+/* Starts the RTC at a time that is not a whole second, and clears the queue */
+static void TmrRtcTest_Init(void)
+{
+    tmrRTCAlarmID_t i;
+
+    TMR_RTCInit();
+    TMR_RTCSetTime(0);
+    TMR_RTCSetAlarm(0, NULL, NULL);
+    for( i = 0; i < gTmrRTCAlarms_c; i++ )
+    {
+        (void)TMR_RTCStopAlarm(i);
+    }
+    TmrRtcTest_RunIrq();
+    TmrRtcTest_Advance(mTmrRtcTestSecond_c / 3);
+    mTmrRtcTestExpiredCount = 0;
+}
+
+/*! *********************************************************************************
+*************************************************************************************
+* Test cases
+*************************************************************************************
+********************************************************************************** */
+/* Alarms expire in deadline order, in the second of their deadline. Queuing a
+   relative alarm does not move the RTC. */
+static void TmrRtcTest_Ordering(void)
+{
+    static const uint32_t delays[] = {3, 1, 4, 2};
+    uint64_t start, deadline;
+    uint32_t prescaler, i;
+
+    TmrRtcTest_Init();
+    start = TMR_RTCGetTimestamp();
+
+    for( i = 0; i < NumberOfElements(delays); i++ )
+    {
+        prescaler = mTmrRtcTestRegs.TPR;
+        TEST_ASSERT(i == TMR_RTCStartAlarmRelative(delays[i], 0, TmrRtcTest_Callback, (void*)(uintptr_t)delays[i]));
+        TEST_ASSERT(prescaler == mTmrRtcTestRegs.TPR);
+        TmrRtcTest_Advance(100);
+    }
+    TEST_ASSERT(!mTmrRtcTestIrqPending);
+    TEST_ASSERT(0 == mTmrRtcTestExpiredCount);
+
+    TmrRtcTest_Advance(6 * mTmrRtcTestSecond_c);
+
+    TEST_ASSERT(NumberOfElements(delays) == mTmrRtcTestExpiredCount);
+    for( i = 0; i < mTmrRtcTestExpiredCount; i++ )
+    {
+        TEST_ASSERT(i + 1 == maTmrRtcTestExpired[i]);
+        /* Each alarm was queued less than 400 ticks after the start */
+        deadline = start + (i + 1) * mTmrRtcTestUsPerSecond_c;
+        TEST_ASSERT(maTmrRtcTestExpiredTime[i] >= deadline);
+        TEST_ASSERT(maTmrRtcTestExpiredTime[i] < deadline + mTmrRtcTestUsPerSecond_c);
+    }
+    TEST_ASSERT(0 == (mTmrRtcTestRegs.IER & RTC_IER_TAIE_MASK));
+}
+
+/* An alarm that is already due runs from the RTC interrupt, never from the
+   function that queues it */
+static void TmrRtcTest_AlreadyDue(void)
+{
+    TmrRtcTest_Init();
+    TmrRtcTest_Advance(2 * mTmrRtcTestSecond_c);
+
+    TEST_ASSERT(0 == TMR_RTCStartAlarm(1, 0, TmrRtcTest_Callback, (void*)1));
+    TEST_ASSERT(0 == mTmrRtcTestExpiredCount);
+    TEST_ASSERT(mTmrRtcTestIrqPending);
+    TmrRtcTest_RunIrq();
+    TEST_ASSERT(1 == mTmrRtcTestExpiredCount);
+
+    TMR_RTCSetAlarmRelative(0, TmrRtcTest_Callback, (void*)2);
+    TEST_ASSERT(1 == mTmrRtcTestExpiredCount);
+    TEST_ASSERT(mTmrRtcTestIrqPending);
+    TmrRtcTest_RunIrq();
+    TEST_ASSERT(2 == mTmrRtcTestExpiredCount);
+    TEST_ASSERT(2 == maTmrRtcTestExpired[1]);
+
+    /* Moving the time past a queued alarm makes it due */
+    TEST_ASSERT(0 == TMR_RTCStartAlarmRelative(10, 0, TmrRtcTest_Callback, (void*)3));
+    TEST_ASSERT(!mTmrRtcTestIrqPending);
+    TMR_RTCSetTime(TMR_RTCGetTimestamp() + 20 * mTmrRtcTestUsPerSecond_c);
+    TEST_ASSERT(2 == mTmrRtcTestExpiredCount);
+    TmrRtcTest_RunIrq();
+    TEST_ASSERT(3 == mTmrRtcTestExpiredCount);
+    TEST_ASSERT(3 == maTmrRtcTestExpired[2]);
+}
+
+/* The queue holds gTmrRTCAlarms_c alarms, besides the one of TMR_RTCSetAlarm() */
+static void TmrRtcTest_QueueFull(void)
+{
+    tmrRTCAlarmID_t i;
+
+    TmrRtcTest_Init();
+    TEST_ASSERT(4 == gTmrRTCAlarms_c);
+
+    for( i = 0; i < gTmrRTCAlarms_c; i++ )
+    {
+        TEST_ASSERT(i == TMR_RTCStartAlarmRelative(10 + i, 0, TmrRtcTest_Callback, (void*)(uintptr_t)i));
+    }
+    TEST_ASSERT(gTmrInvalidRTCAlarmID_c == TMR_RTCStartAlarmRelative(1, 0, TmrRtcTest_Callback, NULL));
+    TEST_ASSERT(gTmrInvalidRTCAlarmID_c == TMR_RTCStartAlarm(100, 0, TmrRtcTest_Callback, NULL));
+    TMR_RTCSetAlarmRelative(5, TmrRtcTest_Callback, (void*)5);
+
+    /* A stopped alarm frees its entry */
+    TEST_ASSERT(gTmrSuccess_c == TMR_RTCStopAlarm(2));
+    TEST_ASSERT(gTmrInvalidId_c == TMR_RTCStopAlarm(2));
+    TEST_ASSERT(gTmrInvalidId_c == TMR_RTCStopAlarm(gTmrRTCAlarms_c));
+    TEST_ASSERT(2 == TMR_RTCStartAlarmRelative(1, 0, TmrRtcTest_Callback, (void*)6));
+
+    TmrRtcTest_Advance(15 * mTmrRtcTestSecond_c);
+    TEST_ASSERT(5 == mTmrRtcTestExpiredCount);
+    TEST_ASSERT(6 == maTmrRtcTestExpired[0]);
+    TEST_ASSERT(5 == maTmrRtcTestExpired[1]);
+    TEST_ASSERT(0 == maTmrRtcTestExpired[2]);
+    TEST_ASSERT(1 == maTmrRtcTestExpired[3]);
+    TEST_ASSERT(3 == maTmrRtcTestExpired[4]);
+
+    /* Single alarms free their entry when they expire */
+    for( i = 0; i < gTmrRTCAlarms_c; i++ )
+    {
+        TEST_ASSERT(i == TMR_RTCStartAlarmRelative(1, 0, TmrRtcTest_Callback, NULL));
+    }
+    TmrRtcTest_Advance(2 * mTmrRtcTestSecond_c);
+    TEST_ASSERT(5 + gTmrRTCAlarms_c == mTmrRtcTestExpiredCount);
+}
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public functions
+*************************************************************************************
+********************************************************************************** */
+int main(void)
+{
+    TEST_RUN(TmrRtcTest_Ordering);
+    TEST_RUN(TmrRtcTest_AlreadyDue);
+    TEST_RUN(TmrRtcTest_QueueFull);
+
+    return HostTest_Result();
+}
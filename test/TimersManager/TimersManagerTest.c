@@ -0,0 +1,513 @@
+/*!
+* Copyright 2016-2017 NXP
+*
+* \file
+*
+* Host tests of the Timers Manager scheduler, run on the virtual counter of the
+* host backend of TMR_Adapter.c.
+*
+* Redistribution and use in source and binary forms, with or without modification,
+* are permitted provided that the following conditions are met:
+*
+* o Redistributions of source code must retain the above copyright notice, this list
+*   of conditions and the following disclaimer.
+*
+* o Redistributions in binary form must reproduce the above copyright notice, this
+*   list of conditions and the following disclaimer in the documentation and/or
+*   other materials provided with the distribution.
+*
+* o Neither the name of Freescale Semiconductor, Inc. nor the names of its
+*   contributors may be used to endorse or promote products derived from this
+*   software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+* ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+* ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+
+/*! *********************************************************************************
+*************************************************************************************
+* Include
+*************************************************************************************
+********************************************************************************** */
+#include <stdlib.h>
+
+#include "HostTest.h"
+#include "TimersManager.c"
+
+/*! *********************************************************************************
+*************************************************************************************
+* Private macros
+*************************************************************************************
+********************************************************************************** */
+#define mTmrTestTimers_c            64
+#define mTmrTestIterations_c        300000
+#define mTmrTestMaxIntervalMs_c     300
+#define mTmrTestMaxSlackMs_c        20
+/* Largest clock step of the test loop, between two runs of the timer thread */
+#define mTmrTestMaxStepTicks_c      8
+/* A callback may run one loop step late, plus one counter read for each
+   callback run before it by the same run of the timer thread */
+#define mTmrTestMaxLatenessTicks_c  (mTmrTestMaxStepTicks_c + 2 * mTmrTestTimers_c)
+
+/*! *********************************************************************************
+*************************************************************************************
+* Private type definitions
+*************************************************************************************
+********************************************************************************** */
+typedef struct tmrTestTimer_tag
+{
+    tmrTimerID_t      timerID;
+    bool_t            active;
+    bool_t            interval;
+    tmrTimerTicks64_t deadline;
+    tmrTimerTicks64_t intervalTicks;
+    tmrTimerTicks64_t slackTicks;
+}tmrTestTimer_t;
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public memory declarations
+*************************************************************************************
+********************************************************************************** */
+/* Set by OSA_EventSet(). See TimersManagerTestStubs.c */
+extern uint32_t gTmrTestEventsPending;
+
+/*! *********************************************************************************
+*************************************************************************************
+* Private memory declarations
+*************************************************************************************
+********************************************************************************** */
+static tmrTestTimer_t maTmrTestTimers[mTmrTestTimers_c];
+static uint32_t mTmrTestFired;
+static uint32_t mTmrTestEarly;
+static uint32_t mTmrTestLate;
+static uint32_t mTmrTestStopped;
+static uint32_t mTmrTestPeriods;
+static uint32_t mTmrTestThreadRuns;
+static uint32_t maTmrTestExpiryRun[2];
+
+/*! *********************************************************************************
+*************************************************************************************
+* Private functions
+*************************************************************************************
+********************************************************************************** */
+/* Absolute time in ticks, as seen by the Timers Manager */
+static tmrTimerTicks64_t TmrTest_Now(void)
+{
+    tmrTimerTicks64_t now;
+
+    TmrIntDisableAll();
+    now = TMR_GetCurrentTicks();
+    TmrIntRestoreAll();
+
+    return now;
+}
+
+/* Runs the timer thread if its event was set */
+static void TmrTest_RunThread(void)
+{
+    while( gTmrTestEventsPending )
+    {
+        gTmrTestEventsPending = 0;
+        mTmrTestThreadRuns++;
+        TMR_Task(NULL);
+    }
+}
+
+static void TmrTest_Callback(void *param)
+{
+    tmrTestTimer_t *pTimer = (tmrTestTimer_t*)param;
+    tmrTimerTicks64_t now = TmrTest_Now();
+
+    mTmrTestFired++;
+
+    if( !pTimer->active )
+    {
+        mTmrTestStopped++;
+        return;
+    }
+
+    if( now < pTimer->deadline )
+    {
+        mTmrTestEarly++;
+    }
+    else if( now - pTimer->deadline > pTimer->slackTicks + mTmrTestMaxLatenessTicks_c )
+    {
+        mTmrTestLate++;
+    }
+
+    if( pTimer->interval )
+    {
+        pTimer->deadline += pTimer->intervalTicks;
+        if( pTimer->deadline <= now )
+        {
+            pTimer->deadline = now;
+        }
+    }
+    else
+    {
+        pTimer->active = FALSE;
+    }
+}
+
+/* Starts a timer with a random type, interval and slack */
+static void TmrTest_Start(tmrTestTimer_t *pTimer)
+{
+    uint32_t intervalMs = 1 + rand() % mTmrTestMaxIntervalMs_c;
+    uint32_t slackMs = (rand() % 3) ? 0 : rand() % mTmrTestMaxSlackMs_c;
+
+    if( slackMs >= intervalMs )
+    {
+        slackMs = intervalMs - 1;
+    }
+
+    pTimer->interval = rand() % 2;
+    pTimer->intervalTicks = TmrTicksFromMilliseconds(intervalMs);
+    pTimer->slackTicks = TmrTicksFromMilliseconds(slackMs);
+    pTimer->deadline = TmrTest_Now() + pTimer->intervalTicks;
+    pTimer->active = TRUE;
+
+    (void)TMR_StartTimerWithSlack(pTimer->timerID,
+                                  pTimer->interval ? gTmrIntervalTimer_c : gTmrSingleShotTimer_c,
+                                  intervalMs, slackMs, TmrTest_Callback, pTimer);
+}
+
+static void TmrTest_PeriodCallback(void *param)
+{
+    (void)param;
+    mTmrTestPeriods++;
+}
+
+/* Advances the counter by many ticks, reading it often enough to count its wraps */
+static void TmrTest_Spend(uint32_t ticks)
+{
+    uint32_t step;
+
+    while( ticks )
+    {
+        step = (ticks < 0x1000) ? ticks : 0x1000;
+        StackTimer_HostAdvance(step);
+        (void)TmrTest_Now();
+        ticks -= step;
+    }
+}
+
+#if gTMR_EnableProfiling_d
+/* Runs for the number of ticks given as parameter */
+static void TmrTest_ProfileCallback(void *param)
+{
+    mTmrTestFired++;
+    TmrTest_Spend(*(uint32_t*)param);
+}
+#endif
+
+/* Records the run of the timer thread that called it */
+static void TmrTest_RunCallback(void *param)
+{
+    *(uint32_t*)param = mTmrTestThreadRuns;
+}
+
+/*! *********************************************************************************
+*************************************************************************************
+* Test cases
+*************************************************************************************
+********************************************************************************** */
+/* The absolute time keeps counting up across the wraps of the 16 bit counter */
+static void TmrTest_TicksAcrossWrap(void)
+{
+    tmrTimerTicks64_t start, previous, now;
+    tmrTimerID_t timerID;
+    uint32_t step, i;
+
+    TMR_Init();
+    timerID = TMR_AllocateTimer();
+    TEST_ASSERT(gTmrInvalidTimerID_c != timerID);
+
+    /* The counter only runs while a timer is active */
+    TEST_ASSERT(gTmrSuccess_c == TMR_StartIntervalTimer(timerID, 100, NULL, NULL));
+    TmrTest_RunThread();
+
+    start = previous = TmrTest_Now();
+
+    for( i = 0; i < 1000; i++ )
+    {
+        step = 1 + rand() % 0x3FFF;
+        StackTimer_HostAdvance(step);
+        now = TmrTest_Now();
+        /* Each read of the counter takes one tick */
+        TEST_ASSERT(now >= previous + step);
+        TEST_ASSERT(now <= previous + step + mTmrTestMaxStepTicks_c);
+        previous = now;
+        TmrTest_RunThread();
+    }
+
+    TEST_ASSERT(now - start > 100 * 0x10000);
+
+    (void)TMR_StopTimer(timerID);
+    TEST_ASSERT(gTmrSuccess_c == TMR_FreeTimer(timerID));
+}
+
+/* Random single shot and interval timers, with and without slack, are started
+   and stopped. None expires before its deadline, nor after the end of its slack. */
+static void TmrTest_ExpiryInTime(void)
+{
+    tmrTestTimer_t *pTimer;
+    uint32_t i, iteration;
+
+    TMR_Init();
+    srand(1);
+    mTmrTestFired = mTmrTestEarly = mTmrTestLate = mTmrTestStopped = 0;
+
+    for( i = 0; i < mTmrTestTimers_c; i++ )
+    {
+        maTmrTestTimers[i].timerID = TMR_AllocateTimer();
+        TEST_ASSERT(gTmrInvalidTimerID_c != maTmrTestTimers[i].timerID);
+        TmrTest_Start(&maTmrTestTimers[i]);
+    }
+
+    for( iteration = 0; iteration < mTmrTestIterations_c; iteration++ )
+    {
+        TmrTest_RunThread();
+        StackTimer_HostAdvance(1 + rand() % mTmrTestMaxStepTicks_c);
+
+        /* Restart a running timer from time to time */
+        if( 0 == rand() % 500 )
+        {
+            pTimer = &maTmrTestTimers[rand() % mTmrTestTimers_c];
+            (void)TMR_StopTimer(pTimer->timerID);
+            pTimer->active = FALSE;
+            TmrTest_Start(pTimer);
+        }
+
+        for( i = 0; i < mTmrTestTimers_c; i++ )
+        {
+            if( !maTmrTestTimers[i].active && (0 == rand() % 50) )
+            {
+                TmrTest_Start(&maTmrTestTimers[i]);
+            }
+        }
+    }
+
+    for( i = 0; i < mTmrTestTimers_c; i++ )
+    {
+        (void)TMR_StopTimer(maTmrTestTimers[i].timerID);
+        TEST_ASSERT(gTmrSuccess_c == TMR_FreeTimer(maTmrTestTimers[i].timerID));
+    }
+
+    TEST_ASSERT(mTmrTestFired > 10 * mTmrTestTimers_c);
+    TEST_ASSERT(0 == mTmrTestStopped);
+    TEST_ASSERT(0 == mTmrTestEarly);
+    TEST_ASSERT(0 == mTmrTestLate);
+}
+
+/* An interval timer started with a slack longer than its interval still
+   expires once per interval */
+static void TmrTest_IntervalSlack(void)
+{
+    tmrTimerID_t timerID;
+    uint32_t tick;
+
+    TMR_Init();
+    mTmrTestPeriods = 0;
+    timerID = TMR_AllocateTimer();
+    TEST_ASSERT(gTmrInvalidTimerID_c != timerID);
+
+    TEST_ASSERT(gTmrSuccess_c == TMR_StartTimerWithSlack(timerID, gTmrIntervalTimer_c, 10, 50,
+                                                         TmrTest_PeriodCallback, NULL));
+    TEST_ASSERT(maTmrTimerTable[timerID].slackInTicks < maTmrTimerTable[timerID].intervalInTicks);
+
+    /* 100 periods */
+    for( tick = 0; tick < TmrTicksFromMilliseconds(1000); tick++ )
+    {
+        TmrTest_RunThread();
+        StackTimer_HostAdvance(1);
+    }
+
+    (void)TMR_StopTimer(timerID);
+    TEST_ASSERT(gTmrSuccess_c == TMR_FreeTimer(timerID));
+    TEST_ASSERT(mTmrTestPeriods >= 99);
+}
+
+/* Two timers with overlapping slack windows expire in the same run of the timer
+   thread, which is counted as a saved wakeup */
+static void TmrTest_SlackCoalescing(void)
+{
+    tmrTimerID_t timerIDs[2];
+    uint32_t wakeupsSaved, runs, tick;
+
+    TMR_Init();
+    timerIDs[0] = TMR_AllocateTimer();
+    timerIDs[1] = TMR_AllocateTimer();
+    TEST_ASSERT((gTmrInvalidTimerID_c != timerIDs[0]) && (gTmrInvalidTimerID_c != timerIDs[1]));
+    maTmrTestExpiryRun[0] = maTmrTestExpiryRun[1] = 0;
+    wakeupsSaved = TMR_GetWakeupsSaved();
+
+    /* Windows of 10..20 ms and 15..25 ms */
+    TEST_ASSERT(gTmrSuccess_c == TMR_StartTimerWithSlack(timerIDs[0], gTmrSingleShotTimer_c, 10, 10,
+                                                         TmrTest_RunCallback, &maTmrTestExpiryRun[0]));
+    TEST_ASSERT(gTmrSuccess_c == TMR_StartTimerWithSlack(timerIDs[1], gTmrSingleShotTimer_c, 15, 10,
+                                                         TmrTest_RunCallback, &maTmrTestExpiryRun[1]));
+    TmrTest_RunThread();
+    runs = mTmrTestThreadRuns;
+
+    for( tick = 0; tick < TmrTicksFromMilliseconds(30); tick++ )
+    {
+        StackTimer_HostAdvance(1);
+        TmrTest_RunThread();
+    }
+
+    TEST_ASSERT(0 != maTmrTestExpiryRun[0]);
+    TEST_ASSERT(maTmrTestExpiryRun[0] == maTmrTestExpiryRun[1]);
+    TEST_ASSERT(runs + 1 == mTmrTestThreadRuns);
+    TEST_ASSERT(wakeupsSaved + 1 == TMR_GetWakeupsSaved());
+
+    TEST_ASSERT(gTmrSuccess_c == TMR_FreeTimer(timerIDs[0]));
+    TEST_ASSERT(gTmrSuccess_c == TMR_FreeTimer(timerIDs[1]));
+}
+
+/* Every timer can be allocated once, and the lowest free ID is reused. The
+   number of allocated timers and its peak follow the allocations. */
+static void TmrTest_Allocator(void)
+{
+    static tmrTimerID_t timerIDs[gTmrTotalTimers_c];
+    uint8_t allocated;
+    uint32_t i;
+
+    TMR_Init();
+    allocated = TMR_GetAllocatedTimers();
+    TEST_ASSERT(0 == allocated);
+
+    for( i = 0; i < gTmrTotalTimers_c; i++ )
+    {
+        timerIDs[i] = TMR_AllocateTimer();
+        TEST_ASSERT(i == timerIDs[i]);
+        TEST_ASSERT(i + 1 == TMR_GetAllocatedTimers());
+    }
+    TEST_ASSERT(gTmrInvalidTimerID_c == TMR_AllocateTimer());
+    TEST_ASSERT(gTmrTotalTimers_c == TMR_GetAllocatedTimers());
+    TEST_ASSERT(gTmrTotalTimers_c == TMR_GetAllocatedTimersPeak());
+
+    /* An active timer is stopped when freed */
+    TEST_ASSERT(gTmrSuccess_c == TMR_StartSingleShotTimer(timerIDs[40], 10, NULL, NULL));
+    TEST_ASSERT(gTmrSuccess_c == TMR_FreeTimer(timerIDs[40]));
+    TEST_ASSERT(gTmrSuccess_c == TMR_FreeTimer(timerIDs[3]));
+    TEST_ASSERT(!TMR_IsTimerActive(timerIDs[40]));
+    TEST_ASSERT(gTmrTotalTimers_c - 2 == TMR_GetAllocatedTimers());
+
+    /* A timer freed twice is only counted once */
+    (void)TMR_FreeTimer(timerIDs[3]);
+    TEST_ASSERT(gTmrTotalTimers_c - 2 == TMR_GetAllocatedTimers());
+    TEST_ASSERT(gTmrInvalidId_c == TMR_StartSingleShotTimer(timerIDs[3], 10, NULL, NULL));
+
+    TEST_ASSERT(timerIDs[3] == TMR_AllocateTimer());
+    TEST_ASSERT(timerIDs[40] == TMR_AllocateTimer());
+    TEST_ASSERT(gTmrInvalidTimerID_c == TMR_AllocateTimer());
+    TEST_ASSERT(gTmrTotalTimers_c == TMR_GetAllocatedTimersPeak());
+
+    for( i = 0; i < gTmrTotalTimers_c; i++ )
+    {
+        TEST_ASSERT(gTmrSuccess_c == TMR_FreeTimer(timerIDs[i]));
+    }
+    TEST_ASSERT(0 == TMR_GetAllocatedTimers());
+    TEST_ASSERT(gTmrTotalTimers_c == TMR_GetAllocatedTimersPeak());
+    TEST_ASSERT(0 == TMR_AllocateTimer());
+    TEST_ASSERT(gTmrSuccess_c == TMR_FreeTimer(0));
+}
+
+#if gTMR_EnableProfiling_d
+/* The lateness and the duration of each callback are counted in the bin of their
+   range, until the profile is reset. With the 250 kHz counter, a tick is 4 us. */
+static void TmrTest_ProfilingHistograms(void)
+{
+    tmrTimerID_t timerID, runningID;
+    uint32_t durationTicks;
+    uint32_t i;
+
+    TMR_Init();
+    mTmrTestFired = 0;
+    timerID = TMR_AllocateTimer();
+    runningID = TMR_AllocateTimer();
+    TEST_ASSERT((gTmrInvalidTimerID_c != timerID) && (gTmrInvalidTimerID_c != runningID));
+
+    /* The counter only runs while a timer is active, including in the callbacks
+       of single shot timers. This one does not expire during the test. */
+    TEST_ASSERT(gTmrSuccess_c == TMR_StartIntervalTimer(runningID, 5000, NULL, NULL));
+    TMR_ProfilingReset();
+
+    /* On time, and returns at once: first bins */
+    durationTicks = 0;
+    TEST_ASSERT(gTmrSuccess_c == TMR_StartSingleShotTimer(timerID, 10, TmrTest_ProfileCallback, &durationTicks));
+    while( 0 == mTmrTestFired )
+    {
+        TmrTest_RunThread();
+        StackTimer_HostAdvance(1);
+    }
+
+    /* 500 us late, in the 256..1024 us bin, and runs 2000 us, in the 1024..4096 us bin */
+    durationTicks = 500;
+    TEST_ASSERT(gTmrSuccess_c == TMR_StartSingleShotTimer(timerID, 10, TmrTest_ProfileCallback, &durationTicks));
+    TmrTest_RunThread();
+    TmrTest_Spend(TmrTicksFromMilliseconds(10) + 125);
+    TmrTest_RunThread();
+    TEST_ASSERT(2 == mTmrTestFired);
+
+    /* 295 ms late, in the last bin */
+    durationTicks = 0;
+    TEST_ASSERT(gTmrSuccess_c == TMR_StartSingleShotTimer(timerID, 10, TmrTest_ProfileCallback, &durationTicks));
+    TmrTest_RunThread();
+    TmrTest_Spend(TmrTicksFromMilliseconds(10) + 0x12000);
+    TmrTest_RunThread();
+    TEST_ASSERT(3 == mTmrTestFired);
+
+    for( i = 0; i < mTmrProfilingBins_c; i++ )
+    {
+        TEST_ASSERT(maTmrLatenessHistogram[i] == ((i == 0) || (i == 2) || (i == mTmrProfilingBins_c - 1)));
+        TEST_ASSERT(maTmrDurationHistogram[i] == ((i == 0) ? 2 : (i == 3)));
+    }
+    TEST_ASSERT(3 == maTmrProfile[timerID].expirations);
+    TEST_ASSERT(maTmrProfile[timerID].maxLatenessUs >= 0x12000 * 4);
+    TEST_ASSERT((maTmrProfile[timerID].maxDurationUs >= 2000) && (maTmrProfile[timerID].maxDurationUs < 2100));
+
+    TMR_ProfilingReset();
+    for( i = 0; i < mTmrProfilingBins_c; i++ )
+    {
+        TEST_ASSERT(0 == maTmrLatenessHistogram[i]);
+        TEST_ASSERT(0 == maTmrDurationHistogram[i]);
+    }
+    TEST_ASSERT(0 == maTmrProfile[timerID].expirations);
+    TEST_ASSERT(0 == maTmrProfile[timerID].maxLatenessUs);
+    TEST_ASSERT(0 == maTmrProfile[timerID].maxDurationUs);
+
+    TEST_ASSERT(gTmrSuccess_c == TMR_FreeTimer(timerID));
+    TEST_ASSERT(gTmrSuccess_c == TMR_FreeTimer(runningID));
+}
+#endif /*gTMR_EnableProfiling_d*/
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public functions
+*************************************************************************************
+********************************************************************************** */
+int main(void)
+{
+    TEST_RUN(TmrTest_TicksAcrossWrap);
+    TEST_RUN(TmrTest_ExpiryInTime);
+    TEST_RUN(TmrTest_IntervalSlack);
+    TEST_RUN(TmrTest_SlackCoalescing);
+    TEST_RUN(TmrTest_Allocator);
+#if gTMR_EnableProfiling_d
+    TEST_RUN(TmrTest_ProfilingHistograms);
+#endif
+
+    return HostTest_Result();
+}
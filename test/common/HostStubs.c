@@ -0,0 +1,177 @@
+/*!
+* Copyright 2016-2017 NXP
+*
+* \file
+*
+* Host implementation of the test helpers, and stubs of the OS abstraction,
+* Panic and SerialManager services used by the modules under test.
+*
+* Redistribution and use in source and binary forms, with or without modification,
+* are permitted provided that the following conditions are met:
+*
+* o Redistributions of source code must retain the above copyright notice, this list
+*   of conditions and the following disclaimer.
+*
+* o Redistributions in binary form must reproduce the above copyright notice, this
+*   list of conditions and the following disclaimer in the documentation and/or
+*   other materials provided with the distribution.
+*
+* o Neither the name of Freescale Semiconductor, Inc. nor the names of its
+*   contributors may be used to endorse or promote products derived from this
+*   software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+* ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+* ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+/*! *********************************************************************************
+*************************************************************************************
+* Include
+*************************************************************************************
+********************************************************************************** */
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "HostTest.h"
+#include "EmbeddedTypes.h"
+#include "fsl_os_abstraction.h"
+#include "Panic.h"
+#include "SerialManager.h"
+
+/*! *********************************************************************************
+*************************************************************************************
+* Private macros
+*************************************************************************************
+********************************************************************************** */
+#define mHostTestSerialSize_c   8192
+
+/*! *********************************************************************************
+*************************************************************************************
+* Private memory declarations
+*************************************************************************************
+********************************************************************************** */
+int gHostTestIntDisableCount;
+int gHostTestPanicCount;
+uint8_t gHostTestPanicReturns;
+
+static int mTestFailures;
+static int mTestCaseFailed;
+static uint8_t mSerialData[mHostTestSerialSize_c];
+static uint32_t mSerialLength;
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public functions
+*************************************************************************************
+********************************************************************************** */
+void HostTest_Run(const char *pName, void (*pTestCase)(void))
+{
+    mTestCaseFailed = 0;
+    pTestCase();
+
+    if( gHostTestIntDisableCount )
+    {
+        printf("  interrupts left disabled (%d)\n", gHostTestIntDisableCount);
+        gHostTestIntDisableCount = 0;
+        mTestCaseFailed = 1;
+    }
+
+    printf("%s %s\n", mTestCaseFailed ? "FAIL" : "PASS", pName);
+    mTestFailures += mTestCaseFailed;
+}
+
+void HostTest_Fail(const char *pFile, int line, const char *pCondition)
+{
+    printf("  %s:%d: %s\n", pFile, line, pCondition);
+    mTestCaseFailed = 1;
+}
+
+int HostTest_Result(void)
+{
+    return mTestFailures ? 1 : 0;
+}
+
+uint64_t HostTest_GetTimeNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void HostTest_SerialReset(void)
+{
+    mSerialLength = 0;
+}
+
+const uint8_t* HostTest_SerialData(uint32_t *pLength)
+{
+    *pLength = mSerialLength;
+    return mSerialData;
+}
+
+/*! *********************************************************************************
+*************************************************************************************
+* Stubs
+*************************************************************************************
+********************************************************************************** */
+void OSA_InterruptDisable(void)
+{
+    gHostTestIntDisableCount++;
+}
+
+void OSA_InterruptEnable(void)
+{
+    gHostTestIntDisableCount--;
+}
+
+void panic(panicId_t id, uint32_t location, uint32_t extra1, uint32_t extra2)
+{
+    gHostTestPanicCount++;
+    if( gHostTestPanicReturns )
+    {
+        return;
+    }
+
+    printf("panic(0x%x, 0x%x, 0x%x, 0x%x)\n", (unsigned)id, (unsigned)location,
+           (unsigned)extra1, (unsigned)extra2);
+    abort();
+}
+
+serialStatus_t Serial_SyncWrite(uint8_t InterfaceId, uint8_t *pBuf, uint16_t bufLen)
+{
+    (void)InterfaceId;
+
+    if( bufLen > mHostTestSerialSize_c - mSerialLength )
+    {
+        return gSerial_InternalError_c;
+    }
+
+    memcpy(&mSerialData[mSerialLength], pBuf, bufLen);
+    mSerialLength += bufLen;
+    return gSerial_Success_c;
+}
+
+serialStatus_t Serial_Print(uint8_t InterfaceId, char *pString, serialBlock_t allowToBlock)
+{
+    (void)allowToBlock;
+    return Serial_SyncWrite(InterfaceId, (uint8_t*)pString, (uint16_t)strlen(pString));
+}
+
+serialStatus_t Serial_PrintDec(uint8_t InterfaceId, uint32_t nr)
+{
+    char str[11];
+
+    snprintf(str, sizeof(str), "%u", (unsigned)nr);
+    return Serial_Print(InterfaceId, str, gAllowToBlock_d);
+}
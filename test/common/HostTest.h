@@ -0,0 +1,83 @@
+/*!
+* Copyright 2016-2017 NXP
+*
+* \file
+*
+* Minimal test helpers for the host builds of the framework modules.
+*
+* Redistribution and use in source and binary forms, with or without modification,
+* are permitted provided that the following conditions are met:
+*
+* o Redistributions of source code must retain the above copyright notice, this list
+*   of conditions and the following disclaimer.
+*
+* o Redistributions in binary form must reproduce the above copyright notice, this
+*   list of conditions and the following disclaimer in the documentation and/or
+*   other materials provided with the distribution.
+*
+* o Neither the name of Freescale Semiconductor, Inc. nor the names of its
+*   contributors may be used to endorse or promote products derived from this
+*   software without specific prior written permission.
+*
+* THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+* ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+* WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+* DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+* ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+* (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+* LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+* ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+* (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+* SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef _HOST_TEST_H_
+#define _HOST_TEST_H_
+
+/*! *********************************************************************************
+*************************************************************************************
+* Include
+*************************************************************************************
+********************************************************************************** */
+#include <stdint.h>
+#include <stdio.h>
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public macros
+*************************************************************************************
+********************************************************************************** */
+/* Records a failure and leaves the current test case */
+#define TEST_ASSERT(condition) \
+    do { if( !(condition) ) { HostTest_Fail(__FILE__, __LINE__, #condition); return; } } while(0)
+
+/* Runs a test case, which is a void function without parameters */
+#define TEST_RUN(testCase)  HostTest_Run(#testCase, testCase)
+
+/*! *********************************************************************************
+*************************************************************************************
+* Public prototypes
+*************************************************************************************
+********************************************************************************** */
+/* Runs a test case and prints its result */
+void HostTest_Run(const char *pName, void (*pTestCase)(void));
+/* Marks the current test case as failed */
+void HostTest_Fail(const char *pFile, int line, const char *pCondition);
+/* Returns the process exit code: 0 if all test cases passed */
+int HostTest_Result(void);
+/* Returns a monotonic time stamp in nanoseconds, for the benchmarks */
+uint64_t HostTest_GetTimeNs(void);
+
+/* SerialManager output written by the module under test */
+void HostTest_SerialReset(void);
+const uint8_t* HostTest_SerialData(uint32_t *pLength);
+
+/* Number of OSA_InterruptDisable() calls not yet matched by OSA_InterruptEnable() */
+extern int gHostTestIntDisableCount;
+
+/* Number of panic() calls. panic() aborts the test, unless gHostTestPanicReturns
+   is set by a test that expects it. */
+extern int gHostTestPanicCount;
+extern uint8_t gHostTestPanicReturns;
+
+#endif /* _HOST_TEST_H_ */